@@ -0,0 +1,184 @@
+#ifndef LCLCOMPILER_ARENA_REGISTRY_HPP
+#define LCLCOMPILER_ARENA_REGISTRY_HPP
+
+#include <cassert>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+#include <memory.hpp>
+
+namespace lcl::memory
+{
+    class arena_registry;
+
+    //Owns an arena of an `arena_registry` for as long as a compilation unit needs it. 
+    //Handing the unit off to another thread is moving the lease, destroying it frees everything in the arena at once and gives it back to the registry.
+    class arena_lease
+    {
+        arena_registry*                                  m_registry = nullptr;
+        std::unique_ptr<contiguous_virtual_memory_arena> m_arena;
+
+        public:
+        arena_lease(arena_registry& registry, std::unique_ptr<contiguous_virtual_memory_arena> arena) noexcept : m_registry(&registry), m_arena(std::move(arena))
+        {
+            //Empty
+        }
+
+        arena_lease(arena_lease&&) noexcept = default;
+        arena_lease& operator=(arena_lease&& other) noexcept
+        {
+            //Releasing first would give the arena back while this lease still holds it
+            if (this == &other)
+            {
+                return *this;
+            }
+
+            release();
+
+            m_registry = other.m_registry;
+            m_arena    = std::move(other.m_arena);
+
+            return *this;
+        }
+
+        arena_lease(const arena_lease&) = delete;
+        arena_lease& operator=(const arena_lease&) = delete;
+
+        [[nodiscard]] auto arena() const noexcept -> contiguous_virtual_memory_arena&
+        {
+            assert(m_arena != nullptr);
+            return *m_arena;
+        }
+
+        //Gives the arena back before the lease is destroyed, the lease is empty afterwards
+        inline auto release() -> void;
+
+        ~arena_lease()
+        {
+            release();
+        }
+    };
+
+    //Hands out one arena to each compilation unit being compiled, so the threads compiling them never share an allocator. 
+    //Only handing out and giving back arenas takes a lock, allocating from them doesn't synchronize.
+    //Arenas that are given back are emptied and reused, the registry must outlive its leases.
+    class arena_registry
+    {
+        friend class arena_lease;
+
+        const std::size_t  m_pages_per_arena;
+        const page_backing m_page_backing;
+        const std::size_t  m_high_water_mark;
+
+        std::mutex                                                    m_mutex;
+        std::vector<std::unique_ptr<contiguous_virtual_memory_arena>> m_free_arenas;
+        std::size_t                                                   m_arena_count = 0;
+
+        auto give_back(std::unique_ptr<contiguous_virtual_memory_arena> arena) -> void
+        {
+            //Everything in the arena is freed at once, the pages above the high water mark are decommitted
+            arena->rollback(arena_mark { 0 });
+
+            //Room for every arena was reserved when it was made, so this doesn't allocate and can't throw
+            const auto lock = std::lock_guard<std::mutex> { m_mutex };
+            m_free_arenas.push_back(std::move(arena));
+        }
+
+        public:
+        //Each arena reserves `pages_per_arena` pages. Arenas that are given back keep `high_water_mark` bytes committed for the next unit.
+        explicit arena_registry(const std::size_t pages_per_arena, const page_backing backing = page_backing::regular, const std::size_t high_water_mark = contiguous_virtual_memory_arena::no_high_water_mark) 
+            : m_pages_per_arena(pages_per_arena), m_page_backing(backing), m_high_water_mark(high_water_mark)
+        {
+            //Empty
+        }
+
+        arena_registry(const arena_registry&) = delete;
+        arena_registry& operator=(const arena_registry&) = delete;
+
+        //Reuses an arena that was given back or makes a new one
+        [[nodiscard]] auto acquire() -> arena_lease
+        {
+            {
+                const auto lock = std::lock_guard<std::mutex> { m_mutex };
+
+                if (!m_free_arenas.empty())
+                {
+                    auto arena = std::move(m_free_arenas.back());
+                    m_free_arenas.pop_back();
+
+                    return arena_lease { *this, std::move(arena) };
+                }
+            }
+
+            auto arena = std::make_unique<contiguous_virtual_memory_arena>(m_pages_per_arena, m_page_backing);
+            arena->set_high_water_mark(m_high_water_mark);
+
+            {
+                //The arena is only counted once it exists, and there is room to give it back without allocating
+                const auto lock = std::lock_guard<std::mutex> { m_mutex };
+
+                m_free_arenas.reserve(m_arena_count + 1);
+                ++m_arena_count;
+            }
+
+            return arena_lease { *this, std::move(arena) };
+        }
+
+        //Arenas made so far, leased or not
+        [[nodiscard]] auto arena_count() -> std::size_t
+        {
+            const auto lock = std::lock_guard<std::mutex> { m_mutex };
+            return m_arena_count;
+        }
+
+        [[nodiscard]] auto free_arena_count() -> std::size_t
+        {
+            const auto lock = std::lock_guard<std::mutex> { m_mutex };
+            return m_free_arenas.size();
+        }
+    };
+
+    inline auto arena_lease::release() -> void
+    {
+        if (m_arena != nullptr)
+        {
+            m_registry->give_back(std::move(m_arena));
+        }
+    }
+
+    //The arena the calling thread allocates from, null when none was set. See `thread_arena_scope`.
+    inline thread_local contiguous_virtual_memory_arena* current_thread_arena = nullptr;
+
+    //Makes `arena` the arena of the calling thread until the scope ends, then restores the previous one.
+    //Eg: a worker picks up a compilation unit and everything it allocates for it goes to the arena of the unit.
+    class thread_arena_scope
+    {
+        contiguous_virtual_memory_arena* const m_previous_arena;
+
+        public:
+        explicit thread_arena_scope(contiguous_virtual_memory_arena& arena) noexcept : m_previous_arena(std::exchange(current_thread_arena, &arena))
+        {
+            //Empty
+        }
+
+        thread_arena_scope(const thread_arena_scope&) = delete;
+        thread_arena_scope& operator=(const thread_arena_scope&) = delete;
+
+        ~thread_arena_scope()
+        {
+            current_thread_arena = m_previous_arena;
+        }
+    };
+
+    //The arena of the calling thread, one must have been set with `thread_arena_scope`
+    [[nodiscard]] inline auto thread_arena() noexcept -> contiguous_virtual_memory_arena&
+    {
+        assert(current_thread_arena != nullptr);
+        return *current_thread_arena;
+    }
+}
+
+#endif //LCLCOMPILER_ARENA_REGISTRY_HPP
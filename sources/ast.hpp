@@ -1,57 +1,313 @@
 #ifndef LCLCOMPILER_AST_HPP
 #define LCLCOMPILER_AST_HPP
 
-#include <string_view>
-#include <variant>
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <limits>
+#include <new>
+#include <utility>
 
 #include <gsl/span>
-#include <range/v3/view/drop.hpp>
-#include <range/v3/view/filter.hpp>
 
+#include <memory.hpp>
 #include <tokenizer.hpp>
 
 namespace lcl
 {
-    struct ast;
-
-    struct ast_base
+    //The first token of each kind of node is in the comment. The children are in the order they appear in the code.
+    enum class ast_node_kind : std::uint8_t
     {
-        const std::string_view            code;
-        const gsl::span<const lcl::token> tokens;
-    };
+        global_scope,           //The whole file, the children are the top level nodes
 
-    struct global_scope_ast : public ast_base
-    {
-        const gsl::span<const lcl::ast> top_level_nodes;
+        import_statement,       //import Name: * | name, name;
+        imported_module,        //Name
+        imported_name,          //name
+        import_everything,      //*
+
+        constant_declaration,   //name :: value               Children: the value
+        variable_declaration,   //name : type = value;        Children: the type and the value, either can be missing
+        function,               //(parameters) -> type {}     Children: the parameters, the return type if any, the body
+        parameter,              //name: type                  Children: the type
+        struct_definition,      //struct { fields }           Children: the fields
+        union_definition,       //union { fields }            Children: the fields
+        field,                  //name: type;                 Children: the type
+
+        named_type,             //name
+        pointer_type,           //*type                       Children: the type
+
+        block,                  //{ statements }              Children: the statements
+        if_statement,           //if condition statement else statement      Children: the condition, the statement and the else statement if any
+        while_statement,        //while condition statement                  Children: the condition and the statement
+        return_statement,       //return value;               Children: the value if any
+        break_statement,        //break;
+        continue_statement,     //continue;
+        assignment_statement,   //target = value;             The first token is the `=`. Children: the target and the value
+        expression_statement,   //expression;                 Children: the expression
+
+        identifier,             //name
+        numeric_literal,        //1_000
+        string_literal,         //"Hello Sailor!"
+        boolean_literal,        //true | false
+        null_literal,           //null
+        unary_expression,       //-value                      The first token is the operator. Children: the operand
+        binary_expression,      //left + right                The first token is the operator. Children: the operands
+        call_expression,        //callee(arguments)           The first token is the `(`. Children: the callee and the arguments
+        index_expression,       //value[index]                The first token is the `[`. Children: the value and the index
+        member_expression,      //value.name                  The first token is the `.`. Children: the value and the identifier
     };
 
-    //import Name: * | [name, name]
-    struct import_statement_ast : public ast_base
+    using ast_index = std::uint32_t;
+
+    class ast;
+
+    //The direct children of a node, a step from one to the next skips its whole subtree
+    class ast_children
     {
-        auto module_name() const noexcept -> std::string_view 
+        const lcl::ast* m_ast   = nullptr;
+        lcl::ast_index  m_begin = 0;
+        lcl::ast_index  m_end   = 0;
+
+        public:
+        class iterator
+        {
+            const lcl::ast* m_ast   = nullptr;
+            lcl::ast_index  m_index = 0;
+
+            public:
+            using iterator_category = std::forward_iterator_tag;
+            using value_type        = lcl::ast_index;
+            using difference_type   = std::ptrdiff_t;
+            using pointer           = const lcl::ast_index*;
+            using reference         = lcl::ast_index;
+
+            iterator() noexcept = default;
+
+            iterator(const lcl::ast* ast, const lcl::ast_index index) noexcept : m_ast(ast), m_index(index)
+            {
+                //Empty
+            }
+
+            [[nodiscard]] auto operator*() const noexcept -> lcl::ast_index
+            {
+                return m_index;
+            }
+
+            inline auto operator++() noexcept -> iterator&;
+
+            auto operator++(int) noexcept -> iterator
+            {
+                auto copy = *this;
+                ++*this;
+
+                return copy;
+            }
+
+            [[nodiscard]] auto operator==(const iterator& other) const noexcept -> bool
+            {
+                return m_index == other.m_index;
+            }
+
+            [[nodiscard]] auto operator!=(const iterator& other) const noexcept -> bool
+            {
+                return m_index != other.m_index;
+            }
+        };
+
+        ast_children(const lcl::ast* ast, const lcl::ast_index begin, const lcl::ast_index end) noexcept : m_ast(ast), m_begin(begin), m_end(end)
+        {
+            //Empty
+        }
+
+        [[nodiscard]] auto begin() const noexcept -> iterator
         {
-            assert(tokens.size() >= 2);
-            return tokens[1].code;
+            return iterator { m_ast, m_begin };
         }
 
-        auto is_full_import() const noexcept -> bool 
+        [[nodiscard]] auto end() const noexcept -> iterator
         {
-            assert(tokens.size() >= 4);
-            return tokens[3].type == lcl::token_type::star;
+            return iterator { m_ast, m_end };
         }
 
-        auto module_imports() const noexcept
+        [[nodiscard]] auto empty() const noexcept -> bool
         {
-            return tokens | ranges::views::drop(3) 
-                          | ranges::views::filter([](const lcl::token& it) { return it.type != lcl::token_type::comma && it.type != lcl::token_type::semicolon; })
-                          | ranges::views::transform([](const lcl::token& it) { return it.code });
+            return m_begin == m_end;
         }
     };
 
-    struct ast : std::variant<global_scope_ast, import_statement_ast> 
+    //A syntax tree stored as arrays indexed by node. The nodes are in pre-order, every node is followed by its whole subtree
+    //and records the size of it, so a pass is a linear scan of the arrays and skipping a subtree is a single addition.
+    //A node is its kind, the index of its first token and the size of its subtree, 9 bytes.
+    //The arrays are allocated from an arena for `max_node_count` nodes up front, they are freed with the arena and never move.
+    class ast
     {
+        public:
+        static constexpr std::size_t bytes_per_node = sizeof(lcl::ast_node_kind) + sizeof(std::uint32_t) + sizeof(std::uint32_t);
 
+        private:
+        lcl::ast_node_kind*         m_kinds          = nullptr;
+        std::uint32_t*              m_first_tokens   = nullptr;
+        std::uint32_t*              m_subtree_sizes  = nullptr;
+        std::size_t                 m_size           = 0;
+        std::size_t                 m_max_node_count = 0;
+        gsl::span<const lcl::token> m_tokens;
+
+        public:
+        //The tokens and the arena must outlive the tree. Only the pages of the arena that the nodes are written to take memory.
+        ast(const gsl::span<const lcl::token> tokens, const std::size_t max_node_count, lcl::memory::contiguous_virtual_memory_arena& arena) : m_max_node_count(max_node_count), m_tokens(tokens)
+        {
+            assert(max_node_count <= std::numeric_limits<lcl::ast_index>::max());
+
+            m_kinds         = reinterpret_cast<lcl::ast_node_kind*>(arena.allocate(max_node_count * sizeof(lcl::ast_node_kind), alignof(lcl::ast_node_kind)));
+            m_first_tokens  = reinterpret_cast<std::uint32_t*>(arena.allocate(max_node_count * sizeof(std::uint32_t), alignof(std::uint32_t)));
+            m_subtree_sizes = reinterpret_cast<std::uint32_t*>(arena.allocate(max_node_count * sizeof(std::uint32_t), alignof(std::uint32_t)));
+        }
+
+        ast(ast&& other) noexcept : m_kinds(other.m_kinds), m_first_tokens(other.m_first_tokens), m_subtree_sizes(other.m_subtree_sizes), 
+                                    m_size(std::exchange(other.m_size, 0)), m_max_node_count(std::exchange(other.m_max_node_count, 0)), m_tokens(other.m_tokens)
+        {
+            //Empty
+        }
+
+        ast& operator=(ast&& other) noexcept
+        {
+            m_kinds          = other.m_kinds;
+            m_first_tokens   = other.m_first_tokens;
+            m_subtree_sizes  = other.m_subtree_sizes;
+            m_size           = std::exchange(other.m_size, 0);
+            m_max_node_count = std::exchange(other.m_max_node_count, 0);
+            m_tokens         = other.m_tokens;
+
+            return *this;
+        }
+
+        ast(const ast&) = delete;
+        ast& operator=(const ast&) = delete;
+
+        //Starts a node, the nodes added until it is closed are its subtree. Throws `std::bad_alloc` past `max_node_count` nodes.
+        auto open_node(const lcl::ast_node_kind kind, const std::uint32_t first_token) -> lcl::ast_index
+        {
+            assert(first_token <= static_cast<std::size_t>(m_tokens.size()));
+
+            if (m_size == m_max_node_count)
+            {
+                throw std::bad_alloc{};
+            }
+
+            const auto index = static_cast<lcl::ast_index>(m_size);
+
+            m_kinds[index]         = kind;
+            m_first_tokens[index]  = first_token;
+            m_subtree_sizes[index] = 1;
+
+            ++m_size;
+
+            return index;
+        }
+
+        auto close_node(const lcl::ast_index node) noexcept -> void
+        {
+            assert(node < m_size);
+            m_subtree_sizes[node] = static_cast<std::uint32_t>(m_size - node);
+        }
+
+        //A node without children
+        auto add_node(const lcl::ast_node_kind kind, const std::uint32_t first_token) -> lcl::ast_index
+        {
+            return open_node(kind, first_token);
+        }
+
+        //For builders that know the size of the subtree up front, the other nodes of the subtree must be added right after
+        auto add_subtree_root(const lcl::ast_node_kind kind, const std::uint32_t first_token, const std::uint32_t subtree_size) -> lcl::ast_index
+        {
+            assert(subtree_size != 0);
+
+            const auto index = open_node(kind, first_token);
+            m_subtree_sizes[index] = subtree_size;
+
+            return index;
+        }
+
+        //Removes the nodes from `node` on, Eg: to backtrack
+        auto truncate(const lcl::ast_index node) noexcept -> void
+        {
+            m_size = std::min<std::size_t>(m_size, node);
+        }
+
+        [[nodiscard]] auto kind(const lcl::ast_index node) const noexcept -> lcl::ast_node_kind
+        {
+            assert(node < m_size);
+            return m_kinds[node];
+        }
+
+        [[nodiscard]] auto first_token_index(const lcl::ast_index node) const noexcept -> std::uint32_t
+        {
+            assert(node < m_size);
+            return m_first_tokens[node];
+        }
+
+        //A node can point at the end of the tokens when it owns none, Eg: the global scope of code without tokens
+        [[nodiscard]] auto has_first_token(const lcl::ast_index node) const noexcept -> bool
+        {
+            assert(node < m_size);
+            return m_first_tokens[node] < static_cast<std::size_t>(m_tokens.size());
+        }
+
+        //The node must have a first token, see `has_first_token`
+        [[nodiscard]] auto first_token(const lcl::ast_index node) const noexcept -> const lcl::token&
+        {
+            assert(has_first_token(node));
+            return m_tokens[static_cast<std::ptrdiff_t>(m_first_tokens[node])];
+        }
+
+        //The node and every node under it
+        [[nodiscard]] auto subtree_size(const lcl::ast_index node) const noexcept -> std::uint32_t
+        {
+            assert(node < m_size);
+            return m_subtree_sizes[node];
+        }
+
+        //The next node that isn't under `node`
+        [[nodiscard]] auto subtree_end(const lcl::ast_index node) const noexcept -> lcl::ast_index
+        {
+            assert(node < m_size);
+            return node + m_subtree_sizes[node];
+        }
+
+        [[nodiscard]] auto children(const lcl::ast_index node) const noexcept -> lcl::ast_children
+        {
+            return lcl::ast_children { this, node + 1, subtree_end(node) };
+        }
+
+        //Every node in pre-order, for passes that scan for a kind of node
+        [[nodiscard]] auto kinds() const noexcept -> gsl::span<const lcl::ast_node_kind>
+        {
+            return gsl::span<const lcl::ast_node_kind> { m_kinds, m_size };
+        }
+
+        [[nodiscard]] auto tokens() const noexcept -> gsl::span<const lcl::token>
+        {
+            return m_tokens;
+        }
+
+        [[nodiscard]] auto size() const noexcept -> std::size_t
+        {
+            return m_size;
+        }
+
+        [[nodiscard]] auto empty() const noexcept -> bool
+        {
+            return m_size == 0;
+        }
     };
+
+    inline auto ast_children::iterator::operator++() noexcept -> iterator&
+    {
+        m_index = m_ast->subtree_end(m_index);
+        return *this;
+    }
 }
 
-#endif //LCLCOMPILER_AST_HPP
\ No newline at end of file
+#endif //LCLCOMPILER_AST_HPP
@@ -0,0 +1,112 @@
+#ifndef LCLCOMPILER_BATCH_TOKENIZER_HPP
+#define LCLCOMPILER_BATCH_TOKENIZER_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
+#include <mutex>
+#include <optional>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include <gsl/span>
+#include <tl/expected.hpp>
+
+#include <arena_registry.hpp>
+#include <tokenizer.hpp>
+
+namespace lcl
+{
+    [[nodiscard]] inline auto default_worker_count() noexcept -> std::size_t
+    {
+        const auto hardware_thread_count = std::thread::hardware_concurrency();
+
+        return hardware_thread_count == 0 ? 1 : hardware_thread_count;
+    }
+
+    //Tokenizes batches of files like `tokenize_code` does, on `worker_count` threads including the calling one.
+    //The threads are started once with the pool and wait for the next batch, so many small batches don't pay for starting threads.
+    //The files are handed out one at a time, so a few large files don't leave the other workers waiting.
+    //Every worker leases two arenas: one for the padded copy of the file it is on, rolled back after each file, and one its tokens are written to.
+    //Eg:
+    //  auto pool = lcl::tokenizer_pool{};
+    //  for (const auto& files : batches)
+    //  {
+    //      const auto results = pool.tokenize(files);
+    //      ...use the results before the next batch
+    //  }
+    class tokenizer_pool
+    {
+        public:
+        using file_result = tl::expected<gsl::span<const lcl::token>, lcl::tokenizer_error>;
+
+        //Only reserved, the pages are committed when the tokens of a batch need them
+        static constexpr std::size_t default_bytes_per_arena = std::size_t { 1 } << 30;
+
+        private:
+        struct worker_arenas
+        {
+            lcl::memory::arena_lease scratch;
+            lcl::memory::arena_lease tokens;
+        };
+
+        lcl::memory::arena_registry m_arenas;
+        std::vector<worker_arenas>  m_worker_arenas;  //The calling thread works with the first ones
+        std::vector<std::thread>    m_threads;
+
+        std::mutex              m_mutex;
+        std::condition_variable m_batch_ready;
+        std::condition_variable m_batch_done;
+        std::size_t             m_batch_number = 0;
+        std::size_t             m_busy_threads = 0;
+        bool                    m_stopping     = false;
+
+        //The batch being tokenized
+        gsl::span<const std::string_view>        m_files;
+        std::vector<std::optional<file_result>>* m_results = nullptr;
+        std::atomic<std::size_t>                 m_next_file_index { 0 };
+
+        //An exception escaping a thread terminates, the first one a worker throws is kept and rethrown by `tokenize`
+        std::exception_ptr m_first_exception;
+        std::mutex         m_first_exception_mutex;
+
+        auto run_thread(const std::size_t worker_index) -> void;
+        auto work(const std::size_t worker_index) -> void;
+        auto tokenize_files(const std::size_t worker_index) -> void;
+        auto stop_threads() -> void;
+
+        public:
+        explicit tokenizer_pool(const std::size_t worker_count = lcl::default_worker_count(), const std::size_t bytes_per_arena = default_bytes_per_arena);
+
+        tokenizer_pool(const tokenizer_pool&) = delete;
+        tokenizer_pool& operator=(const tokenizer_pool&) = delete;
+
+        ~tokenizer_pool();
+
+        //The results are in the order of `files`. The errors and the code of the tokens refer to the caller's code, which must outlive them.
+        //The tokens are in the arenas of the workers, they are valid until the next call or until the pool is destroyed.
+        [[nodiscard]] auto tokenize(const gsl::span<const std::string_view> files) -> std::vector<file_result>;
+
+        [[nodiscard]] auto worker_count() const noexcept -> std::size_t
+        {
+            return m_worker_arenas.size();
+        }
+
+        //Bytes taken by the tokens of the last batch, summed over the workers
+        [[nodiscard]] auto token_bytes() const noexcept -> std::size_t
+        {
+            auto bytes = std::size_t { 0 };
+
+            for (const auto& arenas : m_worker_arenas)
+            {
+                bytes += arenas.tokens.arena().used_bytes();
+            }
+
+            return bytes;
+        }
+    };
+}
+
+#endif //LCLCOMPILER_BATCH_TOKENIZER_HPP
@@ -0,0 +1,605 @@
+#ifndef LCLCOMPILER_FLAT_HASH_MAP_HPP
+#define LCLCOMPILER_FLAT_HASH_MAP_HPP
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <new>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+#include <simd.hpp>
+
+namespace lcl
+{
+    //An open addressing hash map in the style of the Swiss tables. Every slot has a control byte that is either empty, deleted,
+    //or the low 7 bits of the hash of its key. A lookup compares the control bytes of 16 slots at once (with SSE2 when available)
+    //and only compares keys for the slots whose 7 bits match, so a miss rarely touches a key at all.
+    //Takes any allocator, such as `lcl::memory::virtual_arena_allocator` to put the table in an arena. The arena doesn't free,
+    //so reserve the expected size up front to avoid leaving the smaller tables behind in it.
+    //Keys are copied when the table grows, which is nothing for the identifier views the compiler uses as keys.
+    template <class Key, class Value, class Hash = std::hash<Key>, class KeyEqual = std::equal_to<Key>, class Allocator = std::allocator<std::pair<const Key, Value>>> class flat_hash_map
+    {
+        public:
+        using key_type        = Key;
+        using mapped_type     = Value;
+        using value_type      = std::pair<const Key, Value>;
+        using hasher          = Hash;
+        using key_equal       = KeyEqual;
+        using allocator_type  = Allocator;
+        using size_type       = std::size_t;
+        using difference_type = std::ptrdiff_t;
+
+        static constexpr std::size_t group_size       = 16;
+        static constexpr std::size_t minimum_capacity = group_size;
+
+        private:
+        using control_byte = std::int8_t;
+
+        using slot_allocator            = typename std::allocator_traits<Allocator>::template rebind_alloc<value_type>;
+        using slot_allocator_traits     = std::allocator_traits<slot_allocator>;
+        using control_allocator         = typename std::allocator_traits<Allocator>::template rebind_alloc<control_byte>;
+        using control_allocator_traits  = std::allocator_traits<control_allocator>;
+
+        static constexpr control_byte empty_control   = -128; //0b10000000
+        static constexpr control_byte deleted_control = -2;   //0b11111110
+
+        //Shared by every empty map so that lookups don't have to check for a missing table
+        alignas(group_size) static inline const control_byte empty_group[group_size] =
+        {
+            empty_control, empty_control, empty_control, empty_control, empty_control, empty_control, empty_control, empty_control,
+            empty_control, empty_control, empty_control, empty_control, empty_control, empty_control, empty_control, empty_control
+        };
+
+        //`capacity + group_size - 1` control bytes, the last ones mirror the first ones so that a group can start at any slot
+        control_byte* m_controls    = const_cast<control_byte*>(empty_group);
+        value_type*   m_slots       = nullptr;
+        std::size_t   m_size        = 0;
+        std::size_t   m_capacity    = 0;
+        std::size_t   m_growth_left = 0;
+        Hash          m_hash;
+        KeyEqual      m_key_equal;
+        Allocator     m_allocator;
+
+        [[nodiscard]] static auto is_full(const control_byte control) noexcept -> bool
+        {
+            return control >= 0;
+        }
+
+        //A bit for every byte in the group that is equal to `control`
+        [[nodiscard]] static auto match(const control_byte* group, const control_byte control) noexcept -> std::uint32_t
+        {
+            #if LCL_SSE2
+                const auto bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(group));
+                return static_cast<std::uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(bytes, _mm_set1_epi8(control))));
+            #else
+                auto mask = std::uint32_t { 0 };
+
+                for (auto i = std::size_t { 0 }; i < group_size; ++i)
+                {
+                    mask |= static_cast<std::uint32_t>(group[i] == control) << i;
+                }
+
+                return mask;
+            #endif
+        }
+
+        //A bit for every byte in the group that is empty or deleted, both have their high bit set
+        [[nodiscard]] static auto match_free(const control_byte* group) noexcept -> std::uint32_t
+        {
+            #if LCL_SSE2
+                return static_cast<std::uint32_t>(_mm_movemask_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(group))));
+            #else
+                auto mask = std::uint32_t { 0 };
+
+                for (auto i = std::size_t { 0 }; i < group_size; ++i)
+                {
+                    mask |= static_cast<std::uint32_t>(group[i] < 0) << i;
+                }
+
+                return mask;
+            #endif
+        }
+
+        //The low 7 bits go in the control byte, the rest pick the first group
+        [[nodiscard]] static auto hash_control(const std::size_t hash) noexcept -> control_byte
+        {
+            return static_cast<control_byte>(hash & 0x7F);
+        }
+
+        [[nodiscard]] static auto hash_position(const std::size_t hash) noexcept -> std::size_t
+        {
+            return hash >> 7;
+        }
+
+        [[nodiscard]] static auto max_load(const std::size_t capacity) noexcept -> std::size_t
+        {
+            return capacity - capacity / 8;
+        }
+
+        [[nodiscard]] auto hash_of(const Key& key) const -> std::size_t
+        {
+            //Mixes the bits, `std::hash` is the identity for integers on most standard libraries
+            const auto hash = static_cast<std::uint64_t>(m_hash(key)) * 0x9E3779B97F4A7C15u;
+            return static_cast<std::size_t>(hash ^ (hash >> 32));
+        }
+
+        auto set_control(const std::size_t index, const control_byte control) noexcept -> void
+        {
+            m_controls[index] = control;
+
+            if (index < group_size - 1)
+            {
+                m_controls[m_capacity + index] = control;
+            }
+        }
+
+        //Visits the groups in triangular steps, which reaches every group of a power of two table
+        template <class Visitor> auto probe(const std::size_t hash, Visitor&& visitor) const -> std::size_t
+        {
+            const auto mask     = m_capacity - 1;
+            auto       position = hash_position(hash) & mask;
+
+            for (auto step = group_size;; step += group_size)
+            {
+                const auto index = visitor(m_controls + position, position);
+
+                if (index != std::size_t(-1))
+                {
+                    return index;
+                }
+
+                position = (position + step) & mask;
+            }
+        }
+
+        //The slot of `key`, or `capacity()` when it isn't in the map
+        [[nodiscard]] auto find_index(const Key& key, const std::size_t hash) const -> std::size_t
+        {
+            if (m_capacity == 0)
+            {
+                return 0;
+            }
+
+            const auto control = hash_control(hash);
+            const auto mask    = m_capacity - 1;
+
+            return probe(hash, [&](const control_byte* group, const std::size_t position)
+            {
+                for (auto matches = match(group, control); matches != 0; matches &= matches - 1)
+                {
+                    const auto index = (position + static_cast<std::size_t>(lcl::simd::count_trailing_zeros(matches))) & mask;
+
+                    if (m_key_equal(m_slots[index].first, key))
+                    {
+                        return index;
+                    }
+                }
+
+                //A key is never placed past an empty slot of its probe sequence
+                return match(group, empty_control) != 0 ? m_capacity : std::size_t(-1);
+            });
+        }
+
+        //The first empty or deleted slot on the probe sequence of `hash`
+        [[nodiscard]] auto find_free_index(const std::size_t hash) const noexcept -> std::size_t
+        {
+            const auto mask = m_capacity - 1;
+
+            return probe(hash, [&](const control_byte* group, const std::size_t position)
+            {
+                const auto frees = match_free(group);
+
+                return frees != 0 ? (position + static_cast<std::size_t>(lcl::simd::count_trailing_zeros(frees))) & mask : std::size_t(-1);
+            });
+        }
+
+        //Moves every element to a new table of `new_capacity` slots, which drops the deleted slots
+        auto rehash(const std::size_t new_capacity) -> void
+        {
+            assert(new_capacity >= minimum_capacity && (new_capacity & (new_capacity - 1)) == 0 && max_load(new_capacity) >= m_size);
+
+            auto controls_allocator = control_allocator(m_allocator);
+            auto slots_allocator    = slot_allocator(m_allocator);
+
+            const auto old_controls = m_controls;
+            const auto old_slots    = m_slots;
+            const auto old_capacity = m_capacity;
+
+            //Both arrays are allocated before the map changes, so it is left as it was when either allocation throws
+            const auto new_controls = control_allocator_traits::allocate(controls_allocator, new_capacity + group_size - 1);
+            auto       new_slots    = static_cast<value_type*>(nullptr);
+
+            try
+            {
+                new_slots = slot_allocator_traits::allocate(slots_allocator, new_capacity);
+            }
+            catch (...)
+            {
+                control_allocator_traits::deallocate(controls_allocator, new_controls, new_capacity + group_size - 1);
+                throw;
+            }
+
+            m_controls = new_controls;
+            m_slots    = new_slots;
+            m_capacity = new_capacity;
+
+            std::memset(m_controls, static_cast<std::uint8_t>(empty_control), new_capacity + group_size - 1);
+
+            for (auto i = std::size_t { 0 }; i < old_capacity; ++i)
+            {
+                if (is_full(old_controls[i]))
+                {
+                    const auto hash  = hash_of(old_slots[i].first);
+                    const auto index = find_free_index(hash);
+
+                    slot_allocator_traits::construct(slots_allocator, m_slots + index, std::move(old_slots[i]));
+                    slot_allocator_traits::destroy(slots_allocator, old_slots + i);
+                    set_control(index, hash_control(hash));
+                }
+            }
+
+            m_growth_left = max_load(new_capacity) - m_size;
+
+            free_table(old_controls, old_slots, old_capacity);
+        }
+
+        auto free_table(control_byte* controls, value_type* slots, const std::size_t capacity) noexcept -> void
+        {
+            if (capacity == 0)
+            {
+                return;
+            }
+
+            auto controls_allocator = control_allocator(m_allocator);
+            auto slots_allocator    = slot_allocator(m_allocator);
+
+            control_allocator_traits::deallocate(controls_allocator, controls, capacity + group_size - 1);
+            slot_allocator_traits::deallocate(slots_allocator, slots, capacity);
+        }
+
+        //Makes room for one more element, reusing the deleted slots when they are a large part of the table
+        auto grow() -> void
+        {
+            if (m_capacity == 0)
+            {
+                rehash(minimum_capacity);
+            }
+            else if (m_size <= max_load(m_capacity) / 2)
+            {
+                rehash(m_capacity);
+            }
+            else
+            {
+                rehash(m_capacity * 2);
+            }
+        }
+
+        auto destroy_elements() noexcept -> void
+        {
+            auto slots_allocator = slot_allocator(m_allocator);
+
+            for (auto i = std::size_t { 0 }; i < m_capacity; ++i)
+            {
+                if (is_full(m_controls[i]))
+                {
+                    slot_allocator_traits::destroy(slots_allocator, m_slots + i);
+                }
+            }
+        }
+
+        template <class Self, class Element> class basic_iterator
+        {
+            friend class flat_hash_map;
+
+            Self*       m_map   = nullptr;
+            std::size_t m_index = 0;
+
+            basic_iterator(Self* map, const std::size_t index) noexcept : m_map(map), m_index(index)
+            {
+                skip_free_slots();
+            }
+
+            auto skip_free_slots() noexcept -> void
+            {
+                while (m_index < m_map->m_capacity && !is_full(m_map->m_controls[m_index]))
+                {
+                    ++m_index;
+                }
+            }
+
+            public:
+            using iterator_category = std::forward_iterator_tag;
+            using value_type        = flat_hash_map::value_type;
+            using difference_type   = std::ptrdiff_t;
+            using pointer           = Element*;
+            using reference         = Element&;
+
+            basic_iterator() noexcept = default;
+
+            //Iterator to const_iterator
+            template <class OtherSelf, class OtherElement, class = std::enable_if_t<std::is_const_v<Element> && !std::is_const_v<OtherElement>>>
+            basic_iterator(const basic_iterator<OtherSelf, OtherElement>& other) noexcept : m_map(other.m_map), m_index(other.m_index)
+            {
+                //Empty
+            }
+
+            [[nodiscard]] auto operator*() const noexcept -> reference
+            {
+                return m_map->m_slots[m_index];
+            }
+
+            [[nodiscard]] auto operator->() const noexcept -> pointer
+            {
+                return m_map->m_slots + m_index;
+            }
+
+            auto operator++() noexcept -> basic_iterator&
+            {
+                ++m_index;
+                skip_free_slots();
+
+                return *this;
+            }
+
+            auto operator++(int) noexcept -> basic_iterator
+            {
+                auto copy = *this;
+                ++*this;
+
+                return copy;
+            }
+
+            [[nodiscard]] auto operator==(const basic_iterator& other) const noexcept -> bool
+            {
+                return m_index == other.m_index;
+            }
+
+            [[nodiscard]] auto operator!=(const basic_iterator& other) const noexcept -> bool
+            {
+                return m_index != other.m_index;
+            }
+
+            template <class, class> friend class basic_iterator;
+        };
+
+        public:
+        using iterator       = basic_iterator<flat_hash_map, value_type>;
+        using const_iterator = basic_iterator<const flat_hash_map, const value_type>;
+
+        flat_hash_map() = default;
+
+        explicit flat_hash_map(const Allocator& allocator) : m_allocator(allocator)
+        {
+            //Empty
+        }
+
+        flat_hash_map(const std::size_t capacity, const Allocator& allocator) : m_allocator(allocator)
+        {
+            reserve(capacity);
+        }
+
+        flat_hash_map(const flat_hash_map& other) : m_hash(other.m_hash), m_key_equal(other.m_key_equal),
+                                                    m_allocator(std::allocator_traits<Allocator>::select_on_container_copy_construction(other.m_allocator))
+        {
+            reserve(other.m_size);
+
+            for (const auto& element : other)
+            {
+                try_emplace(element.first, element.second);
+            }
+        }
+
+        flat_hash_map(flat_hash_map&& other) noexcept : m_controls(std::exchange(other.m_controls, const_cast<control_byte*>(empty_group))),
+                                                        m_slots(std::exchange(other.m_slots, nullptr)),
+                                                        m_size(std::exchange(other.m_size, 0)),
+                                                        m_capacity(std::exchange(other.m_capacity, 0)),
+                                                        m_growth_left(std::exchange(other.m_growth_left, 0)),
+                                                        m_hash(other.m_hash),
+                                                        m_key_equal(other.m_key_equal),
+                                                        m_allocator(other.m_allocator)
+        {
+            //Empty
+        }
+
+        flat_hash_map& operator=(flat_hash_map other) noexcept
+        {
+            //The allocator always moves with the table, which frees it
+            swap(other);
+            return *this;
+        }
+
+        auto swap(flat_hash_map& other) noexcept -> void
+        {
+            using std::swap;
+
+            swap(m_controls, other.m_controls);
+            swap(m_slots, other.m_slots);
+            swap(m_size, other.m_size);
+            swap(m_capacity, other.m_capacity);
+            swap(m_growth_left, other.m_growth_left);
+            swap(m_hash, other.m_hash);
+            swap(m_key_equal, other.m_key_equal);
+            swap(m_allocator, other.m_allocator);
+        }
+
+        //Inserts `Value(args...)` under `key` unless the key is already in the map, in which case nothing is constructed
+        template <class... Args> auto try_emplace(const Key& key, Args&&... args) -> std::pair<iterator, bool>
+        {
+            const auto hash = hash_of(key);
+
+            if (const auto index = find_index(key, hash); index != m_capacity)
+            {
+                return { iterator { this, index }, false };
+            }
+
+            auto index = m_capacity == 0 ? 0 : find_free_index(hash);
+
+            //Only filling an empty slot uses up growth, a deleted one was already counted
+            if (m_capacity == 0 || (m_growth_left == 0 && m_controls[index] == empty_control))
+            {
+                grow();
+                index = find_free_index(hash);
+            }
+
+            auto slots_allocator = slot_allocator(m_allocator);
+
+            slot_allocator_traits::construct(slots_allocator, m_slots + index, std::piecewise_construct, std::forward_as_tuple(key), std::forward_as_tuple(std::forward<Args>(args)...));
+
+            m_growth_left -= m_controls[index] == empty_control;
+            set_control(index, hash_control(hash));
+            ++m_size;
+
+            return { iterator { this, index }, true };
+        }
+
+        auto insert(const value_type& element) -> std::pair<iterator, bool>
+        {
+            return try_emplace(element.first, element.second);
+        }
+
+        //Replaces the value of `key` when it is already in the map
+        template <class V> auto insert_or_assign(const Key& key, V&& value) -> std::pair<iterator, bool>
+        {
+            auto result = try_emplace(key, std::forward<V>(value));
+
+            if (!result.second)
+            {
+                result.first->second = std::forward<V>(value);
+            }
+
+            return result;
+        }
+
+        [[nodiscard]] auto operator[](const Key& key) -> Value&
+        {
+            return try_emplace(key).first->second;
+        }
+
+        [[nodiscard]] auto find(const Key& key) -> iterator
+        {
+            return iterator { this, find_index(key, hash_of(key)) };
+        }
+
+        [[nodiscard]] auto find(const Key& key) const -> const_iterator
+        {
+            return const_iterator { this, find_index(key, hash_of(key)) };
+        }
+
+        [[nodiscard]] auto contains(const Key& key) const -> bool
+        {
+            return find_index(key, hash_of(key)) != m_capacity;
+        }
+
+        [[nodiscard]] auto count(const Key& key) const -> std::size_t
+        {
+            return contains(key) ? 1 : 0;
+        }
+
+        //Returns the number of erased elements, 0 or 1
+        auto erase(const Key& key) -> std::size_t
+        {
+            const auto index = find_index(key, hash_of(key));
+
+            if (index == m_capacity)
+            {
+                return 0;
+            }
+
+            erase(iterator { this, index });
+            return 1;
+        }
+
+        //Returns the iterator to the next element
+        auto erase(const const_iterator position) -> iterator
+        {
+            assert(position.m_map == this && position.m_index < m_capacity && is_full(m_controls[position.m_index]));
+
+            auto slots_allocator = slot_allocator(m_allocator);
+
+            slot_allocator_traits::destroy(slots_allocator, m_slots + position.m_index);
+
+            //Leaves a tombstone so that the keys placed after this slot are still found, `grow` clears them
+            set_control(position.m_index, deleted_control);
+            --m_size;
+
+            return iterator { this, position.m_index + 1 };
+        }
+
+        //Keeps the table
+        auto clear() noexcept -> void
+        {
+            if (m_capacity == 0)
+            {
+                return;
+            }
+
+            destroy_elements();
+            std::memset(m_controls, static_cast<std::uint8_t>(empty_control), m_capacity + group_size - 1);
+
+            m_size        = 0;
+            m_growth_left = max_load(m_capacity);
+        }
+
+        //Makes room for `size` elements without growing again
+        auto reserve(const std::size_t size) -> void
+        {
+            auto capacity = std::max(m_capacity, minimum_capacity);
+
+            while (max_load(capacity) < size)
+            {
+                capacity *= 2;
+            }
+
+            if (capacity != m_capacity)
+            {
+                rehash(capacity);
+            }
+        }
+
+        [[nodiscard]] auto begin() noexcept -> iterator                { return iterator { this, 0 }; }
+        [[nodiscard]] auto begin() const noexcept -> const_iterator    { return const_iterator { this, 0 }; }
+        [[nodiscard]] auto end() noexcept -> iterator                  { return iterator { this, m_capacity }; }
+        [[nodiscard]] auto end() const noexcept -> const_iterator      { return const_iterator { this, m_capacity }; }
+
+        [[nodiscard]] auto size() const noexcept -> std::size_t
+        {
+            return m_size;
+        }
+
+        [[nodiscard]] auto empty() const noexcept -> bool
+        {
+            return m_size == 0;
+        }
+
+        //Slots in the table, always 0 or a power of two
+        [[nodiscard]] auto capacity() const noexcept -> std::size_t
+        {
+            return m_capacity;
+        }
+
+        [[nodiscard]] auto load_factor() const noexcept -> float
+        {
+            return m_capacity == 0 ? 0.0f : static_cast<float>(m_size) / static_cast<float>(m_capacity);
+        }
+
+        [[nodiscard]] auto get_allocator() const noexcept -> Allocator
+        {
+            return m_allocator;
+        }
+
+        ~flat_hash_map()
+        {
+            destroy_elements();
+            free_table(m_controls, m_slots, m_capacity);
+        }
+    };
+}
+
+#endif //LCLCOMPILER_FLAT_HASH_MAP_HPP
@@ -0,0 +1,30 @@
+#ifndef LCLCOMPILER_IMPORT_PRESCAN_HPP
+#define LCLCOMPILER_IMPORT_PRESCAN_HPP
+
+#include <string_view>
+#include <vector>
+
+#include <tl/expected.hpp>
+
+#include <source_buffer.hpp>
+#include <tokenizer.hpp>
+
+namespace lcl
+{
+    //import Name: * | [name, name]
+    //What `import_statement_ast` holds, without needing the tokens of the statement.
+    struct module_import
+    {
+        std::string_view              module_name;
+        bool                          is_full_import = false;
+        std::vector<std::string_view> imported_names;   //Empty for a full import
+    };
+
+    //Tokenizes only the import statements at the top of `code` and returns them, for a build planner that needs the dependencies of a file.
+    //Comments between the statements are skipped and `#if` directives are evaluated against `defined_symbols` like in `tokenize_code`.
+    //Tokenizing stops on the first token that does not belong to an import statement, the rest of the code is not looked at, 
+    //so errors after it are not reported. A malformed import statement also stops the prescan and is left out, the parser reports it later.
+    [[nodiscard]] auto prescan_imports(const lcl::source_buffer& code, const std::vector<std::string_view>& defined_symbols = {}) -> tl::expected<std::vector<lcl::module_import>, lcl::tokenizer_error>;
+}
+
+#endif //LCLCOMPILER_IMPORT_PRESCAN_HPP
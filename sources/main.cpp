@@ -1,26 +1,217 @@
-#include <cassert>
+#include <algorithm>
+#include <charconv>
+#include <chrono>
+#include <cstddef>
+#include <cstdio>
+#include <filesystem>
+#include <iterator>
+#include <limits>
+#include <optional>
+#include <string>
 #include <string_view>
+#include <vector>
 
 #include <fmt/core.h>
 #include <fmt/format.h>
 #include <magic_enum.hpp>
 #include <gsl/span>
+#include <tl/expected.hpp>
 
-#include <tokenizer.hpp>
 #include <ast.hpp>
+#include <memory.hpp>
+#include <module_store.hpp>
+#include <parser.hpp>
+#include <source_file.hpp>
+#include <tokenizer.hpp>
 
+using namespace std::string_literals;
 using namespace std::string_view_literals;
 
-auto main() -> int
+struct driver_options
+{
+    std::size_t              memory_budget = lcl::module_store::unlimited_memory_budget;
+    bool                     arena_stats   = false;
+    std::vector<std::string> files;
+};
+
+//A number of bytes with an optional K, M or G suffix, Eg: 512M
+[[nodiscard]] static auto parse_byte_count(const std::string_view& text) -> std::optional<std::size_t>
+{
+    auto       count  = std::size_t { 0 };
+    const auto result = std::from_chars(text.data(), text.data() + text.size(), count);
+
+    if (result.ec != std::errc{} || result.ptr == text.data())
+    {
+        return std::nullopt;
+    }
+
+    const auto suffix = text.substr(static_cast<std::size_t>(result.ptr - text.data()));
+    auto       shift  = 0;
+
+    if      (suffix == "K"sv) shift = 10;
+    else if (suffix == "M"sv) shift = 20;
+    else if (suffix == "G"sv) shift = 30;
+    else if (!suffix.empty()) return std::nullopt;
+
+    //A budget too big to count in bytes is not one
+    if (count > (std::numeric_limits<std::size_t>::max() >> shift))
+    {
+        return std::nullopt;
+    }
+
+    return count << shift;
+}
+
+static auto print_arena_telemetry(const std::string_view& name, const lcl::memory::arena_telemetry& telemetry) -> void
+{
+    fmt::print("{}: {} reserved, {} committed, {} peak committed, {} used\n", name, telemetry.reserved_bytes, telemetry.committed_bytes, telemetry.peak_committed_bytes, telemetry.used_bytes);
+    fmt::print("{}: {} allocations, {} requested, {} alignment padding\n", name, telemetry.allocation_count, telemetry.requested_bytes, telemetry.alignment_padding_bytes);
+    fmt::print("{}: {} commits, {} decommits, {} releases of {} bytes\n", name, telemetry.commit_count, telemetry.decommit_count, telemetry.release_count, telemetry.released_bytes);
+}
+
+[[nodiscard]] static auto parse_command_line(const gsl::span<char*> arguments) -> tl::expected<driver_options, std::string>
 {
-    const auto code                = "import Print: print, printf;"sv;
-    const auto tokens              = lcl::tokenize_code(code).value();
-    const auto ast                 = lcl::import_statement_ast { code, tokens };
+    auto options = driver_options{};
+
+    for (auto it = std::begin(arguments); it != std::end(arguments); ++it)
+    {
+        const auto argument = std::string_view { *it };
+
+        if (argument == "--memory-budget"sv || argument.substr(0, 16) == "--memory-budget="sv)
+        {
+            if (argument.size() == 15 && std::next(it) == std::end(arguments))
+            {
+                return tl::unexpected("--memory-budget needs a size, Eg: --memory-budget 512M"s);
+            }
+
+            const auto value         = argument.size() == 15 ? std::string_view { *++it } : argument.substr(16);
+            const auto memory_budget = parse_byte_count(value);
+
+            if (!memory_budget)
+            {
+                return tl::unexpected(fmt::format("'{}' is not a memory budget, Eg: 512M", value));
+            }
+
+            options.memory_budget = *memory_budget;
+        }
+        else if (argument == "--arena-stats"sv)
+        {
+            options.arena_stats = true;
+        }
+        else if (argument.substr(0, 2) == "--"sv)
+        {
+            return tl::unexpected(fmt::format("Unknown option '{}'", argument));
+        }
+        else
+        {
+            options.files.emplace_back(argument);
+        }
+    }
+
+    if (options.files.empty())
+    {
+        return tl::unexpected("No files to compile"s);
+    }
+
+    return options;
+}
+
+auto main(int argc, char** argv) -> int
+{
+    const auto options = parse_command_line(gsl::span<char*> { argv + 1, static_cast<std::size_t>(argc - 1) });
+
+    if (!options)
+    {
+        fmt::print(stderr, "{}\nUsage: lcl [--memory-budget <bytes>[K|M|G]] [--arena-stats] <files>\n", options.error());
+        return 1;
+    }
+
+    //Unique to this build, so that builds running side by side don't share spill files
+    const auto spill_directory = std::filesystem::temp_directory_path() / fmt::format("lcl_modules_{}", std::chrono::steady_clock::now().time_since_epoch().count());
+
+    auto modules = lcl::module_store { options->memory_budget, spill_directory };
+
+    //Holds the AST of the file being compiled, only reserved so it can be far bigger than any file
+    auto ast_arena = lcl::memory::contiguous_virtual_memory_arena { (std::size_t { 4 } << 30) / lcl::memory::get_page_size() };
+
+    for (const auto& path : options->files)
+    {
+        //The AST of the previous file is no longer used
+        ast_arena.reset();
+
+        auto       source = lcl::source_file { path };
+        const auto buffer = source.load();
+
+        if (!buffer)
+        {
+            fmt::print(stderr, "{}: {}\n", path, buffer.error().message());
+            return 1;
+        }
+
+        const auto tokens = lcl::tokenize_code(**buffer);
+
+        if (!tokens)
+        {
+            //The iterator can be the end of the code, so it is turned into a pointer without being dereferenced
+            const auto error_offset = std::distance(std::cbegin((*buffer)->padded_code()), tokens.error().iterator_when_error_occured);
+            const auto location     = lcl::source_file::location_of(**buffer, std::string_view { (*buffer)->data() + error_offset, 0 });
+            fmt::print(stderr, "{}: {} at\n{}\n", path, magic_enum::enum_name(tokens.error().error_type), source.lines_at(location).value_or(""));
+            return 1;
+        }
+
+        const auto ast = lcl::parse_tokens(*tokens, ast_arena);
+
+        if (!ast)
+        {
+            //At the end of the code the error is reported on the last line
+            const auto  error_token = std::min(static_cast<std::size_t>(ast.error().token_index), tokens->size() - 1);
+            const auto& code        = (*tokens)[error_token].code;
+            const auto  location    = lcl::source_file::location_of(**buffer, code);
+            fmt::print(stderr, "{}: {} at line {}\n{}\n", path, magic_enum::enum_name(ast.error().error_type), (*tokens)[error_token].line, source.lines_at(location).value_or(""));
+            return 1;
+        }
+
+        //The imports are already in the tree, there is no need to tokenize the file again with `prescan_imports`
+        const auto kinds = ast->kinds();
+
+        for (auto i = lcl::ast_index { 0 }; i < kinds.size(); ++i)
+        {
+            if (kinds[i] == lcl::ast_node_kind::imported_module)
+            {
+                fmt::print("{} imports {}\n", path, ast->first_token(i).code);
+            }
+        }
+
+        //The store keeps its own copy of the code, so the buffer is freed with `source` at the end of the iteration
+        if (const auto added = modules.add(path, *tokens); !added)
+        {
+            fmt::print(stderr, "Could not spill modules to {}: {}\n", spill_directory.string(), added.error().message());
+            return 1;
+        }
+    }
+
+    auto token_count = std::size_t { 0 };
+
+    for (auto i = std::size_t { 0 }; i < modules.module_count(); ++i)
+    {
+        const auto tokens = modules.tokens(i);
+
+        if (!tokens)
+        {
+            fmt::print(stderr, "Could not reload {}: {}\n", modules.name(i), tokens.error().message());
+            return 1;
+        }
+
+        token_count += static_cast<std::size_t>(tokens->size());
+    }
+
+    fmt::print("{} modules, {} tokens, {} spilled, {} reloaded\n", modules.module_count(), token_count, modules.spill_count(), modules.reload_count());
 
-    for (const auto& it : ast.module_imports())
+    if (options->arena_stats)
     {
-        fmt::print("{} ", it);
+        //In bytes, to size the arenas from real builds
+        print_arena_telemetry("AST arena"sv, ast_arena.telemetry());
     }
 
     return 0;
-}
\ No newline at end of file
+}
@@ -1,11 +1,52 @@
 #ifndef LCLCOMPILER_ALLOCATORS_HPP
 #define LCLCOMPILER_ALLOCATORS_HPP
 
+#include <algorithm>
 #include <cstddef>
+#include <cstdint>
 #include <cassert>
+#include <new>
+#include <type_traits>
+
+#if defined(__has_feature)
+    #if __has_feature(address_sanitizer)
+        #define LCL_ASAN 1
+    #endif
+#endif
+
+#if !defined(LCL_ASAN) && defined(__SANITIZE_ADDRESS__)
+    #define LCL_ASAN 1
+#endif
+
+#if defined(LCL_ASAN)
+    #include <sanitizer/asan_interface.h>
+#else
+    #define LCL_ASAN 0
+#endif
 
 namespace lcl::memory
 {
+    //In ASan builds reading or writing poisoned memory is reported, in other builds these do nothing
+    inline auto poison_memory(const void* begin, const std::size_t size) noexcept -> void
+    {
+        #if LCL_ASAN
+            ASAN_POISON_MEMORY_REGION(begin, size);
+        #else
+            static_cast<void>(begin);
+            static_cast<void>(size);
+        #endif
+    }
+
+    inline auto unpoison_memory(const void* begin, const std::size_t size) noexcept -> void
+    {
+        #if LCL_ASAN
+            ASAN_UNPOISON_MEMORY_REGION(begin, size);
+        #else
+            static_cast<void>(begin);
+            static_cast<void>(size);
+        #endif
+    }
+
     [[nodiscard]] auto get_page_size() -> std::size_t;
     [[nodiscard]] auto reserve_memory_pages(const std::size_t pages_to_reserve) -> std::byte*;
     
@@ -13,24 +54,156 @@ namespace lcl::memory
     auto decommit_memory_pages (const void* base_address, const std::size_t pages_to_uncommit) -> void;
     auto unreserve_memory_pages(const void* base_address, const std::size_t pages_to_unreserve) -> void;
 
+    //Lets the platform take the memory backing the pages back whenever it needs it, the pages stay committed and usable 
+    //but what they held is lost. Until it is taken back the memory still counts as used.
+    auto release_memory_pages(const void* base_address, const std::size_t pages_to_release) -> void;
+
+    //Asks for the pages to be backed by transparent huge pages, where the platform has them. Only a hint, it may do nothing.
+    auto advise_huge_memory_pages(const void* base_address, const std::size_t pages_to_advise) -> void;
+
+    //Maps a whole file read only, returns nullptr when it can't be opened or is empty. The pages are backed by the file,
+    //so the platform can drop them whenever it is short on memory and read them again when they are touched.
+    [[nodiscard]] auto map_file(const char* path, std::size_t& file_size) -> const std::byte*;
+
+    //`base_address` and `file_size` must come from `map_file`
+    auto unmap_file(const void* base_address, const std::size_t file_size) -> void;
+
+    //The size of the huge pages `advise_huge_memory_pages` asks for, on the platforms that have them
+    constexpr std::size_t huge_page_size = 2 * 1024 * 1024;
+
+    enum class page_backing
+    {
+        regular,
+        transparent_huge_pages,  //Fewer TLB misses for big arenas, such as the ones holding the tokens or the AST
+    };
+
+    enum class page_release
+    {
+        decommit,   //The memory is given back right away, committing the pages again makes system calls
+        lazy_free,  //The memory is only given back when the system runs low on it, the pages can be used again right away. Eg: MADV_FREE
+                    //Faster when the pages are used again soon, but until then the memory still counts in the resident set size of the process.
+    };
+
+    //When `contiguous_virtual_memory_arena::reset` gives memory back, for processes that reuse an arena for one request after another.
+    //The committed pages past the most any request used are given back once they stayed unused for `resets_before_release` resets in a row,
+    //so a single big request doesn't keep its memory for the lifetime of the process and requests of a steady size don't commit again and again.
+    struct arena_reset_policy
+    {
+        std::size_t  retained_bytes        = 0;   //Always kept committed
+        std::size_t  resets_before_release = 8;
+        page_release release               = page_release::decommit;
+    };
+
+    //What an arena did since it was made, to size arenas from real data. The counts and sums never go down, the sizes are the current ones.
+    struct arena_telemetry
+    {
+        std::size_t reserved_bytes          = 0;
+        std::size_t committed_bytes         = 0;
+        std::size_t peak_committed_bytes    = 0;
+        std::size_t used_bytes              = 0;
+        std::size_t allocation_count        = 0;
+        std::size_t requested_bytes         = 0;
+        std::size_t alignment_padding_bytes = 0;   //Skipped to align allocations
+        std::size_t commit_count            = 0;
+        std::size_t decommit_count          = 0;
+        std::size_t release_count           = 0;   //Lazily freed, see `page_release::lazy_free`. The pages stay committed.
+        std::size_t released_bytes          = 0;
+    };
+
+    //A position in an arena to roll back to, see `contiguous_virtual_memory_arena::checkpoint`
+    struct arena_mark
+    {
+        std::size_t used_bytes;
+    };
+
     class contiguous_virtual_memory_arena
     {
+        public:
+        //Never decommit when rolling back
+        static constexpr std::size_t no_high_water_mark = SIZE_MAX;
+
+        //Fewest pages committed at once, committing a page at a time would make a system call for every page
+        static constexpr std::size_t minimum_pages_to_commit = 16;
+
+        private:
         const std::size_t m_reserved_pages;
         std::size_t       m_committed_pages = 0;
+        std::size_t       m_used_bytes      = 0;
+        std::size_t       m_high_water_mark = no_high_water_mark;
         std::byte*        m_base            = nullptr;
+        page_backing      m_page_backing    = page_backing::regular;
+
+        //What was reserved, more than `m_reserved_pages` when the base is moved up to align it
+        std::byte*  m_reservation       = nullptr;
+        std::size_t m_reservation_pages = 0;
+
+        arena_reset_policy m_reset_policy;
+        std::size_t        m_resets_since_release = 0;
+        std::size_t        m_peak_used_bytes      = 0;    //The most used since the last time memory was given back, rolled back allocations included
+        std::size_t        m_touched_bytes        = 0;    //The most used since the pages were last given back, the pages above it hold nothing
+
+        arena_telemetry m_telemetry;
 
         public:
-        explicit contiguous_virtual_memory_arena(const std::size_t pages_to_reserve) : m_reserved_pages(pages_to_reserve)
+        explicit contiguous_virtual_memory_arena(const std::size_t pages_to_reserve, const page_backing backing = page_backing::regular) : m_reserved_pages(pages_to_reserve), m_page_backing(backing)
         {
-            m_base = reserve_memory_pages(m_reserved_pages);
+            const auto page_size = get_page_size();
+
+            //A huge page can only back a range aligned to its size, a base that is only page aligned would leave the first and last ones as regular pages
+            const auto base_alignment = m_page_backing == page_backing::transparent_huge_pages ? std::max(huge_page_size, page_size) : page_size;
+
+            m_reservation_pages = m_reserved_pages + (base_alignment - page_size) / page_size;
+            m_reservation       = reserve_memory_pages(m_reservation_pages);
+
+            const auto reservation_address = reinterpret_cast<std::uintptr_t>(m_reservation);
+            m_base = m_reservation + ((base_alignment - reservation_address % base_alignment) % base_alignment);
+
+            if (m_page_backing == page_backing::transparent_huge_pages)
+            {
+                advise_huge_memory_pages(m_base, m_reserved_pages);
+            }
         }
 
+        contiguous_virtual_memory_arena(const contiguous_virtual_memory_arena&) = delete;
+        contiguous_virtual_memory_arena& operator=(const contiguous_virtual_memory_arena&) = delete;
+
         private:
         [[nodiscard]] auto address_to_commit_from() const noexcept -> std::byte*
         {
             return m_base + committed_bytes();
         }
 
+        auto grow_committed_memory(const std::size_t bytes_needed) -> void
+        {
+            commit_memory(pages_to_commit(bytes_needed, m_committed_pages, m_reserved_pages, m_page_backing));
+        }
+
+        public:
+        //How many pages to commit after `committed_pages` for `bytes_needed` bytes to be committed, without going past `reserved_pages`.
+        //At least as many pages as are committed are added, so the number of commits grows with the logarithm of the size of what grows.
+        //With huge pages whole huge pages are committed. Also used by `virtual_vector`.
+        [[nodiscard]] static auto pages_to_commit(const std::size_t bytes_needed, const std::size_t committed_pages, const std::size_t reserved_pages, const page_backing backing = page_backing::regular) -> std::size_t
+        {
+            const auto page_size     = get_page_size();
+            const auto pages_needed  = (bytes_needed + page_size - 1) / page_size;
+            const auto minimum_pages = backing == page_backing::transparent_huge_pages ? std::max(minimum_pages_to_commit, huge_page_size / page_size) : minimum_pages_to_commit;
+
+            assert(pages_needed > committed_pages && committed_pages <= reserved_pages);
+
+            auto result = std::max({ pages_needed - committed_pages, committed_pages, minimum_pages });
+
+            //The committed range ends on a huge page, a commit that ends inside one splits the mapping and leaves that huge page as regular pages
+            if (backing == page_backing::transparent_huge_pages && huge_page_size > page_size)
+            {
+                const auto pages_per_huge_page = huge_page_size / page_size;
+                const auto committed_end       = committed_pages + result;
+
+                result += (pages_per_huge_page - committed_end % pages_per_huge_page) % pages_per_huge_page;
+            }
+
+            return std::min(result, reserved_pages - committed_pages);
+        }
+
         public:
         [[nodiscard]] auto reserved_pages() const noexcept -> std::size_t 
         {
@@ -57,105 +230,311 @@ namespace lcl::memory
             return m_base;
         }
 
-        [[nodiscard]] auto commit_memory(const std::size_t pages_to_commit) -> void 
+        //Bytes taken by allocations, including the padding added to align them
+        [[nodiscard]] auto used_bytes() const noexcept -> std::size_t
+        {
+            return m_used_bytes;
+        }
+
+        [[nodiscard]] auto backing() const noexcept -> lcl::memory::page_backing
+        {
+            return m_page_backing;
+        }
+
+        //Bump allocates `size` bytes aligned to `alignment`, which must be a power of 2 and may be bigger than a page. Commits more pages when needed.
+        //The memory is only given back with the arena. Throws `std::bad_alloc` when the reserved pages run out.
+        [[nodiscard]] auto allocate(const std::size_t size, const std::size_t alignment = alignof(std::max_align_t)) -> std::byte*
+        {
+            assert(alignment != 0 && (alignment & (alignment - 1)) == 0);
+
+            //The base is only aligned to a page, or a huge page, so the address is aligned and not the offset
+            const auto base_address   = reinterpret_cast<std::uintptr_t>(m_base);
+            const auto aligned_offset = ((base_address + m_used_bytes + alignment - 1) & ~(alignment - 1)) - base_address;
+
+            if (aligned_offset < m_used_bytes || aligned_offset + size < aligned_offset || aligned_offset + size > reserved_bytes())
+            {
+                throw std::bad_alloc{};
+            }
+
+            if (aligned_offset + size > committed_bytes())
+            {
+                grow_committed_memory(aligned_offset + size);
+            }
+
+            m_telemetry.allocation_count        += 1;
+            m_telemetry.requested_bytes         += size;
+            m_telemetry.alignment_padding_bytes += aligned_offset - m_used_bytes;
+
+            m_used_bytes      = aligned_offset + size;
+            m_peak_used_bytes = std::max(m_peak_used_bytes, m_used_bytes);
+            m_touched_bytes   = std::max(m_touched_bytes, m_used_bytes);
+
+            unpoison_memory(m_base + aligned_offset, size);
+
+            return m_base + aligned_offset;
+        }
+
+        auto commit_memory(const std::size_t pages_to_commit) -> void 
         {
+            assert(m_committed_pages + pages_to_commit <= m_reserved_pages);
+
             commit_memory_pages(address_to_commit_from(), pages_to_commit);
 
+            //Nothing is allocated in the new pages yet
+            poison_memory(address_to_commit_from(), pages_to_commit * get_page_size());
+
             m_committed_pages += pages_to_commit;
+
+            m_telemetry.commit_count        += 1;
+            m_telemetry.peak_committed_bytes = std::max(m_telemetry.peak_committed_bytes, committed_bytes());
+        }
+
+        //Decommits the last `pages_to_decommit` committed pages, which must not hold any allocation
+        auto decommit_memory(const std::size_t pages_to_decommit) -> void
+        {
+            assert(pages_to_decommit <= m_committed_pages && (m_committed_pages - pages_to_decommit) * get_page_size() >= m_used_bytes);
+
+            m_committed_pages -= pages_to_decommit;
+
+            decommit_memory_pages(address_to_commit_from(), pages_to_decommit);
+            m_touched_bytes = std::min(m_touched_bytes, committed_bytes());
+
+            m_telemetry.decommit_count += 1;
+        }
+
+        //Everything allocated after the checkpoint is freed by rolling back to it. 
+        //Eg: the scratch data of a speculative parse. See `scoped_arena_marker`.
+        [[nodiscard]] auto checkpoint() const noexcept -> arena_mark
+        {
+            return arena_mark { m_used_bytes };
+        }
+
+        //Frees everything allocated after `mark`, which must come from this arena and not be after the current position.
+        //Only moves the position back, unless more than the high water mark ends up committed and unused, then the pages above it are decommitted.
+        auto rollback(const arena_mark mark) -> void
+        {
+            assert(mark.used_bytes <= m_used_bytes);
+
+            //Using what was rolled back is reported in ASan builds
+            poison_memory(m_base + mark.used_bytes, m_used_bytes - mark.used_bytes);
+
+            m_used_bytes = mark.used_bytes;
+
+            if (m_high_water_mark == no_high_water_mark)
+            {
+                return;
+            }
+
+            const auto page_size     = get_page_size();
+            const auto bytes_to_keep = std::max(m_used_bytes, m_high_water_mark);
+            const auto pages_to_keep = (bytes_to_keep + page_size - 1) / page_size;
+
+            if (pages_to_keep < m_committed_pages)
+            {
+                decommit_memory(m_committed_pages - pages_to_keep);
+            }
+        }
+
+        //Bytes that stay committed when rolling back, whatever the arena held before. Rolling back often with a low mark
+        //makes a system call every time, with the default `no_high_water_mark` nothing is ever decommitted.
+        auto set_high_water_mark(const std::size_t bytes) noexcept -> void
+        {
+            m_high_water_mark = bytes;
+        }
+
+        [[nodiscard]] auto high_water_mark() const noexcept -> std::size_t
+        {
+            return m_high_water_mark;
+        }
+
+        //Frees everything in the arena without unmapping it, then gives back memory as `reset_policy` says.
+        auto reset() -> void
+        {
+            //Using what was reset is reported in ASan builds
+            poison_memory(m_base, m_used_bytes);
+
+            m_used_bytes = 0;
+
+            if (++m_resets_since_release < m_reset_policy.resets_before_release)
+            {
+                return;
+            }
+
+            const auto page_size     = get_page_size();
+            const auto bytes_to_keep = std::max(m_peak_used_bytes, m_reset_policy.retained_bytes);
+            const auto pages_to_keep = (bytes_to_keep + page_size - 1) / page_size;
+
+            m_resets_since_release = 0;
+            m_peak_used_bytes      = 0;
+
+            if (pages_to_keep >= m_committed_pages)
+            {
+                return;
+            }
+
+            switch (m_reset_policy.release)
+            {
+                case page_release::decommit:
+                {
+                    decommit_memory(m_committed_pages - pages_to_keep);
+                    break;
+                }
+
+                case page_release::lazy_free:
+                {
+                    //The pages that were released before and not used since hold nothing, releasing them again would count them twice
+                    const auto touched_pages = std::min((m_touched_bytes + page_size - 1) / page_size, m_committed_pages);
+
+                    if (pages_to_keep < touched_pages)
+                    {
+                        release_memory_pages(m_base + pages_to_keep * page_size, touched_pages - pages_to_keep);
+
+                        m_touched_bytes = pages_to_keep * page_size;
+
+                        m_telemetry.release_count  += 1;
+                        m_telemetry.released_bytes += (touched_pages - pages_to_keep) * page_size;
+                    }
+
+                    break;
+                }
+            }
+        }
+
+        auto set_reset_policy(const arena_reset_policy& policy) noexcept -> void
+        {
+            m_reset_policy = policy;
+        }
+
+        [[nodiscard]] auto reset_policy() const noexcept -> const arena_reset_policy&
+        {
+            return m_reset_policy;
+        }
+
+        [[nodiscard]] auto telemetry() const noexcept -> arena_telemetry
+        {
+            auto result = m_telemetry;
+
+            result.reserved_bytes  = reserved_bytes();
+            result.committed_bytes = committed_bytes();
+            result.used_bytes      = m_used_bytes;
+
+            return result;
         }
 
         ~contiguous_virtual_memory_arena()
         {
-            unreserve_memory_pages(m_base, m_reserved_pages);
+            //The addresses can be mapped again by anyone, they must not stay poisoned. Only what was committed may have been poisoned.
+            unpoison_memory(m_base, m_telemetry.peak_committed_bytes);
+
+            unreserve_memory_pages(m_reservation, m_reservation_pages);
+        }
+    };
+
+    //Rolls the arena back to where it was when the marker was made, when the marker goes out of scope.
+    //Eg: 
+    //{
+    //    const auto marker = lcl::memory::scoped_arena_marker { arena };
+    //    ...allocate scratch data
+    //}
+    class scoped_arena_marker
+    {
+        contiguous_virtual_memory_arena& m_arena;
+        const arena_mark                 m_mark;
+
+        public:
+        explicit scoped_arena_marker(contiguous_virtual_memory_arena& arena) noexcept : m_arena(arena), m_mark(arena.checkpoint())
+        {
+            //Empty
+        }
+
+        scoped_arena_marker(const scoped_arena_marker&) = delete;
+        scoped_arena_marker& operator=(const scoped_arena_marker&) = delete;
+
+        [[nodiscard]] auto mark() const noexcept -> arena_mark
+        {
+            return m_mark;
+        }
+
+        ~scoped_arena_marker()
+        {
+            m_arena.rollback(m_mark);
         }
     };
 
+    //Allocates the elements of standard containers from a `contiguous_virtual_memory_arena`, which must outlive the containers.
+    //Deallocating does nothing, the memory is given back with the arena. Eg: std::vector<lcl::token, virtual_arena_allocator<lcl::token>>
+    //A vector that grows leaves its old elements in the arena, reserving up front avoids that.
     template <class T> class virtual_arena_allocator 
     {
         public:
         using value_type      = T;
-        using pointer         = T*;
-        using const_pointer   = const T*;
-        using reference       = T&;
-        using const_reference = const T&;
         using size_type       = std::size_t;
         using difference_type = std::ptrdiff_t;
 
+        //Containers that are assigned or swapped take the arena of the other container with them, like they take its elements
+        using propagate_on_container_copy_assignment = std::true_type;
+        using propagate_on_container_move_assignment = std::true_type;
+        using propagate_on_container_swap            = std::true_type;
+        using is_always_equal                        = std::false_type;
+
         template <class U> struct rebind 
         { 
             using other = virtual_arena_allocator<U>; 
         };
 
         private: 
-        contiguous_virtual_arena& m_arena;
+        template <class U> friend class virtual_arena_allocator;
+
+        //A pointer and not a reference so the allocator can be assigned
+        contiguous_virtual_memory_arena* m_arena;
 
         public:
-        explicit virtual_arena_allocator(const std::size_type reserve_count) noexcept : m_reseved(reserve_count)
+        explicit virtual_arena_allocator(contiguous_virtual_memory_arena& arena) noexcept : m_arena(&arena)
         {
             //Empty
         }
 
-        virtual_arena_allocator(const virtual_arena_allocator&)
+        template <class U> virtual_arena_allocator(const virtual_arena_allocator<U>& other) noexcept : m_arena(other.m_arena)
         {
-
+            //Empty
         }
 
-        template<class U> virtual_arena_allocator(const virtual_arena_allocator<U>&) 
+        [[nodiscard]] auto arena() const noexcept -> contiguous_virtual_memory_arena&
         {
-
-        }
-        
-        auto address(reference value) const noexcept -> pointer
-        {
-            return &value;
+            return *m_arena;
         }
 
-        auto address(const_reference value) const noexcept -> const_pointer 
+        [[nodiscard]] auto max_size() const noexcept -> size_type 
         {
-            return &value;
+            return m_arena->reserved_bytes() / sizeof(T);
         }
 
-        auto max_size() const noexcept -> std::size_type 
+        [[nodiscard]] auto allocate(const size_type count) -> T*
         {
-            return m_reseved;
-        }
+            if (count > max_size())
+            {
+                throw std::bad_alloc{};
+            }
 
-        auto allocate(std::size_type size, const void* = nullptr) -> pointer 
-        {
-            auto ret = static_cast<pointer>(::operator new(num * sizeof(T)));
-            std::cerr << " allocated at: " << static_cast<void*>(ret) << std::endl;
-            return ret;
+            return reinterpret_cast<T*>(m_arena->allocate(count * sizeof(T), alignof(T)));
         }
 
-        // initialize elements of allocated storage p with value value
-        auto construct (pointer p, const T& value) -> void 
+        auto deallocate(T*, size_type) noexcept -> void 
         {
-            // initialize memory with placement new
-            new(static_cast<void*>(p)) T{value};
+            //Empty
         }
 
-        // destroy elements of initialized storage p
-        auto destroy (pointer p) -> void 
+        //Memory allocated by one can be deallocated by the other when they use the same arena
+        template <class U> [[nodiscard]] auto operator==(const virtual_arena_allocator<U>& other) const noexcept -> bool
         {
-            // destroy objects by calling their destructor
-            p->~T();
+            return m_arena == other.m_arena;
         }
 
-        // deallocate storage p of deleted elements
-        auto deallocate (pointer p, std::size_type num) -> void 
+        template <class U> [[nodiscard]] auto operator!=(const virtual_arena_allocator<U>& other) const noexcept -> bool
         {
-            // print message and deallocate memory with global delete
-            std::cerr << "deallocate " << num << " element(s)"
-                        << " of size " << sizeof(T)
-                        << " at: " << static_cast<void*>(p) << std::endl;
-                        
-            ::operator delete(static_cast<void*>(p));
+            return m_arena != other.m_arena;
         }
-
-        ~virtual_arena_allocator() noexcept = default;
     };
-
-    //@Todo: Implement operator== and operator!= for allocator 
 }
 
-#endif LCLCOMPILER_ALLOCATORS_HPP
\ No newline at end of file
+#endif //LCLCOMPILER_ALLOCATORS_HPP
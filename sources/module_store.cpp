@@ -0,0 +1,287 @@
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <fstream>
+
+#include <tl/expected.hpp>
+
+#include <memory.hpp>
+#include <module_store.hpp>
+
+namespace lcl
+{
+    //A spill file is the header, then a record for every token, then the code of the tokens.
+    //Spill files never leave the machine that wrote them, so they are in its byte order.
+    struct spill_header
+    {
+        static constexpr std::uint32_t expected_magic = 0x4D4C434C; //"LCLM"
+
+        std::uint32_t magic;
+        std::uint32_t token_count;
+        std::uint64_t code_size;
+    };
+
+    struct spilled_token
+    {
+        std::uint32_t code_offset;
+        std::uint32_t code_size;
+        std::uint32_t line;
+        std::uint16_t type;
+        std::uint16_t flags;
+    };
+
+    module_store::module_store(const std::size_t memory_budget, std::filesystem::path spill_directory) : m_spill_directory(std::move(spill_directory)), m_memory_budget(memory_budget)
+    {
+        //Empty
+    }
+
+    [[nodiscard]] auto module_store::spill_path(const std::size_t module_index) const -> std::filesystem::path
+    {
+        return m_spill_directory / (std::to_string(module_index) + ".lclmodule");
+    }
+
+    [[nodiscard]] auto module_store::memory_usage_of(const module& module) noexcept -> std::size_t
+    {
+        return module.tokens.capacity() * sizeof(lcl::token) + module.code_size + module.mapped_size;
+    }
+
+    [[nodiscard]] auto module_store::add(std::string name, const gsl::span<const lcl::token> tokens) -> tl::expected<std::size_t, std::error_code>
+    {
+        auto& module = m_modules.emplace_back();
+        module.name  = std::move(name);
+
+        for (const auto& token : tokens)
+        {
+            module.code_size += token.code.size();
+        }
+
+        module.code = std::make_unique<char[]>(module.code_size);
+        module.tokens.reserve(static_cast<std::size_t>(tokens.size()));
+
+        auto code_end = module.code.get();
+
+        for (const auto& token : tokens)
+        {
+            std::memcpy(code_end, token.code.data(), token.code.size());
+            module.tokens.emplace_back(token.type, std::string_view { code_end, token.code.size() }, token.flags, token.line);
+            code_end += token.code.size();
+        }
+
+        module.last_use = ++m_use_count;
+
+        m_memory_usage += memory_usage_of(module);
+
+        const auto module_index = m_modules.size() - 1;
+
+        return enforce_memory_budget(module_index).map([module_index]() { return module_index; });
+    }
+
+    [[nodiscard]] auto module_store::tokens(const std::size_t module_index) -> tl::expected<gsl::span<const lcl::token>, std::error_code>
+    {
+        assert(module_index < m_modules.size());
+
+        auto& module = m_modules[module_index];
+
+        module.last_use = ++m_use_count;
+
+        if (!module.is_resident)
+        {
+            if (auto result = reload(module, module_index); !result)
+            {
+                return tl::unexpected(result.error());
+            }
+
+            if (auto result = enforce_memory_budget(module_index); !result)
+            {
+                return tl::unexpected(result.error());
+            }
+        }
+
+        return gsl::span<const lcl::token> { module.tokens };
+    }
+
+    [[nodiscard]] auto module_store::enforce_memory_budget(const std::size_t module_index_in_use) -> tl::expected<void, std::error_code>
+    {
+        while (m_memory_usage > m_memory_budget)
+        {
+            auto least_recently_used = m_modules.end();
+
+            for (auto it = std::begin(m_modules); it != std::end(m_modules); ++it)
+            {
+                const auto is_candidate = it->is_resident && static_cast<std::size_t>(it - std::begin(m_modules)) != module_index_in_use;
+
+                if (is_candidate && (least_recently_used == m_modules.end() || it->last_use < least_recently_used->last_use))
+                {
+                    least_recently_used = it;
+                }
+            }
+
+            //The module in use doesn't fit on its own, it stays over budget until another one is used
+            if (least_recently_used == m_modules.end())
+            {
+                break;
+            }
+
+            const auto module_index = static_cast<std::size_t>(least_recently_used - std::begin(m_modules));
+
+            if (auto result = spill(*least_recently_used, module_index); !result)
+            {
+                return result;
+            }
+
+            unload(*least_recently_used);
+        }
+
+        return {};
+    }
+
+    [[nodiscard]] auto module_store::spill(module& module, const std::size_t module_index) -> tl::expected<void, std::error_code>
+    {
+        if (module.is_spilled)
+        {
+            return {};
+        }
+
+        assert(module.code != nullptr);
+
+        auto error = std::error_code{};
+        std::filesystem::create_directories(m_spill_directory, error);
+
+        if (error)
+        {
+            return tl::unexpected(error);
+        }
+
+        auto file = std::ofstream { spill_path(module_index), std::ios::binary | std::ios::trunc };
+
+        const auto header = spill_header { spill_header::expected_magic, static_cast<std::uint32_t>(module.tokens.size()), module.code_size };
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+        for (const auto& token : module.tokens)
+        {
+            const auto record = spilled_token
+            {
+                static_cast<std::uint32_t>(token.code.data() - module.code.get()),
+                static_cast<std::uint32_t>(token.code.size()),
+                token.line,
+                static_cast<std::uint16_t>(token.type),
+                static_cast<std::uint16_t>(token.flags)
+            };
+
+            file.write(reinterpret_cast<const char*>(&record), sizeof(record));
+        }
+
+        file.write(module.code.get(), static_cast<std::streamsize>(module.code_size));
+
+        if (!file.flush())
+        {
+            return tl::unexpected(std::make_error_code(std::errc::io_error));
+        }
+
+        module.is_spilled = true;
+        ++m_spill_count;
+
+        return {};
+    }
+
+    [[nodiscard]] auto module_store::reload(module& module, const std::size_t module_index) -> tl::expected<void, std::error_code>
+    {
+        assert(!module.is_resident && module.is_spilled);
+
+        auto       file_size = std::size_t { 0 };
+        const auto file      = lcl::memory::map_file(spill_path(module_index).string().c_str(), file_size);
+
+        if (file == nullptr)
+        {
+            return tl::unexpected(std::make_error_code(std::errc::no_such_file_or_directory));
+        }
+
+        auto header = spill_header{};
+
+        if (file_size >= sizeof(header))
+        {
+            std::memcpy(&header, file, sizeof(header));
+        }
+
+        const auto records_size = std::size_t { header.token_count } * sizeof(spilled_token);
+
+        if (file_size < sizeof(header) || header.magic != spill_header::expected_magic || file_size != sizeof(header) + records_size + header.code_size)
+        {
+            lcl::memory::unmap_file(file, file_size);
+            return tl::unexpected(std::make_error_code(std::errc::illegal_byte_sequence));
+        }
+
+        const auto records = file + sizeof(header);
+        const auto code    = reinterpret_cast<const char*>(records + records_size);
+
+        module.tokens.reserve(header.token_count);
+
+        for (auto i = std::size_t { 0 }; i < header.token_count; ++i)
+        {
+            auto record = spilled_token{};
+            std::memcpy(&record, records + i * sizeof(record), sizeof(record));
+
+            //A truncated or corrupt file must not make the tokens point out of the mapping
+            if (std::size_t { record.code_offset } + record.code_size > header.code_size || record.type > static_cast<std::uint16_t>(lcl::token_type::backward_slash))
+            {
+                module.tokens = std::vector<lcl::token>{};
+
+                lcl::memory::unmap_file(file, file_size);
+                return tl::unexpected(std::make_error_code(std::errc::illegal_byte_sequence));
+            }
+
+            module.tokens.emplace_back(static_cast<lcl::token_type>(record.type), std::string_view { code + record.code_offset, record.code_size },
+                                       static_cast<lcl::token_flags>(record.flags), record.line);
+        }
+
+        module.mapped_file = file;
+        module.mapped_size = file_size;
+        module.is_resident = true;
+
+        m_memory_usage += memory_usage_of(module);
+        ++m_reload_count;
+
+        return {};
+    }
+
+    auto module_store::unload(module& module) noexcept -> void
+    {
+        assert(module.is_resident);
+
+        m_memory_usage -= memory_usage_of(module);
+
+        module.tokens      = std::vector<lcl::token>{};
+        module.code        = nullptr;
+        module.code_size   = 0;
+        module.is_resident = false;
+
+        if (module.mapped_file != nullptr)
+        {
+            lcl::memory::unmap_file(module.mapped_file, module.mapped_size);
+
+            module.mapped_file = nullptr;
+            module.mapped_size = 0;
+        }
+    }
+
+    module_store::~module_store()
+    {
+        for (auto i = std::size_t { 0 }; i < m_modules.size(); ++i)
+        {
+            if (m_modules[i].mapped_file != nullptr)
+            {
+                lcl::memory::unmap_file(m_modules[i].mapped_file, m_modules[i].mapped_size);
+            }
+
+            if (m_modules[i].is_spilled)
+            {
+                auto error = std::error_code{};
+                std::filesystem::remove(spill_path(i), error);
+            }
+        }
+
+        //Only removed when nothing else was put in it
+        auto error = std::error_code{};
+        std::filesystem::remove(m_spill_directory, error);
+    }
+}
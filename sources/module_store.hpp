@@ -0,0 +1,122 @@
+#ifndef LCLCOMPILER_MODULE_STORE_HPP
+#define LCLCOMPILER_MODULE_STORE_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <limits>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <vector>
+
+#include <gsl/span>
+#include <tl/expected.hpp>
+
+#include <tokenizer.hpp>
+
+namespace lcl
+{
+    //Holds the tokens of the modules that are done being compiled, which the modules that import them read back through `tokens`.
+    //A module owns a copy of the code of its tokens, so its source buffer can be freed once it is added.
+    //When the modules in memory take more than the memory budget, the least recently used ones are written to the spill directory
+    //and freed. They are mapped back in when they are needed again, the mapped code is backed by the file so the system can drop
+    //those pages whenever it is short on memory. Not thread safe.
+    class module_store
+    {
+        public:
+        static constexpr std::size_t unlimited_memory_budget = std::numeric_limits<std::size_t>::max();
+
+        private:
+        struct module
+        {
+            std::string             name;
+            std::vector<lcl::token> tokens;                //Point into `code` or into the mapped file
+            std::unique_ptr<char[]> code;
+            std::size_t             code_size   = 0;
+            const std::byte*        mapped_file = nullptr;
+            std::size_t             mapped_size = 0;
+            std::uint64_t           last_use    = 0;
+            bool                    is_resident = true;
+            bool                    is_spilled  = false;   //Has a spill file, which stays valid as modules never change
+        };
+
+        std::vector<module>   m_modules;
+        std::filesystem::path m_spill_directory;
+        std::size_t           m_memory_budget;
+        std::size_t           m_memory_usage = 0;
+        std::uint64_t         m_use_count    = 0;
+        std::size_t           m_spill_count  = 0;
+        std::size_t           m_reload_count = 0;
+
+        [[nodiscard]] auto spill_path(const std::size_t module_index) const -> std::filesystem::path;
+
+        [[nodiscard]] static auto memory_usage_of(const module& module) noexcept -> std::size_t;
+
+        [[nodiscard]] auto spill(module& module, const std::size_t module_index) -> tl::expected<void, std::error_code>;
+
+        [[nodiscard]] auto reload(module& module, const std::size_t module_index) -> tl::expected<void, std::error_code>;
+
+        auto unload(module& module) noexcept -> void;
+
+        //Spills modules until the budget is met, never the one at `module_index_in_use`
+        [[nodiscard]] auto enforce_memory_budget(const std::size_t module_index_in_use) -> tl::expected<void, std::error_code>;
+
+        public:
+        //The spill directory is created when the first module is spilled, and removed with the store once it is empty
+        module_store(const std::size_t memory_budget, std::filesystem::path spill_directory);
+
+        module_store(const module_store&) = delete;
+        module_store& operator=(const module_store&) = delete;
+
+        //Copies the tokens of a finished module and returns its index. Fails when modules have to be spilled and can't be.
+        [[nodiscard]] auto add(std::string name, const gsl::span<const lcl::token> tokens) -> tl::expected<std::size_t, std::error_code>;
+
+        //The tokens of a module, mapped back in when it was spilled.
+        //Only valid until the next call to `add` or `tokens`, which may spill the module again.
+        [[nodiscard]] auto tokens(const std::size_t module_index) -> tl::expected<gsl::span<const lcl::token>, std::error_code>;
+
+        [[nodiscard]] auto name(const std::size_t module_index) const noexcept -> std::string_view
+        {
+            return m_modules[module_index].name;
+        }
+
+        [[nodiscard]] auto is_resident(const std::size_t module_index) const noexcept -> bool
+        {
+            return m_modules[module_index].is_resident;
+        }
+
+        [[nodiscard]] auto module_count() const noexcept -> std::size_t
+        {
+            return m_modules.size();
+        }
+
+        //Bytes taken by the tokens and code of the modules in memory, including the mapped ones
+        [[nodiscard]] auto memory_usage() const noexcept -> std::size_t
+        {
+            return m_memory_usage;
+        }
+
+        [[nodiscard]] auto memory_budget() const noexcept -> std::size_t
+        {
+            return m_memory_budget;
+        }
+
+        //Modules written to the spill directory
+        [[nodiscard]] auto spill_count() const noexcept -> std::size_t
+        {
+            return m_spill_count;
+        }
+
+        //Spilled modules mapped back in
+        [[nodiscard]] auto reload_count() const noexcept -> std::size_t
+        {
+            return m_reload_count;
+        }
+
+        ~module_store();
+    };
+}
+
+#endif //LCLCOMPILER_MODULE_STORE_HPP
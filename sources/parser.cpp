@@ -0,0 +1,988 @@
+#include <array>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+#include <gsl/span>
+#include <magic_enum.hpp>
+#include <tl/expected.hpp>
+
+#include <ast.hpp>
+#include <memory.hpp>
+#include <parser.hpp>
+#include <tokenizer.hpp>
+
+using namespace std::string_view_literals;
+
+namespace lcl
+{
+    namespace
+    {
+        using parse_result = tl::expected<void, lcl::parser_error>;
+
+        //A node of the expression being parsed. Expressions are parsed in post-order, where an operator comes after its operands,
+        //and copied to the AST in pre-order once they are complete.
+        struct expression_node
+        {
+            lcl::ast_node_kind kind;
+            std::uint32_t      first_token;
+            std::uint32_t      subtree_size;
+        };
+
+        //How tightly an operator holds its operands, from the loosest to the tightest. Binary operators are left associative,
+        //an operator takes the operand on its left from the operators before it that bind as tightly or less.
+        enum class binding_power : std::uint8_t
+        {
+            none,           //Not an operator
+            logical_or,     //or
+            logical_and,    //and
+            comparison,     //== != < > <= >=
+            bitwise_or,     //|
+            bitwise_xor,    //^
+            bitwise_and,    //&
+            shift,          //<< >>
+            additive,       //+ -
+            multiplicative, //* / %
+            prefix,         //-value, every prefix operator binds tighter than the binary ones
+        };
+
+        //The binary operators that start with a token type. Some are made of two tokens joined together, Eg: `<=`
+        struct binary_operator_binding_powers
+        {
+            lcl::binding_power alone        = lcl::binding_power::none; //<
+            lcl::binding_power before_equal = lcl::binding_power::none; //<=
+            lcl::binding_power doubled      = lcl::binding_power::none; //<<
+        };
+
+        constexpr auto token_type_count = magic_enum::enum_count<lcl::token_type>();
+
+        [[nodiscard]] constexpr auto make_binary_binding_powers() noexcept -> std::array<binary_operator_binding_powers, token_type_count>
+        {
+            auto table = std::array<binary_operator_binding_powers, token_type_count>{};
+
+            const auto at = [&](const lcl::token_type type) -> binary_operator_binding_powers& { return table[static_cast<std::size_t>(type)]; };
+
+            at(lcl::token_type::equal).before_equal            = lcl::binding_power::comparison;
+            at(lcl::token_type::exclamation_mark).before_equal = lcl::binding_power::comparison;
+            at(lcl::token_type::left_arrow).alone              = lcl::binding_power::comparison;
+            at(lcl::token_type::left_arrow).before_equal       = lcl::binding_power::comparison;
+            at(lcl::token_type::left_arrow).doubled            = lcl::binding_power::shift;
+            at(lcl::token_type::right_arrow).alone             = lcl::binding_power::comparison;
+            at(lcl::token_type::right_arrow).before_equal      = lcl::binding_power::comparison;
+            at(lcl::token_type::right_arrow).doubled           = lcl::binding_power::shift;
+            at(lcl::token_type::bar).alone                     = lcl::binding_power::bitwise_or;
+            at(lcl::token_type::hat).alone                     = lcl::binding_power::bitwise_xor;
+            at(lcl::token_type::ampersand).alone               = lcl::binding_power::bitwise_and;
+            at(lcl::token_type::plus).alone                    = lcl::binding_power::additive;
+            at(lcl::token_type::minus).alone                   = lcl::binding_power::additive;
+            at(lcl::token_type::star).alone                    = lcl::binding_power::multiplicative;
+            at(lcl::token_type::forward_slash).alone           = lcl::binding_power::multiplicative;
+            at(lcl::token_type::percent).alone                 = lcl::binding_power::multiplicative;
+
+            return table;
+        }
+
+        //Indexed by the type of the first token of the operator
+        constexpr auto binary_binding_powers = make_binary_binding_powers();
+
+        struct binary_operator
+        {
+            lcl::binding_power binding_power;
+            std::uint32_t      token_count;
+        };
+
+        //An operator waiting for its operands to be parsed
+        struct pending_operator
+        {
+            lcl::ast_node_kind kind;
+            lcl::binding_power binding_power;
+            std::uint32_t      token;
+            std::uint32_t      subtree_begin; //Where its first operand starts in the expression
+        };
+
+        class parser
+        {
+            const lcl::token*             m_tokens;
+            std::uint32_t                 m_token_count;
+            std::uint32_t                 m_index = 0;
+            lcl::ast                      m_ast;
+            std::vector<expression_node>  m_expression;
+            std::vector<pending_operator> m_operators;
+            std::vector<std::uint32_t>    m_expression_stack;
+            std::uint32_t                 m_nesting_depth = 0;
+
+            //Statements in statements and expressions in brackets are parsed by recursion, which is limited so that
+            //code such as 100 000 `(` is an error rather than the end of the stack
+            static constexpr std::uint32_t max_nesting_depth = 256;
+
+            //Parses with `parse` one level deeper
+            [[nodiscard]] auto parse_nested(parse_result (parser::*parse)()) -> parse_result
+            {
+                if (m_nesting_depth == max_nesting_depth)
+                {
+                    return error(lcl::parser_error_type::nesting_too_deep);
+                }
+
+                ++m_nesting_depth;
+                auto result = (this->*parse)();
+                --m_nesting_depth;
+
+                return result;
+            }
+
+            //The first token from `index` on that isn't a comment
+            [[nodiscard]] auto skip_comments(std::uint32_t index) const noexcept -> std::uint32_t
+            {
+                while (index < m_token_count && m_tokens[index].type == lcl::token_type::comment)
+                {
+                    ++index;
+                }
+
+                return index;
+            }
+
+            auto advance() noexcept -> void
+            {
+                assert(m_index < m_token_count);
+                m_index = skip_comments(m_index + 1);
+            }
+
+            //Over an operator made of `token_count` tokens joined together
+            auto advance(const std::uint32_t token_count) noexcept -> void
+            {
+                m_index += token_count - 1;
+                advance();
+            }
+
+            [[nodiscard]] auto at_end() const noexcept -> bool
+            {
+                return m_index == m_token_count;
+            }
+
+            [[nodiscard]] auto is(const lcl::token_type type) const noexcept -> bool
+            {
+                return m_index < m_token_count && m_tokens[m_index].type == type;
+            }
+
+            [[nodiscard]] auto is_keyword(const std::string_view& keyword) const noexcept -> bool
+            {
+                return m_index < m_token_count && m_tokens[m_index].is_keyword() && m_tokens[m_index].code == keyword;
+            }
+
+            [[nodiscard]] auto is_identifier() const noexcept -> bool
+            {
+                return is(lcl::token_type::word) && !m_tokens[m_index].is_keyword();
+            }
+
+            //The current token is `first` and is directly followed by `second`, Eg: `==`
+            [[nodiscard]] auto is_pair(const lcl::token_type first, const lcl::token_type second) const noexcept -> bool
+            {
+                return is(first) && m_index + 1 < m_token_count && m_tokens[m_index + 1].type == second && m_tokens[m_index + 1].is_joined_to_previous();
+            }
+
+            //The type of the token after the current one, comments don't count
+            [[nodiscard]] auto is_next(const lcl::token_type type) const noexcept -> bool
+            {
+                const auto next = skip_comments(m_index + 1);
+                return next < m_token_count && m_tokens[next].type == type;
+            }
+
+            [[nodiscard]] auto error(const lcl::parser_error_type error_type) const noexcept -> tl::unexpected<lcl::parser_error>
+            {
+                return tl::unexpected(lcl::parser_error { at_end() ? lcl::parser_error_type::unexpected_end_of_code : error_type, m_index });
+            }
+
+            [[nodiscard]] auto expect(const lcl::token_type type, const lcl::parser_error_type error_type) noexcept -> parse_result
+            {
+                if (!is(type))
+                {
+                    return error(error_type);
+                }
+
+                advance();
+                return {};
+            }
+
+            //import Name: * | name, name;
+            [[nodiscard]] auto parse_import() -> parse_result
+            {
+                const auto node = m_ast.open_node(lcl::ast_node_kind::import_statement, m_index);
+                advance();
+
+                if (!is_identifier())
+                {
+                    return error(lcl::parser_error_type::expected_identifier);
+                }
+
+                m_ast.add_node(lcl::ast_node_kind::imported_module, m_index);
+                advance();
+
+                if (auto result = expect(lcl::token_type::colon, lcl::parser_error_type::expected_colon); !result)
+                {
+                    return result;
+                }
+
+                if (is(lcl::token_type::star))
+                {
+                    m_ast.add_node(lcl::ast_node_kind::import_everything, m_index);
+                    advance();
+                }
+                else
+                {
+                    while (true)
+                    {
+                        if (!is_identifier())
+                        {
+                            return error(lcl::parser_error_type::expected_identifier);
+                        }
+
+                        m_ast.add_node(lcl::ast_node_kind::imported_name, m_index);
+                        advance();
+
+                        if (!is(lcl::token_type::comma))
+                        {
+                            break;
+                        }
+
+                        advance();
+                    }
+                }
+
+                if (auto result = expect(lcl::token_type::semicolon, lcl::parser_error_type::expected_semicolon); !result)
+                {
+                    return result;
+                }
+
+                m_ast.close_node(node);
+                return {};
+            }
+
+            //*type | name, the built in types such as `int` are keywords. The pointers are a loop, they can nest without limit
+            [[nodiscard]] auto parse_type() -> parse_result
+            {
+                const auto first_pointer = static_cast<lcl::ast_index>(m_ast.size());
+
+                while (is(lcl::token_type::star))
+                {
+                    m_ast.open_node(lcl::ast_node_kind::pointer_type, m_index);
+                    advance();
+                }
+
+                const auto pointer_end = static_cast<lcl::ast_index>(m_ast.size());
+
+                if (!is(lcl::token_type::word))
+                {
+                    return error(lcl::parser_error_type::expected_type);
+                }
+
+                m_ast.add_node(lcl::ast_node_kind::named_type, m_index);
+                advance();
+
+                for (auto pointer = first_pointer; pointer != pointer_end; ++pointer)
+                {
+                    m_ast.close_node(pointer);
+                }
+
+                return {};
+            }
+
+            //name: type, the node is `kind`
+            [[nodiscard]] auto parse_typed_name(const lcl::ast_node_kind kind) -> parse_result
+            {
+                if (!is_identifier())
+                {
+                    return error(lcl::parser_error_type::expected_identifier);
+                }
+
+                const auto node = m_ast.open_node(kind, m_index);
+                advance();
+
+                if (auto result = expect(lcl::token_type::colon, lcl::parser_error_type::expected_colon); !result)
+                {
+                    return result;
+                }
+
+                if (auto result = parse_type(); !result)
+                {
+                    return result;
+                }
+
+                m_ast.close_node(node);
+                return {};
+            }
+
+            //(name: type, name: type) -> type { statements }
+            [[nodiscard]] auto parse_function() -> parse_result
+            {
+                const auto node = m_ast.open_node(lcl::ast_node_kind::function, m_index);
+                advance();
+
+                if (!is(lcl::token_type::close_parans))
+                {
+                    while (true)
+                    {
+                        if (auto result = parse_typed_name(lcl::ast_node_kind::parameter); !result)
+                        {
+                            return result;
+                        }
+
+                        if (!is(lcl::token_type::comma))
+                        {
+                            break;
+                        }
+
+                        advance();
+                    }
+                }
+
+                if (auto result = expect(lcl::token_type::close_parans, lcl::parser_error_type::expected_close_parans); !result)
+                {
+                    return result;
+                }
+
+                if (is_pair(lcl::token_type::minus, lcl::token_type::right_arrow))
+                {
+                    advance(2);
+
+                    if (auto result = parse_type(); !result)
+                    {
+                        return result;
+                    }
+                }
+
+                if (auto result = parse_block(); !result)
+                {
+                    return result;
+                }
+
+                m_ast.close_node(node);
+                return {};
+            }
+
+            //struct { name: type; name: type; }, the same for unions
+            [[nodiscard]] auto parse_struct(const lcl::ast_node_kind kind) -> parse_result
+            {
+                const auto node = m_ast.open_node(kind, m_index);
+                advance();
+
+                if (auto result = expect(lcl::token_type::open_curly, lcl::parser_error_type::expected_open_curly); !result)
+                {
+                    return result;
+                }
+
+                while (!is(lcl::token_type::close_curly))
+                {
+                    if (auto result = parse_typed_name(lcl::ast_node_kind::field); !result)
+                    {
+                        return result;
+                    }
+
+                    if (auto result = expect(lcl::token_type::semicolon, lcl::parser_error_type::expected_semicolon); !result)
+                    {
+                        return result;
+                    }
+                }
+
+                advance();
+
+                m_ast.close_node(node);
+                return {};
+            }
+
+            //`()` or `(name:` can't start an expression
+            [[nodiscard]] auto is_function() const noexcept -> bool
+            {
+                if (!is(lcl::token_type::open_parans))
+                {
+                    return false;
+                }
+
+                const auto next = skip_comments(m_index + 1);
+
+                if (next == m_token_count)
+                {
+                    return false;
+                }
+
+                if (m_tokens[next].type == lcl::token_type::close_parans)
+                {
+                    return true;
+                }
+
+                const auto after_next = skip_comments(next + 1);
+
+                return m_tokens[next].type == lcl::token_type::word && after_next < m_token_count && m_tokens[after_next].type == lcl::token_type::colon;
+            }
+
+            //struct | union | function | value;
+            [[nodiscard]] auto parse_constant_value() -> parse_result
+            {
+                if (is_keyword("struct"sv))
+                {
+                    return parse_struct(lcl::ast_node_kind::struct_definition);
+                }
+
+                if (is_keyword("union"sv))
+                {
+                    return parse_struct(lcl::ast_node_kind::union_definition);
+                }
+
+                if (is_function())
+                {
+                    return parse_function();
+                }
+
+                if (auto result = parse_expression_into_ast(); !result)
+                {
+                    return result;
+                }
+
+                return expect(lcl::token_type::semicolon, lcl::parser_error_type::expected_semicolon);
+            }
+
+            //name :: value | name := value; | name : type = value; | name : type;
+            [[nodiscard]] auto parse_declaration() -> parse_result
+            {
+                const auto name = m_index;
+                advance();
+
+                //Like the other operators made of two tokens, `: :` is not `::`
+                if (is_pair(lcl::token_type::colon, lcl::token_type::colon))
+                {
+                    const auto node = m_ast.open_node(lcl::ast_node_kind::constant_declaration, name);
+                    advance();
+                    advance();
+
+                    if (auto result = parse_constant_value(); !result)
+                    {
+                        return result;
+                    }
+
+                    m_ast.close_node(node);
+                    return {};
+                }
+
+                if (auto result = expect(lcl::token_type::colon, lcl::parser_error_type::expected_colon); !result)
+                {
+                    return result;
+                }
+
+                const auto node = m_ast.open_node(lcl::ast_node_kind::variable_declaration, name);
+
+                if (!is(lcl::token_type::equal))
+                {
+                    if (auto result = parse_type(); !result)
+                    {
+                        return result;
+                    }
+                }
+
+                if (is(lcl::token_type::equal))
+                {
+                    advance();
+
+                    if (auto result = parse_expression_into_ast(); !result)
+                    {
+                        return result;
+                    }
+                }
+
+                if (auto result = expect(lcl::token_type::semicolon, lcl::parser_error_type::expected_semicolon); !result)
+                {
+                    return result;
+                }
+
+                m_ast.close_node(node);
+                return {};
+            }
+
+            //{ statements }
+            [[nodiscard]] auto parse_block() -> parse_result
+            {
+                if (!is(lcl::token_type::open_curly))
+                {
+                    return error(lcl::parser_error_type::expected_open_curly);
+                }
+
+                const auto node = m_ast.open_node(lcl::ast_node_kind::block, m_index);
+                advance();
+
+                while (!is(lcl::token_type::close_curly))
+                {
+                    if (at_end())
+                    {
+                        return error(lcl::parser_error_type::expected_close_curly);
+                    }
+
+                    if (auto result = parse_statement(); !result)
+                    {
+                        return result;
+                    }
+                }
+
+                advance();
+
+                m_ast.close_node(node);
+                return {};
+            }
+
+            //if condition statement else statement | while condition statement
+            [[nodiscard]] auto parse_conditional(const lcl::ast_node_kind kind) -> parse_result
+            {
+                const auto node = m_ast.open_node(kind, m_index);
+                advance();
+
+                if (auto result = parse_expression_into_ast(); !result)
+                {
+                    return result;
+                }
+
+                if (auto result = parse_statement(); !result)
+                {
+                    return result;
+                }
+
+                if (kind == lcl::ast_node_kind::if_statement && is_keyword("else"sv))
+                {
+                    advance();
+
+                    if (auto result = parse_statement(); !result)
+                    {
+                        return result;
+                    }
+                }
+
+                m_ast.close_node(node);
+                return {};
+            }
+
+            //return value; | break; | continue;
+            [[nodiscard]] auto parse_jump(const lcl::ast_node_kind kind) -> parse_result
+            {
+                const auto node = m_ast.open_node(kind, m_index);
+                advance();
+
+                if (kind == lcl::ast_node_kind::return_statement && !is(lcl::token_type::semicolon))
+                {
+                    if (auto result = parse_expression_into_ast(); !result)
+                    {
+                        return result;
+                    }
+                }
+
+                if (auto result = expect(lcl::token_type::semicolon, lcl::parser_error_type::expected_semicolon); !result)
+                {
+                    return result;
+                }
+
+                m_ast.close_node(node);
+                return {};
+            }
+
+            //target = value; | expression;
+            [[nodiscard]] auto parse_expression_statement() -> parse_result
+            {
+                const auto first_token = m_index;
+
+                if (auto result = parse_expression(); !result)
+                {
+                    return result;
+                }
+
+                //The assignment node comes before its target, which is still waiting to be copied to the AST
+                if (is(lcl::token_type::equal))
+                {
+                    const auto node = m_ast.open_node(lcl::ast_node_kind::assignment_statement, m_index);
+                    copy_expression_to_ast();
+                    advance();
+
+                    if (auto result = parse_expression_into_ast(); !result)
+                    {
+                        return result;
+                    }
+
+                    if (auto result = expect(lcl::token_type::semicolon, lcl::parser_error_type::expected_semicolon); !result)
+                    {
+                        return result;
+                    }
+
+                    m_ast.close_node(node);
+                    return {};
+                }
+
+                const auto node = m_ast.open_node(lcl::ast_node_kind::expression_statement, first_token);
+                copy_expression_to_ast();
+
+                if (auto result = expect(lcl::token_type::semicolon, lcl::parser_error_type::expected_semicolon); !result)
+                {
+                    return result;
+                }
+
+                m_ast.close_node(node);
+                return {};
+            }
+
+            [[nodiscard]] auto parse_statement() -> parse_result
+            {
+                return parse_nested(&parser::parse_statement_of_any_kind);
+            }
+
+            [[nodiscard]] auto parse_statement_of_any_kind() -> parse_result
+            {
+                if (is(lcl::token_type::open_curly))
+                {
+                    return parse_block();
+                }
+
+                if (is_keyword("if"sv))       return parse_conditional(lcl::ast_node_kind::if_statement);
+                if (is_keyword("while"sv))    return parse_conditional(lcl::ast_node_kind::while_statement);
+                if (is_keyword("return"sv))   return parse_jump(lcl::ast_node_kind::return_statement);
+                if (is_keyword("break"sv))    return parse_jump(lcl::ast_node_kind::break_statement);
+                if (is_keyword("continue"sv)) return parse_jump(lcl::ast_node_kind::continue_statement);
+
+                if (is_identifier() && is_next(lcl::token_type::colon))
+                {
+                    return parse_declaration();
+                }
+
+                return parse_expression_statement();
+            }
+
+            auto push_expression_node(const lcl::ast_node_kind kind, const std::uint32_t first_token, const std::size_t subtree_begin) -> void
+            {
+                m_expression.push_back(expression_node { kind, first_token, static_cast<std::uint32_t>(m_expression.size() + 1 - subtree_begin) });
+            }
+
+            //The binary operator at the current token, with a binding power of none when there is none
+            [[nodiscard]] auto current_binary_operator() const noexcept -> binary_operator
+            {
+                if (at_end())
+                {
+                    return binary_operator { lcl::binding_power::none, 0 };
+                }
+
+                const auto& token = m_tokens[m_index];
+
+                //The keyword operators are the only words that are operators
+                if (token.type == lcl::token_type::word)
+                {
+                    if (token.is_keyword() && token.code == "or"sv)  return binary_operator { lcl::binding_power::logical_or, 1 };
+                    if (token.is_keyword() && token.code == "and"sv) return binary_operator { lcl::binding_power::logical_and, 1 };
+
+                    return binary_operator { lcl::binding_power::none, 0 };
+                }
+
+                const auto& binding_powers = binary_binding_powers[static_cast<std::size_t>(token.type)];
+
+                if (binding_powers.before_equal != lcl::binding_power::none && is_pair(token.type, lcl::token_type::equal))
+                {
+                    return binary_operator { binding_powers.before_equal, 2 };
+                }
+
+                if (binding_powers.doubled != lcl::binding_power::none && is_pair(token.type, token.type))
+                {
+                    return binary_operator { binding_powers.doubled, 2 };
+                }
+
+                return binary_operator { binding_powers.alone, 1 };
+            }
+
+            //-value | !value | ~value | &value | *value | not value
+            [[nodiscard]] auto is_prefix_operator() const noexcept -> bool
+            {
+                return is(lcl::token_type::minus) || is(lcl::token_type::exclamation_mark) || is(lcl::token_type::tilde) ||
+                       is(lcl::token_type::ampersand) || is(lcl::token_type::star) || is_keyword("not"sv);
+            }
+
+            //Pops the operators of this expression that bind at least as tightly as `binding_power` into nodes.
+            //Returns where the operand they make up starts, `operand_begin` when none were popped.
+            auto pop_operators(const std::size_t operators_begin, const lcl::binding_power binding_power, std::size_t operand_begin) -> std::size_t
+            {
+                while (m_operators.size() > operators_begin && m_operators.back().binding_power >= binding_power)
+                {
+                    const auto pending = m_operators.back();
+                    m_operators.pop_back();
+
+                    push_expression_node(pending.kind, pending.token, pending.subtree_begin);
+                    operand_begin = pending.subtree_begin;
+                }
+
+                return operand_begin;
+            }
+
+            //Operators are held on a stack until an operator that binds less tightly, or the end of the expression, completes
+            //their operands, so the expression is one loop over its operands whatever the precedence of the operators.
+            //Only brackets, which start a new expression, go deeper.
+            [[nodiscard]] auto parse_expression() -> parse_result
+            {
+                return parse_nested(&parser::parse_operators_and_operands);
+            }
+
+            [[nodiscard]] auto parse_operators_and_operands() -> parse_result
+            {
+                const auto operators_begin = m_operators.size();
+
+                while (true)
+                {
+                    const auto operand_begin = m_expression.size();
+
+                    while (is_prefix_operator())
+                    {
+                        m_operators.push_back(pending_operator { lcl::ast_node_kind::unary_expression, lcl::binding_power::prefix, m_index, static_cast<std::uint32_t>(operand_begin) });
+                        advance();
+                    }
+
+                    if (auto result = parse_postfix_expression(); !result)
+                    {
+                        return result;
+                    }
+
+                    const auto binary       = current_binary_operator();
+                    const auto left_operand = pop_operators(operators_begin, binary.binding_power, operand_begin);
+
+                    if (binary.binding_power == lcl::binding_power::none)
+                    {
+                        return {};
+                    }
+
+                    m_operators.push_back(pending_operator { lcl::ast_node_kind::binary_expression, binary.binding_power, m_index, static_cast<std::uint32_t>(left_operand) });
+                    advance(binary.token_count);
+                }
+            }
+
+            //value(arguments) | value[index] | value.name
+            [[nodiscard]] auto parse_postfix_expression() -> parse_result
+            {
+                const auto subtree_begin = m_expression.size();
+
+                if (auto result = parse_primary_expression(); !result)
+                {
+                    return result;
+                }
+
+                while (true)
+                {
+                    const auto operator_token = m_index;
+
+                    if (is(lcl::token_type::open_parans))
+                    {
+                        advance();
+
+                        if (!is(lcl::token_type::close_parans))
+                        {
+                            while (true)
+                            {
+                                if (auto result = parse_expression(); !result)
+                                {
+                                    return result;
+                                }
+
+                                if (!is(lcl::token_type::comma))
+                                {
+                                    break;
+                                }
+
+                                advance();
+                            }
+                        }
+
+                        if (auto result = expect(lcl::token_type::close_parans, lcl::parser_error_type::expected_close_parans); !result)
+                        {
+                            return result;
+                        }
+
+                        push_expression_node(lcl::ast_node_kind::call_expression, operator_token, subtree_begin);
+                    }
+                    else if (is(lcl::token_type::open_square_bracket))
+                    {
+                        advance();
+
+                        if (auto result = parse_expression(); !result)
+                        {
+                            return result;
+                        }
+
+                        if (auto result = expect(lcl::token_type::close_square_breacket, lcl::parser_error_type::expected_close_square_bracket); !result)
+                        {
+                            return result;
+                        }
+
+                        push_expression_node(lcl::ast_node_kind::index_expression, operator_token, subtree_begin);
+                    }
+                    else if (is(lcl::token_type::dot))
+                    {
+                        advance();
+
+                        if (!is_identifier())
+                        {
+                            return error(lcl::parser_error_type::expected_identifier);
+                        }
+
+                        push_expression_node(lcl::ast_node_kind::identifier, m_index, m_expression.size());
+                        advance();
+
+                        push_expression_node(lcl::ast_node_kind::member_expression, operator_token, subtree_begin);
+                    }
+                    else
+                    {
+                        return {};
+                    }
+                }
+            }
+
+            //name | 1 | "text" | true | false | null | (expression)
+            [[nodiscard]] auto parse_primary_expression() -> parse_result
+            {
+                if (at_end())
+                {
+                    return error(lcl::parser_error_type::expected_expression);
+                }
+
+                const auto& token = m_tokens[m_index];
+                auto        kind  = lcl::ast_node_kind{};
+
+                switch (token.type)
+                {
+                    case lcl::token_type::word:
+                    {
+                        if (!token.is_keyword())
+                        {
+                            kind = lcl::ast_node_kind::identifier;
+                        }
+                        else if (token.code == "true"sv || token.code == "false"sv)
+                        {
+                            kind = lcl::ast_node_kind::boolean_literal;
+                        }
+                        else if (token.code == "null"sv)
+                        {
+                            kind = lcl::ast_node_kind::null_literal;
+                        }
+                        else
+                        {
+                            return error(lcl::parser_error_type::expected_expression);
+                        }
+
+                        break;
+                    }
+
+                    case lcl::token_type::numeric_literal: kind = lcl::ast_node_kind::numeric_literal; break;
+                    case lcl::token_type::string_literal:  kind = lcl::ast_node_kind::string_literal;  break;
+
+                    //Parentheses only group, they have no node
+                    case lcl::token_type::open_parans:
+                    {
+                        advance();
+
+                        if (auto result = parse_expression(); !result)
+                        {
+                            return result;
+                        }
+
+                        return expect(lcl::token_type::close_parans, lcl::parser_error_type::expected_close_parans);
+                    }
+
+                    default:
+                        return error(lcl::parser_error_type::expected_expression);
+                }
+
+                push_expression_node(kind, m_index, m_expression.size());
+                advance();
+
+                return {};
+            }
+
+            //Copies the expression to the AST in pre-order. The children of a node in post-order end right before it
+            //and are found walking back from there, last to first, so pushing them on a stack pops them first to last.
+            auto copy_expression_to_ast() -> void
+            {
+                assert(!m_expression.empty());
+
+                m_expression_stack.push_back(static_cast<std::uint32_t>(m_expression.size() - 1));
+
+                while (!m_expression_stack.empty())
+                {
+                    const auto  node_index = m_expression_stack.back();
+                    const auto& node       = m_expression[node_index];
+                    m_expression_stack.pop_back();
+
+                    m_ast.add_subtree_root(node.kind, node.first_token, node.subtree_size);
+
+                    const auto subtree_begin = node_index + 1 - node.subtree_size;
+
+                    for (auto child_end = node_index; child_end != subtree_begin; child_end -= m_expression[child_end - 1].subtree_size)
+                    {
+                        m_expression_stack.push_back(child_end - 1);
+                    }
+                }
+
+                m_expression.clear();
+            }
+
+            [[nodiscard]] auto parse_expression_into_ast() -> parse_result
+            {
+                if (auto result = parse_expression(); !result)
+                {
+                    return result;
+                }
+
+                copy_expression_to_ast();
+                return {};
+            }
+
+            [[nodiscard]] auto parse_top_level_statement() -> parse_result
+            {
+                if (is_keyword("import"sv))
+                {
+                    return parse_import();
+                }
+
+                if (is_identifier())
+                {
+                    return parse_declaration();
+                }
+
+                return error(lcl::parser_error_type::unexpected_token);
+            }
+
+            public:
+            //Every node owns a token, but the global scope and the expression statements which own at most their `;`
+            //The global scope points at the first token, which is the end of the tokens when there are none
+            parser(const gsl::span<const lcl::token> tokens, lcl::memory::contiguous_virtual_memory_arena& arena) : m_tokens(tokens.data()), m_token_count(static_cast<std::uint32_t>(tokens.size())), m_ast(tokens, static_cast<std::size_t>(tokens.size()) + 1, arena)
+            {
+                m_index = skip_comments(0);
+            }
+
+            [[nodiscard]] auto parse() -> tl::expected<lcl::ast, lcl::parser_error>
+            {
+                const auto global_scope = m_ast.open_node(lcl::ast_node_kind::global_scope, 0);
+
+                while (!at_end())
+                {
+                    if (auto result = parse_top_level_statement(); !result)
+                    {
+                        return tl::unexpected(result.error());
+                    }
+                }
+
+                m_ast.close_node(global_scope);
+                return std::move(m_ast);
+            }
+        };
+    }
+
+    [[nodiscard]] auto parse_tokens(const gsl::span<const lcl::token> tokens, lcl::memory::contiguous_virtual_memory_arena& arena) -> tl::expected<lcl::ast, lcl::parser_error>
+    {
+        const auto mark   = arena.checkpoint();
+        auto       result = parser { tokens, arena }.parse();
+
+        //The nodes of a failed parse are of no use
+        if (!result)
+        {
+            arena.rollback(mark);
+        }
+
+        return result;
+    }
+}
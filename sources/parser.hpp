@@ -0,0 +1,50 @@
+#ifndef LCLCOMPILER_PARSER_HPP
+#define LCLCOMPILER_PARSER_HPP
+
+#include <cstdint>
+
+#include <gsl/span>
+#include <tl/expected.hpp>
+
+#include <ast.hpp>
+#include <memory.hpp>
+#include <tokenizer.hpp>
+
+namespace lcl
+{
+    enum class parser_error_type
+    {
+        unexpected_token,
+        unexpected_end_of_code,
+        expected_identifier,
+        expected_type,
+        expected_expression,
+        expected_semicolon,
+        expected_colon,
+        expected_open_curly,
+        expected_close_curly,
+        expected_close_parans,
+        expected_close_square_bracket,
+        nesting_too_deep,
+    };
+
+    struct parser_error
+    {
+        const lcl::parser_error_type error_type;
+        const std::uint32_t          token_index; //Equal to the number of tokens when the code ended too soon
+
+        constexpr explicit parser_error(const lcl::parser_error_type error_type, const std::uint32_t token_index) : error_type(error_type), token_index(token_index)
+        {
+            //Empty
+        }
+    };
+
+    //Parses the tokens of a file into its AST, stopping at the first error. Comments are skipped.
+    //Operators made of many characters, such as `==` or `->`, are their single char tokens joined together by the tokenizer,
+    //see `token::is_joined_to_previous`. The tokens must outlive the AST.
+    //Every node goes straight into the arrays of the AST, which are allocated from `arena` once, parsing allocates nothing per node.
+    //The arena must outlive the AST, what a failed parse allocated is rolled back.
+    [[nodiscard]] auto parse_tokens(const gsl::span<const lcl::token> tokens, lcl::memory::contiguous_virtual_memory_arena& arena) -> tl::expected<lcl::ast, lcl::parser_error>;
+}
+
+#endif //LCLCOMPILER_PARSER_HPP
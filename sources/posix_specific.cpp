@@ -0,0 +1,123 @@
+#if !defined(_WIN32)
+
+#include <cstddef>
+#include <cassert>
+#include <new>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace lcl::memory
+{
+    [[nodiscard]] auto get_page_size() -> std::size_t
+    {
+        static const auto page_size = static_cast<std::size_t>(sysconf(_SC_PAGESIZE));
+
+        return page_size;
+    }
+
+    //The pages can't be touched until they are committed and don't count towards the memory used by the process
+    [[nodiscard]] auto reserve_memory_pages(const std::size_t pages_to_reserve) -> std::byte*
+    {
+        auto result = mmap(nullptr, pages_to_reserve * get_page_size(), PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+
+        if (result == MAP_FAILED)
+        {
+            throw std::bad_alloc{};
+        }
+
+        return static_cast<std::byte*>(result);
+    }
+
+    //The pages become readable and writable, the kernel only backs each one with memory the first time it is touched
+    auto commit_memory_pages(const void* base_address, const std::size_t pages_to_commit) -> void
+    {
+        if (mprotect(const_cast<void*>(base_address), pages_to_commit * get_page_size(), PROT_READ | PROT_WRITE) != 0)
+        {
+            throw std::bad_alloc{};
+        }
+    }
+
+    //The memory backing the pages is given back right away and the pages can't be touched until they are committed again, they will read as zeros
+    auto decommit_memory_pages(const void* base_address, const std::size_t pages_to_uncommit) -> void
+    {
+        const auto result = madvise(const_cast<void*>(base_address), pages_to_uncommit * get_page_size(), MADV_DONTNEED) == 0
+                         && mprotect(const_cast<void*>(base_address), pages_to_uncommit * get_page_size(), PROT_NONE) == 0;
+
+        assert(result);
+        static_cast<void>(result);
+    }
+
+    auto unreserve_memory_pages(const void* base_address, const std::size_t pages_to_unreserve) -> void
+    {
+        const auto result = munmap(const_cast<void*>(base_address), pages_to_unreserve * get_page_size());
+
+        assert(result == 0);
+        static_cast<void>(result);
+    }
+
+    auto release_memory_pages(const void* base_address, const std::size_t pages_to_release) -> void
+    {
+        #if defined(MADV_FREE)
+            //Not supported before linux 4.5
+            if (madvise(const_cast<void*>(base_address), pages_to_release * get_page_size(), MADV_FREE) == 0)
+            {
+                return;
+            }
+        #endif
+
+        //The memory is given back right away instead
+        const auto result = madvise(const_cast<void*>(base_address), pages_to_release * get_page_size(), MADV_DONTNEED);
+
+        assert(result == 0);
+        static_cast<void>(result);
+    }
+
+    auto advise_huge_memory_pages(const void* base_address, const std::size_t pages_to_advise) -> void
+    {
+        #if defined(MADV_HUGEPAGE)
+            //Fails when transparent huge pages are disabled, the pages are then regular ones
+            static_cast<void>(madvise(const_cast<void*>(base_address), pages_to_advise * get_page_size(), MADV_HUGEPAGE));
+        #else
+            static_cast<void>(base_address);
+            static_cast<void>(pages_to_advise);
+        #endif
+    }
+
+    [[nodiscard]] auto map_file(const char* path, std::size_t& file_size) -> const std::byte*
+    {
+        const auto file = open(path, O_RDONLY);
+
+        if (file == -1)
+        {
+            return nullptr;
+        }
+
+        struct stat file_status {};
+
+        if (fstat(file, &file_status) != 0 || file_status.st_size == 0)
+        {
+            close(file);
+            return nullptr;
+        }
+
+        file_size = static_cast<std::size_t>(file_status.st_size);
+
+        //The mapping keeps the file open
+        const auto result = mmap(nullptr, file_size, PROT_READ, MAP_PRIVATE, file, 0);
+        close(file);
+
+        return result == MAP_FAILED ? nullptr : static_cast<const std::byte*>(result);
+    }
+
+    auto unmap_file(const void* base_address, const std::size_t file_size) -> void
+    {
+        const auto result = munmap(const_cast<void*>(base_address), file_size);
+
+        assert(result == 0);
+        static_cast<void>(result);
+    }
+}
+
+#endif
@@ -0,0 +1,32 @@
+#ifndef LCLCOMPILER_SIMD_HPP
+#define LCLCOMPILER_SIMD_HPP
+
+#include <cstdint>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    #define LCL_SSE2 1
+    #include <emmintrin.h>
+#else
+    #define LCL_SSE2 0
+#endif
+
+#if defined(_MSC_VER)
+    #include <intrin.h>
+#endif
+
+namespace lcl::simd
+{
+    //`it` must not be 0
+    [[nodiscard]] inline auto count_trailing_zeros(const std::uint32_t it) noexcept -> int
+    {
+        #if defined(_MSC_VER)
+            unsigned long index = 0;
+            _BitScanForward(&index, it);
+            return static_cast<int>(index);
+        #else
+            return __builtin_ctz(it);
+        #endif
+    }
+}
+
+#endif //LCLCOMPILER_SIMD_HPP
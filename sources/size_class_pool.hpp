@@ -0,0 +1,160 @@
+#ifndef LCLCOMPILER_SIZE_CLASS_POOL_HPP
+#define LCLCOMPILER_SIZE_CLASS_POOL_HPP
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cstddef>
+#include <new>
+#include <utility>
+
+#include <memory.hpp>
+
+namespace lcl::memory
+{
+    //Sizes of the slots handed out by `size_class_pool`. Tune them with the statistics of the pool against the real sizes of the nodes.
+    constexpr auto size_classes = std::array<std::size_t, 10> { 8, 16, 24, 32, 48, 64, 96, 128, 192, 256 };
+
+    struct size_class_stats
+    {
+        std::size_t slot_size          = 0;
+        std::size_t allocation_count   = 0;
+        std::size_t deallocation_count = 0;
+        std::size_t live_count         = 0;
+        std::size_t peak_live_count    = 0;
+        std::size_t slot_count         = 0;   //Slots taken from the arena, live or free
+        std::size_t requested_bytes    = 0;   //Sum of the sizes asked for, compared with `allocation_count * slot_size` it gives the waste
+    };
+
+    //Hands out fixed size slots for nodes that are freed and made again, which a bump arena can't reuse. Eg: the AST in incremental mode.
+    //Each size class keeps the slots that are freed in a list threaded through the slots themselves, allocating pops from it.
+    //When a list is empty, `slots_per_refill` slots are carved out of the arena at once. The slots only go back to the arena with it.
+    //Sizes bigger than the biggest class are bump allocated from the arena and never reused. Not thread safe, use one pool per thread.
+    class size_class_pool
+    {
+        public:
+        static constexpr std::size_t slots_per_refill = 64;
+
+        //Every slot is aligned to this, slots of classes that are multiples of 16 are aligned to 16
+        static constexpr std::size_t slot_alignment = 8;
+
+        private:
+        struct free_slot
+        {
+            free_slot* next;
+        };
+
+        contiguous_virtual_memory_arena&                               m_arena;
+        std::array<free_slot*, size_classes.size()>                    m_free_lists = {};
+        std::array<lcl::memory::size_class_stats, size_classes.size()> m_stats;
+        lcl::memory::size_class_stats                                  m_oversize_stats;
+
+        [[nodiscard]] static auto size_class_index(const std::size_t size) noexcept -> std::size_t
+        {
+            return static_cast<std::size_t>(std::lower_bound(std::cbegin(size_classes), std::cend(size_classes), size) - std::cbegin(size_classes));
+        }
+
+        auto refill(const std::size_t class_index) -> void
+        {
+            const auto slot_size = size_classes[class_index];
+            const auto slots     = m_arena.allocate(slot_size * slots_per_refill, alignof(std::max_align_t));
+
+            //Pushed from the last so the slots are handed out in address order
+            for (auto i = slots_per_refill; i != 0; --i)
+            {
+                const auto slot = new (slots + (i - 1) * slot_size) free_slot { m_free_lists[class_index] };
+                m_free_lists[class_index] = slot;
+            }
+
+            m_stats[class_index].slot_count += slots_per_refill;
+        }
+
+        public:
+        explicit size_class_pool(contiguous_virtual_memory_arena& arena) noexcept : m_arena(arena)
+        {
+            for (auto i = std::size_t { 0 }; i < size_classes.size(); ++i)
+            {
+                m_stats[i].slot_size = size_classes[i];
+            }
+        }
+
+        size_class_pool(const size_class_pool&) = delete;
+        size_class_pool& operator=(const size_class_pool&) = delete;
+
+        [[nodiscard]] auto allocate(const std::size_t size, const std::size_t alignment = slot_alignment) -> void*
+        {
+            assert(size != 0 && alignment <= alignof(std::max_align_t));
+
+            const auto class_index = size_class_index(size);
+
+            if (class_index == size_classes.size())
+            {
+                ++m_oversize_stats.allocation_count;
+                m_oversize_stats.requested_bytes += size;
+
+                return m_arena.allocate(size, alignment);
+            }
+
+            assert(alignment <= slot_alignment || size_classes[class_index] % alignment == 0);
+
+            if (m_free_lists[class_index] == nullptr)
+            {
+                refill(class_index);
+            }
+
+            const auto slot = m_free_lists[class_index];
+            m_free_lists[class_index] = slot->next;
+
+            auto& stats = m_stats[class_index];
+            ++stats.allocation_count;
+            ++stats.live_count;
+            stats.peak_live_count  = std::max(stats.peak_live_count, stats.live_count);
+            stats.requested_bytes += size;
+
+            return slot;
+        }
+
+        //`size` must be the size `pointer` was allocated with
+        auto deallocate(void* const pointer, const std::size_t size) noexcept -> void
+        {
+            const auto class_index = size_class_index(size);
+
+            if (class_index == size_classes.size())
+            {
+                ++m_oversize_stats.deallocation_count;
+                return;
+            }
+
+            m_free_lists[class_index] = new (pointer) free_slot { m_free_lists[class_index] };
+
+            auto& stats = m_stats[class_index];
+            ++stats.deallocation_count;
+            --stats.live_count;
+        }
+
+        template <class T, class... Args> [[nodiscard]] auto make(Args&&... args) -> T*
+        {
+            return new (allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+        }
+
+        template <class T> auto destroy(T* const pointer) noexcept -> void
+        {
+            pointer->~T();
+            deallocate(pointer, sizeof(T));
+        }
+
+        //In the order of `size_classes`
+        [[nodiscard]] auto stats() const noexcept -> const std::array<lcl::memory::size_class_stats, size_classes.size()>&
+        {
+            return m_stats;
+        }
+
+        //Allocations bigger than the biggest size class
+        [[nodiscard]] auto oversize_stats() const noexcept -> const lcl::memory::size_class_stats&
+        {
+            return m_oversize_stats;
+        }
+    };
+}
+
+#endif //LCLCOMPILER_SIZE_CLASS_POOL_HPP
@@ -0,0 +1,410 @@
+#ifndef LCLCOMPILER_SMALL_VECTOR_HPP
+#define LCLCOMPILER_SMALL_VECTOR_HPP
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <initializer_list>
+#include <iterator>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace lcl
+{
+    //A vector that keeps up to `N` elements inside itself and only allocates once it grows past them.
+    //Eg: the children of an AST node or the parameters of a function, which are almost always a few.
+    //Takes any allocator, such as `lcl::memory::virtual_arena_allocator` to put the elements that don't fit inline in an arena.
+    template <class T, std::size_t N, class Allocator = std::allocator<T>> class small_vector
+    {
+        static_assert(N != 0, "A small_vector without inline elements is a std::vector");
+
+        public:
+        using value_type      = T;
+        using allocator_type  = Allocator;
+        using size_type       = std::size_t;
+        using difference_type = std::ptrdiff_t;
+        using iterator        = T*;
+        using const_iterator  = const T*;
+
+        static constexpr std::size_t inline_capacity = N;
+
+        private:
+        using allocator_traits = std::allocator_traits<Allocator>;
+
+        alignas(T) std::byte m_inline_storage[N * sizeof(T)];
+
+        T*          m_data     = reinterpret_cast<T*>(m_inline_storage);
+        std::size_t m_size     = 0;
+        std::size_t m_capacity = N;
+        Allocator   m_allocator;
+
+        [[nodiscard]] auto inline_data() noexcept -> T*
+        {
+            return reinterpret_cast<T*>(m_inline_storage);
+        }
+
+        //Moves the elements into `new_data`, or copies them when moving could throw. When it throws, the elements
+        //already built in `new_data` are destroyed and the vector is left as it was.
+        auto relocate_elements_to(T* const new_data) -> void
+        {
+            auto relocated = std::size_t { 0 };
+
+            try
+            {
+                for (; relocated < m_size; ++relocated)
+                {
+                    ::new (static_cast<void*>(new_data + relocated)) T(std::move_if_noexcept(m_data[relocated]));
+                }
+            }
+            catch (...)
+            {
+                std::destroy(new_data, new_data + relocated);
+                throw;
+            }
+        }
+
+        //Switches to `new_data` once the elements have been relocated to it
+        auto adopt_storage(T* const new_data, const std::size_t new_capacity) noexcept -> void
+        {
+            std::destroy(m_data, m_data + m_size);
+            free_heap_storage();
+
+            m_data     = new_data;
+            m_capacity = new_capacity;
+        }
+
+        //Moves the elements into storage for `new_capacity` elements
+        auto reallocate(const std::size_t new_capacity) -> void
+        {
+            assert(new_capacity >= m_size && new_capacity > N);
+
+            const auto new_data = allocator_traits::allocate(m_allocator, new_capacity);
+
+            try
+            {
+                relocate_elements_to(new_data);
+            }
+            catch (...)
+            {
+                allocator_traits::deallocate(m_allocator, new_data, new_capacity);
+                throw;
+            }
+
+            adopt_storage(new_data, new_capacity);
+        }
+
+        //The new element is built before the old ones are moved, `args` can refer to one of them, Eg: `push_back(v[0])`
+        template <class... Args> auto reallocate_and_emplace_back(Args&&... args) -> T&
+        {
+            const auto new_capacity = m_capacity * 2;
+            const auto new_data     = allocator_traits::allocate(m_allocator, new_capacity);
+            auto       element      = static_cast<T*>(nullptr);
+
+            try
+            {
+                element = ::new (static_cast<void*>(new_data + m_size)) T(std::forward<Args>(args)...);
+
+                try
+                {
+                    relocate_elements_to(new_data);
+                }
+                catch (...)
+                {
+                    element->~T();
+                    throw;
+                }
+            }
+            catch (...)
+            {
+                allocator_traits::deallocate(m_allocator, new_data, new_capacity);
+                throw;
+            }
+
+            adopt_storage(new_data, new_capacity);
+            ++m_size;
+
+            return *element;
+        }
+
+        auto free_heap_storage() noexcept -> void
+        {
+            if (!is_inline())
+            {
+                allocator_traits::deallocate(m_allocator, m_data, m_capacity);
+            }
+        }
+
+        //Takes the elements of `other`, which is left empty. The allocators must be able to free each other's memory.
+        auto take_elements_of(small_vector& other) -> void
+        {
+            assert(m_size == 0 && is_inline());
+
+            if (!other.is_inline())
+            {
+                m_data     = std::exchange(other.m_data, other.inline_data());
+                m_size     = std::exchange(other.m_size, 0);
+                m_capacity = std::exchange(other.m_capacity, N);
+                return;
+            }
+
+            for (auto i = std::size_t { 0 }; i < other.m_size; ++i)
+            {
+                ::new (static_cast<void*>(m_data + i)) T(std::move(other.m_data[i]));
+            }
+
+            m_size = other.m_size;
+            other.clear();
+        }
+
+        public:
+        small_vector() = default;
+
+        explicit small_vector(const Allocator& allocator) noexcept : m_allocator(allocator)
+        {
+            //Empty
+        }
+
+        small_vector(const std::initializer_list<T> values, const Allocator& allocator = Allocator()) : m_allocator(allocator)
+        {
+            reserve(values.size());
+
+            for (const auto& value : values)
+            {
+                emplace_back(value);
+            }
+        }
+
+        small_vector(const small_vector& other) : m_allocator(allocator_traits::select_on_container_copy_construction(other.m_allocator))
+        {
+            reserve(other.m_size);
+
+            for (const auto& value : other)
+            {
+                emplace_back(value);
+            }
+        }
+
+        small_vector(small_vector&& other) noexcept(std::is_nothrow_move_constructible_v<T>) : m_allocator(other.m_allocator)
+        {
+            take_elements_of(other);
+        }
+
+        small_vector& operator=(const small_vector& other)
+        {
+            if (this == &other)
+            {
+                return *this;
+            }
+
+            clear();
+
+            if constexpr (allocator_traits::propagate_on_container_copy_assignment::value)
+            {
+                free_heap_storage();
+                m_data      = inline_data();
+                m_capacity  = N;
+                m_allocator = other.m_allocator;
+            }
+
+            reserve(other.m_size);
+
+            for (const auto& value : other)
+            {
+                emplace_back(value);
+            }
+
+            return *this;
+        }
+
+        small_vector& operator=(small_vector&& other) noexcept(std::is_nothrow_move_constructible_v<T>)
+        {
+            if (this == &other)
+            {
+                return *this;
+            }
+
+            clear();
+            free_heap_storage();
+            m_data     = inline_data();
+            m_capacity = N;
+
+            if constexpr (allocator_traits::propagate_on_container_move_assignment::value)
+            {
+                m_allocator = other.m_allocator;
+            }
+            else if (m_allocator != other.m_allocator)
+            {
+                //The heap storage of `other` can't be freed with our allocator, only its elements are taken
+                reserve(other.m_size);
+
+                for (auto& value : other)
+                {
+                    emplace_back(std::move(value));
+                }
+
+                other.clear();
+                return *this;
+            }
+
+            take_elements_of(other);
+            return *this;
+        }
+
+        template <class... Args> auto emplace_back(Args&&... args) -> T&
+        {
+            if (m_size == m_capacity)
+            {
+                return reallocate_and_emplace_back(std::forward<Args>(args)...);
+            }
+
+            const auto element = ::new (static_cast<void*>(m_data + m_size)) T(std::forward<Args>(args)...);
+            ++m_size;
+
+            return *element;
+        }
+
+        auto push_back(const T& value) -> void
+        {
+            emplace_back(value);
+        }
+
+        auto push_back(T&& value) -> void
+        {
+            emplace_back(std::move(value));
+        }
+
+        auto pop_back() noexcept -> void
+        {
+            assert(m_size != 0);
+
+            --m_size;
+            m_data[m_size].~T();
+        }
+
+        //Keeps the storage, see `shrink_to_fit`
+        auto clear() noexcept -> void
+        {
+            while (m_size != 0)
+            {
+                pop_back();
+            }
+        }
+
+        auto reserve(const std::size_t capacity) -> void
+        {
+            if (capacity > m_capacity)
+            {
+                reallocate(capacity);
+            }
+        }
+
+        auto resize(const std::size_t size) -> void
+        {
+            reserve(size);
+
+            while (m_size < size)
+            {
+                emplace_back();
+            }
+
+            while (m_size > size)
+            {
+                pop_back();
+            }
+        }
+
+        //Moves the elements back inside when they fit
+        auto shrink_to_fit() -> void
+        {
+            if (is_inline() || m_size > N)
+            {
+                return;
+            }
+
+            const auto heap_data     = m_data;
+            const auto heap_capacity = m_capacity;
+
+            m_data     = inline_data();
+            m_capacity = N;
+
+            for (auto i = std::size_t { 0 }; i < m_size; ++i)
+            {
+                ::new (static_cast<void*>(m_data + i)) T(std::move(heap_data[i]));
+                heap_data[i].~T();
+            }
+
+            allocator_traits::deallocate(m_allocator, heap_data, heap_capacity);
+        }
+
+        [[nodiscard]] auto operator[](const std::size_t index) noexcept -> T&
+        {
+            assert(index < m_size);
+            return m_data[index];
+        }
+
+        [[nodiscard]] auto operator[](const std::size_t index) const noexcept -> const T&
+        {
+            assert(index < m_size);
+            return m_data[index];
+        }
+
+        [[nodiscard]] auto front() noexcept -> T&             { assert(m_size != 0); return m_data[0]; }
+        [[nodiscard]] auto front() const noexcept -> const T& { assert(m_size != 0); return m_data[0]; }
+        [[nodiscard]] auto back() noexcept -> T&              { assert(m_size != 0); return m_data[m_size - 1]; }
+        [[nodiscard]] auto back() const noexcept -> const T&  { assert(m_size != 0); return m_data[m_size - 1]; }
+
+        [[nodiscard]] auto begin() noexcept -> iterator              { return m_data; }
+        [[nodiscard]] auto begin() const noexcept -> const_iterator  { return m_data; }
+        [[nodiscard]] auto end() noexcept -> iterator                { return m_data + m_size; }
+        [[nodiscard]] auto end() const noexcept -> const_iterator    { return m_data + m_size; }
+
+        [[nodiscard]] auto data() noexcept -> T*             { return m_data; }
+        [[nodiscard]] auto data() const noexcept -> const T* { return m_data; }
+
+        [[nodiscard]] auto size() const noexcept -> std::size_t
+        {
+            return m_size;
+        }
+
+        [[nodiscard]] auto empty() const noexcept -> bool
+        {
+            return m_size == 0;
+        }
+
+        [[nodiscard]] auto capacity() const noexcept -> std::size_t
+        {
+            return m_capacity;
+        }
+
+        //True while the elements are stored inside the vector
+        [[nodiscard]] auto is_inline() const noexcept -> bool
+        {
+            return m_data == reinterpret_cast<const T*>(m_inline_storage);
+        }
+
+        [[nodiscard]] auto get_allocator() const noexcept -> Allocator
+        {
+            return m_allocator;
+        }
+
+        ~small_vector()
+        {
+            clear();
+            free_heap_storage();
+        }
+    };
+
+    template <class T, std::size_t N, class Allocator> [[nodiscard]] auto operator==(const small_vector<T, N, Allocator>& lhs, const small_vector<T, N, Allocator>& rhs) -> bool
+    {
+        return std::equal(std::cbegin(lhs), std::cend(lhs), std::cbegin(rhs), std::cend(rhs));
+    }
+
+    template <class T, std::size_t N, class Allocator> [[nodiscard]] auto operator!=(const small_vector<T, N, Allocator>& lhs, const small_vector<T, N, Allocator>& rhs) -> bool
+    {
+        return !(lhs == rhs);
+    }
+}
+
+#endif //LCLCOMPILER_SMALL_VECTOR_HPP
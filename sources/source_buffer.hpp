@@ -0,0 +1,112 @@
+#ifndef LCLCOMPILER_SOURCE_BUFFER_HPP
+#define LCLCOMPILER_SOURCE_BUFFER_HPP
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <iterator>
+#include <memory>
+#include <string_view>
+#include <utility>
+
+namespace lcl
+{
+    //Owns a copy of some code followed by a null sentinel and then `padding_size` more null bytes, all of them readable.
+    //The sentinel lets the tokenizer stop on a character instead of comparing against the end on every step,
+    //and the padding lets code read a full block past the last character without checking bounds.
+    class source_buffer
+    {
+        public:
+        static constexpr std::size_t padding_size = 64;
+
+        private:
+        //The padded code of a buffer that has no memory, after it was moved from
+        static constexpr char empty_padded_code[1 + padding_size] = {};
+
+        std::unique_ptr<char[]> m_data;
+        std::size_t             m_size     = 0;
+        std::size_t             m_capacity = 0;    //Without the sentinel and the padding
+
+        //The code is left unset
+        explicit source_buffer(const std::size_t size) : m_data(new char[size + 1 + padding_size]), m_size(size), m_capacity(size)
+        {
+            std::memset(m_data.get() + size, 0, 1 + padding_size);
+        }
+
+        public:
+        explicit source_buffer(const std::string_view& code) : source_buffer(code.size())
+        {
+            //Unlike memcpy, copying an empty view that has no data is fine
+            std::copy(std::cbegin(code), std::cend(code), m_data.get());
+        }
+
+        //A buffer for `size` characters of code that are written through `writable_code` afterwards, Eg: to read a file straight into it without a copy
+        [[nodiscard]] static auto with_size(const std::size_t size) -> source_buffer
+        {
+            return source_buffer { size };
+        }
+
+        //Replaces the code, the memory is only reallocated when the new code does not fit. 
+        //Lets a buffer be reused for many files.
+        auto assign(const std::string_view& code) -> void
+        {
+            if (code.size() > m_capacity)
+            {
+                m_data.reset(new char[code.size() + 1 + padding_size]);
+                m_capacity = code.size();
+            }
+
+            m_size = code.size();
+
+            std::copy(std::cbegin(code), std::cend(code), m_data.get());
+            std::memset(m_data.get() + code.size(), 0, 1 + padding_size);
+        }
+
+        //The moved from buffer is left empty and without memory, it can still be tokenized or reused with `assign`
+        source_buffer(source_buffer&& other) noexcept : m_data(std::move(other.m_data)), m_size(std::exchange(other.m_size, 0)), m_capacity(std::exchange(other.m_capacity, 0))
+        {
+        }
+
+        source_buffer& operator=(source_buffer&& other) noexcept
+        {
+            m_data     = std::move(other.m_data);
+            m_size     = std::exchange(other.m_size, 0);
+            m_capacity = std::exchange(other.m_capacity, 0);
+
+            return *this;
+        }
+
+        source_buffer(const source_buffer&) = delete;
+        source_buffer& operator=(const source_buffer&) = delete;
+
+        //The code without the sentinel and the padding.
+        [[nodiscard]] auto code() const noexcept -> std::string_view
+        {
+            return std::string_view { data(), m_size };
+        }
+
+        //The code followed by the sentinel and the padding, every character in it can be read.
+        [[nodiscard]] auto padded_code() const noexcept -> std::string_view
+        {
+            return std::string_view { data(), m_size + 1 + padding_size };
+        }
+
+        [[nodiscard]] auto data() const noexcept -> const char*
+        {
+            return m_data != nullptr ? m_data.get() : empty_padded_code;
+        }
+
+        //The `size()` characters of code, the sentinel and the padding must stay as they are
+        [[nodiscard]] auto writable_code() noexcept -> char*
+        {
+            return m_data.get();
+        }
+
+        [[nodiscard]] auto size() const noexcept -> std::size_t
+        {
+            return m_size;
+        }
+    };
+}
+
+#endif //LCLCOMPILER_SOURCE_BUFFER_HPP
@@ -0,0 +1,88 @@
+#include <algorithm>
+#include <cassert>
+#include <fstream>
+#include <limits>
+
+#include <tl/expected.hpp>
+
+#include <source_file.hpp>
+
+namespace lcl
+{
+    [[nodiscard]] auto source_file::load() -> tl::expected<std::shared_ptr<const lcl::source_buffer>, std::error_code>
+    {
+        const auto lock = std::lock_guard { m_mutex };
+
+        if (auto buffer = m_buffer.lock())
+        {
+            return buffer;
+        }
+
+        auto file = std::ifstream { m_path, std::ios::binary | std::ios::ate };
+
+        if (!file)
+        {
+            return tl::unexpected(std::make_error_code(std::errc::no_such_file_or_directory));
+        }
+
+        const auto size = static_cast<std::size_t>(file.tellg());
+
+        //Offsets are 32 bits in `source_location`
+        if (size > std::numeric_limits<std::uint32_t>::max())
+        {
+            return tl::unexpected(std::make_error_code(std::errc::file_too_large));
+        }
+
+        //Read straight into the buffer, the file is never held twice
+        auto buffer = std::make_shared<lcl::source_buffer>(lcl::source_buffer::with_size(size));
+
+        if (!file.seekg(0) || !file.read(buffer->writable_code(), static_cast<std::streamsize>(size)))
+        {
+            return tl::unexpected(std::make_error_code(std::errc::io_error));
+        }
+
+        m_buffer = buffer;
+        ++m_load_count;
+
+        return buffer;
+    }
+
+    [[nodiscard]] auto source_file::text_at(const lcl::source_location& location) -> tl::expected<std::string, std::error_code>
+    {
+        return load().and_then([&](const std::shared_ptr<const lcl::source_buffer>& buffer) -> tl::expected<std::string, std::error_code>
+        {
+            if (std::size_t { location.offset } + location.size > buffer->size())
+            {
+                return tl::unexpected(std::make_error_code(std::errc::invalid_argument));
+            }
+
+            return std::string { buffer->code().substr(location.offset, location.size) };
+        });
+    }
+
+    [[nodiscard]] auto source_file::lines_at(const lcl::source_location& location) -> tl::expected<std::string, std::error_code>
+    {
+        return load().and_then([&](const std::shared_ptr<const lcl::source_buffer>& buffer) -> tl::expected<std::string, std::error_code>
+        {
+            const auto code = buffer->code();
+
+            if (std::size_t { location.offset } + location.size > code.size())
+            {
+                return tl::unexpected(std::make_error_code(std::errc::invalid_argument));
+            }
+
+            const auto line_begin = location.offset == 0 ? std::string_view::npos : code.rfind('\n', location.offset - 1);
+            const auto begin      = line_begin == std::string_view::npos ? 0 : line_begin + 1;
+            const auto end        = std::min(code.find('\n', location.offset + location.size), code.size());
+
+            return std::string { code.substr(begin, end - begin) };
+        });
+    }
+
+    [[nodiscard]] auto source_file::location_of(const lcl::source_buffer& buffer, const std::string_view& code) noexcept -> lcl::source_location
+    {
+        assert(code.data() >= buffer.data() && code.data() + code.size() <= buffer.data() + buffer.size());
+
+        return lcl::source_location { static_cast<std::uint32_t>(code.data() - buffer.data()), static_cast<std::uint32_t>(code.size()) };
+    }
+}
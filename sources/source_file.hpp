@@ -0,0 +1,78 @@
+#ifndef LCLCOMPILER_SOURCE_FILE_HPP
+#define LCLCOMPILER_SOURCE_FILE_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <system_error>
+
+#include <tl/expected.hpp>
+
+#include <source_buffer.hpp>
+
+namespace lcl
+{
+    //Where some code is in its file. Unlike a view into the text it stays valid once the text is unloaded.
+    struct source_location
+    {
+        std::uint32_t offset = 0;
+        std::uint32_t size   = 0;
+    };
+
+    //A file of code whose text is only in memory while something uses it. `load` hands out shared references to a single buffer
+    //and the buffer is freed with the last of them. Once the tokens of a module are interned (see `string_pool::intern_tokens`)
+    //and its AST is done with the raw text, the module drops its reference and the text stops taking memory.
+    //Diagnostics keep `source_location`s instead of views and reload the text when they are printed.
+    //The file must not change on disk during the build. Safe to use from many threads.
+    class source_file
+    {
+        std::string                               m_path;
+        mutable std::mutex                        m_mutex;
+        std::weak_ptr<const lcl::source_buffer>   m_buffer;
+        std::size_t                               m_load_count = 0;
+
+        public:
+        explicit source_file(std::string path) : m_path(std::move(path))
+        {
+            //Empty
+        }
+
+        source_file(const source_file&) = delete;
+        source_file& operator=(const source_file&) = delete;
+
+        //Returns the buffer that is already loaded, or reads the file into a new one
+        [[nodiscard]] auto load() -> tl::expected<std::shared_ptr<const lcl::source_buffer>, std::error_code>;
+
+        //Copies the code at `location`, reloading the file when it was unloaded
+        [[nodiscard]] auto text_at(const lcl::source_location& location) -> tl::expected<std::string, std::error_code>;
+
+        //Copies the whole lines around the code at `location`, without the last newline. What a diagnostic prints.
+        [[nodiscard]] auto lines_at(const lcl::source_location& location) -> tl::expected<std::string, std::error_code>;
+
+        //`code` must be a view into `buffer`, such as the code of a token
+        [[nodiscard]] static auto location_of(const lcl::source_buffer& buffer, const std::string_view& code) noexcept -> lcl::source_location;
+
+        [[nodiscard]] auto is_loaded() const -> bool
+        {
+            const auto lock = std::lock_guard { m_mutex };
+            return !m_buffer.expired();
+        }
+
+        //Times the file was read from disk
+        [[nodiscard]] auto load_count() const -> std::size_t
+        {
+            const auto lock = std::lock_guard { m_mutex };
+            return m_load_count;
+        }
+
+        [[nodiscard]] auto path() const noexcept -> const std::string&
+        {
+            return m_path;
+        }
+    };
+}
+
+#endif //LCLCOMPILER_SOURCE_FILE_HPP
@@ -0,0 +1,120 @@
+#ifndef LCLCOMPILER_SPSC_QUEUE_HPP
+#define LCLCOMPILER_SPSC_QUEUE_HPP
+
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace lcl
+{
+    //@Cleanup: replace with std::hardware_destructive_interference_size once every compiler we use has it
+    constexpr std::size_t cache_line_size = 64;
+
+    //Lock-free ring buffer for exactly one producer thread and one consumer thread.
+    //Each index lives on its own cache line next to the other side's cached copy of it,
+    //so the two threads only share a cache line when the cached copy runs out and has to be refreshed.
+    template <class T> class spsc_queue
+    {
+        using slot = std::aligned_storage_t<sizeof(T), alignof(T)>;
+
+        const std::size_t       m_capacity;
+        const std::size_t       m_index_mask;
+        std::unique_ptr<slot[]> m_slots;
+
+        //Written by the consumer.
+        alignas(lcl::cache_line_size) std::atomic<std::size_t> m_head { 0 };
+        std::size_t                                             m_cached_tail = 0;
+
+        //Written by the producer.
+        alignas(lcl::cache_line_size) std::atomic<std::size_t> m_tail { 0 };
+        std::size_t                                             m_cached_head = 0;
+
+        //Keeps whatever is allocated after the queue off the producer's cache line.
+        alignas(lcl::cache_line_size) char m_padding = 0;
+
+        [[nodiscard]] auto slot_at(const std::size_t index) noexcept -> T*
+        {
+            return std::launder(reinterpret_cast<T*>(&m_slots[index & m_index_mask]));
+        }
+
+        public:
+        //`capacity` must be a power of 2.
+        explicit spsc_queue(const std::size_t capacity) : m_capacity(capacity), m_index_mask(capacity - 1), m_slots(new slot[capacity])
+        {
+            assert(capacity != 0 && (capacity & (capacity - 1)) == 0);
+        }
+
+        spsc_queue(const spsc_queue&) = delete;
+        spsc_queue& operator=(const spsc_queue&) = delete;
+
+        [[nodiscard]] auto capacity() const noexcept -> std::size_t
+        {
+            return m_capacity;
+        }
+
+        //Producer only. Copies as many elements of [first, last) as fit and publishes them all at once.
+        //Returns an iterator to the first element that was not pushed.
+        template <class InputIt> auto try_push(InputIt first, const InputIt last) -> InputIt
+        {
+            const auto tail = m_tail.load(std::memory_order_relaxed);
+
+            if (tail - m_cached_head == m_capacity)
+            {
+                m_cached_head = m_head.load(std::memory_order_acquire);
+            }
+
+            auto new_tail = tail;
+
+            for (; first != last && new_tail - m_cached_head != m_capacity; ++first, ++new_tail)
+            {
+                new (slot_at(new_tail)) T { *first };
+            }
+
+            m_tail.store(new_tail, std::memory_order_release);
+
+            return first;
+        }
+
+        //Consumer only. Hands up to `max_count` elements to `consume` and frees their slots all at once.
+        //Returns how many elements were consumed.
+        template <class F> auto try_pop(F&& consume, const std::size_t max_count) -> std::size_t
+        {
+            const auto head = m_head.load(std::memory_order_relaxed);
+
+            if (m_cached_tail == head)
+            {
+                m_cached_tail = m_tail.load(std::memory_order_acquire);
+            }
+
+            auto new_head = head;
+
+            for (; new_head != m_cached_tail && new_head - head != max_count; ++new_head)
+            {
+                const auto element = slot_at(new_head);
+
+                consume(std::move(*element));
+                element->~T();
+            }
+
+            m_head.store(new_head, std::memory_order_release);
+
+            return new_head - head;
+        }
+
+        ~spsc_queue()
+        {
+            const auto tail = m_tail.load(std::memory_order_acquire);
+
+            for (auto head = m_head.load(std::memory_order_acquire); head != tail; ++head)
+            {
+                slot_at(head)->~T();
+            }
+        }
+    };
+}
+
+#endif //LCLCOMPILER_SPSC_QUEUE_HPP
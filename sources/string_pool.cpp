@@ -0,0 +1,170 @@
+#include <algorithm>
+#include <cassert>
+
+#include <tl/expected.hpp>
+
+#include <string_pool.hpp>
+#include <tokenizer.hpp>
+
+namespace lcl
+{
+    [[nodiscard]] static auto hex_digit_value(const char it) noexcept -> int
+    {
+        if (it >= '0' && it <= '9') return it - '0';
+        if (it >= 'a' && it <= 'f') return it - 'a' + 10;
+        if (it >= 'A' && it <= 'F') return it - 'A' + 10;
+
+        return -1;
+    }
+
+    //When errors are collected the tokenizer also makes literals that are not closed, they end before the newline or the end of the code.
+    //A literal is closed when it ends with a quote that is not escaped, Eg: `"a\"` is not closed.
+    [[nodiscard]] static auto is_string_literal_closed(const std::string_view& code) noexcept -> bool
+    {
+        if (code.size() < 2 || code.back() != '"')
+        {
+            return false;
+        }
+
+        const auto last_non_backslash = code.find_last_not_of('\\', code.size() - 2);
+        const auto backslash_count    = code.size() - 2 - last_non_backslash;
+
+        return backslash_count % 2 == 0;
+    }
+
+    string_pool::string_pool(const std::size_t reserved_bytes)
+    {
+        const auto page_size = lcl::memory::get_page_size();
+
+        m_arena = std::make_unique<lcl::memory::contiguous_virtual_memory_arena>(std::max<std::size_t>(reserved_bytes / page_size, 1));
+    }
+
+    [[nodiscard]] auto string_pool::allocate(const std::size_t size) -> char*
+    {
+        return reinterpret_cast<char*>(m_arena->allocate(size, 1));
+    }
+
+    auto string_pool::shrink_last_allocation(const std::size_t allocated_size, const std::size_t used_size) noexcept -> void
+    {
+        assert(used_size <= allocated_size && allocated_size - used_size <= m_arena->used_bytes());
+
+        m_arena->rollback(lcl::memory::arena_mark { m_arena->used_bytes() - (allocated_size - used_size) });
+    }
+
+    [[nodiscard]] auto string_pool::decode_string_literal(const lcl::token& string_literal) -> tl::expected<std::string_view, lcl::tokenizer_error>
+    {
+        assert(string_literal.type == lcl::token_type::string_literal && !string_literal.code.empty());
+
+        if (!is_string_literal_closed(string_literal.code))
+        {
+            return tl::unexpected(lcl::tokenizer_error { lcl::tokenizer_error_type::string_literal_not_closed_properly, std::cbegin(string_literal.code) });
+        }
+
+        //Without the quotes
+        const auto literal_code = string_literal.code.substr(1, string_literal.code.size() - 2);
+
+        if (!string_literal.has_escapes())
+        {
+            return literal_code;
+        }
+
+        //Decoding never makes a string longer, so the size of the code is enough
+        const auto decoded_begin = allocate(literal_code.size());
+        auto       decoded_end   = decoded_begin;
+
+        for (auto i = std::size_t { 0 }; i < literal_code.size(); ++i)
+        {
+            if (literal_code[i] != '\\')
+            {
+                *decoded_end++ = literal_code[i];
+                continue;
+            }
+
+            //The tokenizer never ends a literal on an escaping backslash
+            assert(i + 1 < literal_code.size());
+
+            const auto escape_begin = std::next(std::cbegin(string_literal.code), static_cast<std::ptrdiff_t>(i + 1));
+
+            ++i;
+
+            switch (literal_code[i])
+            {
+                case 'n' : *decoded_end++ = '\n'; break;
+                case 't' : *decoded_end++ = '\t'; break;
+                case 'r' : *decoded_end++ = '\r'; break;
+                case '0' : *decoded_end++ = '\0'; break;
+                case '\\': *decoded_end++ = '\\'; break;
+                case '"' : *decoded_end++ = '"';  break;
+                case '\'': *decoded_end++ = '\''; break;
+
+                case 'x':
+                {
+                    const auto high = i + 1 < literal_code.size() ? hex_digit_value(literal_code[i + 1]) : -1;
+                    const auto low  = i + 2 < literal_code.size() ? hex_digit_value(literal_code[i + 2]) : -1;
+
+                    if (high < 0 || low < 0)
+                    {
+                        shrink_last_allocation(literal_code.size(), 0);
+                        return tl::unexpected(lcl::tokenizer_error { lcl::tokenizer_error_type::hex_escape_sequence_not_valid, escape_begin });
+                    }
+
+                    *decoded_end++ = static_cast<char>(high * 16 + low);
+                    i += 2;
+                    break;
+                }
+
+                default:
+                {
+                    shrink_last_allocation(literal_code.size(), 0);
+                    return tl::unexpected(lcl::tokenizer_error { lcl::tokenizer_error_type::unknown_escape_sequence, escape_begin });
+                }
+            }
+        }
+
+        const auto decoded_size = static_cast<std::size_t>(decoded_end - decoded_begin);
+
+        shrink_last_allocation(literal_code.size(), decoded_size);
+
+        return std::string_view { decoded_begin, decoded_size };
+    }
+
+    [[nodiscard]] auto string_pool::intern(const std::string_view& text) -> std::string_view
+    {
+        if (const auto interned = m_interned_strings.find(text); interned != m_interned_strings.end())
+        {
+            return interned->first;
+        }
+
+        const auto copy_begin = allocate(text.size());
+        std::copy(std::cbegin(text), std::cend(text), copy_begin);
+
+        const auto copy = std::string_view { copy_begin, text.size() };
+
+        m_interned_strings.try_emplace(copy, static_cast<std::uint32_t>(m_interned_strings.size()));
+
+        return copy;
+    }
+
+    [[nodiscard]] auto string_pool::interned_index(const std::string_view& text) const -> std::optional<std::uint32_t>
+    {
+        if (const auto interned = m_interned_strings.find(text); interned != m_interned_strings.end())
+        {
+            return interned->second;
+        }
+
+        return std::nullopt;
+    }
+
+    [[nodiscard]] auto string_pool::intern_tokens(const gsl::span<const lcl::token> tokens) -> std::vector<lcl::token>
+    {
+        auto interned_tokens = std::vector<lcl::token>{};
+        interned_tokens.reserve(static_cast<std::size_t>(tokens.size()));
+
+        for (const auto& token : tokens)
+        {
+            interned_tokens.emplace_back(token.type, intern(token.code), token.flags, token.line);
+        }
+
+        return interned_tokens;
+    }
+}
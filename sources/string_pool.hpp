@@ -0,0 +1,94 @@
+#ifndef LCLCOMPILER_STRING_POOL_HPP
+#define LCLCOMPILER_STRING_POOL_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string_view>
+#include <vector>
+
+#include <gsl/span>
+#include <tl/expected.hpp>
+
+#include <flat_hash_map.hpp>
+#include <memory.hpp>
+#include <tokenizer.hpp>
+
+namespace lcl
+{
+    //Holds the decoded values of string literals and the interned strings. They are bump allocated from an arena of their own
+    //that is only freed with the pool or by `reset`, so every view handed out stays valid until then.
+    class string_pool
+    {
+        public:
+        //Only reserved, the pages are committed as the strings are added
+        static constexpr std::size_t default_reserved_bytes = std::size_t { 1 } << 30;
+
+        private:
+        //Behind a pointer so the views stay valid when the pool is moved
+        std::unique_ptr<lcl::memory::contiguous_virtual_memory_arena> m_arena;
+
+        //Every interned string, with the index it was interned at, see `interned_index`
+        lcl::flat_hash_map<std::string_view, std::uint32_t> m_interned_strings;
+
+        [[nodiscard]] auto allocate(const std::size_t size) -> char*;
+
+        //Gives back the end of the last allocation, which was `allocated_size` bytes of which only `used_size` were needed.
+        auto shrink_last_allocation(const std::size_t allocated_size, const std::size_t used_size) noexcept -> void;
+
+        public:
+        //Throws `std::bad_alloc` once the strings take more than `reserved_bytes`
+        explicit string_pool(const std::size_t reserved_bytes = default_reserved_bytes);
+
+        string_pool(string_pool&&) noexcept = default;
+        string_pool& operator=(string_pool&&) noexcept = default;
+
+        string_pool(const string_pool&) = delete;
+        string_pool& operator=(const string_pool&) = delete;
+
+        //Returns the value of a `string_literal` token, without the quotes and with the escape sequences decoded.
+        //A literal without escapes is returned as a view into its code and costs nothing, any other literal is decoded into the pool.
+        //Supported escapes: \n \t \r \0 \\ \" \' and \xHH
+        //A literal that is not closed, which the tokenizer only makes when collecting errors, is a `string_literal_not_closed_properly` error.
+        [[nodiscard]] auto decode_string_literal(const lcl::token& string_literal) -> tl::expected<std::string_view, lcl::tokenizer_error>;
+
+        //Returns a copy of `text` that lives in the pool, equal texts share a single copy.
+        [[nodiscard]] auto intern(const std::string_view& text) -> std::string_view;
+
+        //The number of strings interned before `text`, nothing if it was never interned.
+        //The indices are dense, so tables keyed by interned strings can be arrays.
+        [[nodiscard]] auto interned_index(const std::string_view& text) const -> std::optional<std::uint32_t>;
+
+        //Returns the tokens with their code interned, so they stay valid once the source buffer they came from is freed.
+        //The views returned by `decode_string_literal` for literals without escapes still point into the source.
+        [[nodiscard]] auto intern_tokens(const gsl::span<const lcl::token> tokens) -> std::vector<lcl::token>;
+
+        [[nodiscard]] auto interned_count() const noexcept -> std::size_t
+        {
+            return m_interned_strings.size();
+        }
+
+        //Bytes taken by decoded and interned strings
+        [[nodiscard]] auto used_bytes() const noexcept -> std::size_t
+        {
+            return m_arena->used_bytes();
+        }
+
+        //The arena the strings are in, Eg: for its telemetry or its reset policy
+        [[nodiscard]] auto arena() const noexcept -> lcl::memory::contiguous_virtual_memory_arena&
+        {
+            return *m_arena;
+        }
+
+        //Frees every string at once and forgets the interned ones, the arena gives memory back as its reset policy says.
+        //Every view handed out before is invalid afterwards.
+        auto reset() -> void
+        {
+            m_interned_strings.clear();
+            m_arena->reset();
+        }
+    };
+}
+
+#endif //LCLCOMPILER_STRING_POOL_HPP
@@ -0,0 +1,144 @@
+#ifndef LCLCOMPILER_TOKEN_QUEUE_HPP
+#define LCLCOMPILER_TOKEN_QUEUE_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <optional>
+#include <thread>
+#include <vector>
+
+#include <source_buffer.hpp>
+#include <spsc_queue.hpp>
+#include <tokenizer.hpp>
+
+namespace lcl
+{
+    //Carries tokens from the thread that tokenizes to the thread that parses.
+    //The tokenizer pushes the tokens in batches and finishes the queue once, with the error it stopped on if any.
+    class token_queue
+    {
+        public:
+        static constexpr std::size_t default_capacity = 1 << 14;
+
+        private:
+        lcl::spsc_queue<lcl::token>         m_tokens;
+        std::optional<lcl::tokenizer_error> m_error;
+        std::atomic<bool>                   m_finished  { false };
+        std::atomic<bool>                   m_cancelled { false };
+
+        public:
+        explicit token_queue(const std::size_t capacity = default_capacity) : m_tokens(capacity)
+        {
+            //Empty
+        }
+
+        //Producer only. Waits while the queue is full, drops the tokens if the consumer cancelled.
+        auto push_tokens(const std::vector<lcl::token>& batch) -> void
+        {
+            auto first_not_pushed = std::cbegin(batch);
+
+            while ((first_not_pushed = m_tokens.try_push(first_not_pushed, std::cend(batch))) != std::cend(batch))
+            {
+                if (m_cancelled.load(std::memory_order_relaxed))
+                {
+                    return;
+                }
+
+                std::this_thread::yield();
+            }
+        }
+
+        //Producer only. Called once, after the last batch was pushed.
+        auto finish(const std::optional<lcl::tokenizer_error>& error) -> void
+        {
+            if (error)
+            {
+                m_error.emplace(*error);
+            }
+
+            m_finished.store(true, std::memory_order_release);
+        }
+
+        //Consumer only. Appends up to `max_count` tokens to `out`, waits while the queue is empty.
+        //Returns false once the tokenizer finished and every token was popped.
+        auto pop_tokens(std::vector<lcl::token>& out, const std::size_t max_count) -> bool
+        {
+            const auto append_token = [&] (lcl::token&& it)
+            {
+                out.push_back(std::move(it));
+            };
+
+            while (true)
+            {
+                if (m_tokens.try_pop(append_token, max_count) != 0)
+                {
+                    return true;
+                }
+
+                if (m_finished.load(std::memory_order_acquire))
+                {
+                    //The last batch may have been pushed between the pop above and finishing.
+                    return m_tokens.try_pop(append_token, max_count) != 0;
+                }
+
+                std::this_thread::yield();
+            }
+        }
+
+        //Consumer only. Lets the producer stop waiting for space when the consumer is not going to pop anymore.
+        auto cancel() noexcept -> void
+        {
+            m_cancelled.store(true, std::memory_order_relaxed);
+        }
+
+        //Producer only. The consumer is not going to pop anymore, the rest of the code doesn't need to be tokenized.
+        [[nodiscard]] auto is_cancelled() const noexcept -> bool
+        {
+            return m_cancelled.load(std::memory_order_relaxed);
+        }
+
+        //Consumer only. Only meaningful once `pop_tokens` returned false. Tokens before the error were still pushed.
+        [[nodiscard]] auto error() const noexcept -> const std::optional<lcl::tokenizer_error>&
+        {
+            return m_error;
+        }
+    };
+
+    //Tokenizes `code` and pushes the tokens into `queue`, meant to be run on its own thread.
+    auto tokenize_code_into_queue(const lcl::source_buffer& code, lcl::token_queue& queue) -> void;
+
+    //Tokenizes on a thread of its own while the caller pops the tokens, so tokenizing and parsing a large file overlap on two cores.
+    //The buffer must outlive the tokenizer and the tokens.
+    class pipelined_tokenizer
+    {
+        lcl::token_queue m_queue;
+        std::thread      m_thread;
+
+        public:
+        explicit pipelined_tokenizer(const lcl::source_buffer& code, const std::size_t queue_capacity = lcl::token_queue::default_capacity) : m_queue(queue_capacity)
+        {
+            m_thread = std::thread { [&code, this] { lcl::tokenize_code_into_queue(code, m_queue); } };
+        }
+
+        pipelined_tokenizer(const pipelined_tokenizer&) = delete;
+        pipelined_tokenizer& operator=(const pipelined_tokenizer&) = delete;
+
+        auto pop_tokens(std::vector<lcl::token>& out, const std::size_t max_count) -> bool
+        {
+            return m_queue.pop_tokens(out, max_count);
+        }
+
+        [[nodiscard]] auto error() const noexcept -> const std::optional<lcl::tokenizer_error>&
+        {
+            return m_queue.error();
+        }
+
+        ~pipelined_tokenizer()
+        {
+            m_queue.cancel();
+            m_thread.join();
+        }
+    };
+}
+
+#endif //LCLCOMPILER_TOKEN_QUEUE_HPP
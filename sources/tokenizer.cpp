@@ -1,357 +1,1639 @@
 #include <cctype>
+#include <array>
+#include <atomic>
 #include <algorithm>
+#include <exception>
+#include <mutex>
+#include <new>
 #include <optional>
 #include <cassert>
+#include <cstring>
 #include <functional>
 #include <cassert>
 
 #include <tl/expected.hpp>
+#include <utf8proc.h>
 
+#include <batch_tokenizer.hpp>
+#include <import_prescan.hpp>
+#include <simd.hpp>
 #include <std_utils.hpp>
+#include <source_buffer.hpp>
+#include <token_queue.hpp>
 #include <tokenizer.hpp>
 #include <chars.hpp>
 
 namespace lcl
 {
-    [[nodiscard]] auto tokenize_code(const std::string_view& code) -> tl::expected<std::vector<lcl::token>, lcl::tokenizer_error>
+    enum class directive_type
     {
-        const auto code_begin = std::cbegin(code);
-        const auto code_end   = std::cend(code);
+        none,           // Not a directive, the `#` is a regular token
+        if_defined,     // #if NAME
+        if_not_defined, // #if not NAME
+        else_branch,    // #else
+        end,            // #end
+    };
 
-        auto tokens        = std::vector<lcl::token>{};
-        auto code_iterator = code_begin;
+    struct directive
+    {
+        lcl::directive_type              type;
+        std::string_view                 symbol;                              //Only for the `#if` directives, empty when missing
+        std::string_view::const_iterator end;                                 //After the last word of the directive
+        bool                             has_unexpected_characters_after_it;  //Anything but white space or a single line comment until the end of the line
+    };
 
-        const auto add_one_char_token = [&] (const lcl::token_type tk_type) 
-        { 
-            tokens.emplace_back(tk_type, string_view_slice(code_iterator, std::next(code_iterator))); 
-            code_iterator = std::next(code_iterator);
-        };
+    struct conditional_block
+    {
+        std::string_view::const_iterator if_directive;
+        bool                             is_branch_taken;
+        bool                             else_encountered;
+    };
+
+    [[nodiscard]] static auto read_directive_word(std::string_view::const_iterator it) noexcept -> std::string_view
+    {
+        const auto word_begin = it;
 
-        while (code_iterator != code_end)
+        while (lcl::is_valid_mid_character_in_word(*it))
         {
-            switch (*code_iterator)
+            it = std::next(it);
+        }
+
+        return string_view_slice(word_begin, it);
+    }
+
+    [[nodiscard]] static auto skip_spaces_and_tabs(std::string_view::const_iterator it) noexcept -> std::string_view::const_iterator
+    {
+        while (*it == ' ' || *it == '\t' || *it == '\r')
+        {
+            it = std::next(it);
+        }
+
+        return it;
+    }
+
+    //Reads the directive that starts with the `#` at `hashtag`. The characters after the code must be readable, like in a `source_buffer`.
+    [[nodiscard]] static auto read_directive(const std::string_view::const_iterator hashtag, const std::string_view::const_iterator code_end) noexcept -> lcl::directive
+    {
+        const auto name = read_directive_word(std::next(hashtag));
+
+        auto result = lcl::directive { lcl::directive_type::none, std::string_view{}, std::next(hashtag, 1 + lcl::ssize(name)), false };
+
+        if (name == "if")
+        {
+            result.type = lcl::directive_type::if_defined;
+
+            auto symbol_begin = skip_spaces_and_tabs(result.end);
+            auto symbol       = read_directive_word(symbol_begin);
+
+            if (symbol == "not")
             {
-                //One character tokens
-                case '`':
-                case '~':
-                case '!':
-                case '@':
-                case '#':
-                case '%':
-                case '^':
-                case '&':
-                case '*':
-                case '(':
-                case ')':
-                case '-':
-                case '+':
-                case '=':
-                case ':':
-                case '<':
-                case '>':
-                case ',':
-                case '.':
-                case '[':
-                case ']':
-                case '{':
-                case '}':
-                case '|':
-                case ';':
-                //case '/': We dont handle / here because it is used to produce comments
-                case '\\':
-                {
-                    tokens.emplace_back(lcl::get_token_type_that_represents_char(*code_iterator), string_view_slice(code_iterator, std::next(code_iterator))); 
-                    code_iterator = std::next(code_iterator);
-                    
-                    continue;
-                }
+                result.type  = lcl::directive_type::if_not_defined;
+                symbol_begin = skip_spaces_and_tabs(std::next(symbol_begin, lcl::ssize(symbol)));
+                symbol       = read_directive_word(symbol_begin);
+            }
 
-                case '\t':
-                case '\r':
-                case '\n':
-                case ' ' :
+            result.symbol = symbol;
+            result.end    = std::next(symbol_begin, lcl::ssize(symbol));
+        }
+        else if (name == "else")
+        {
+            result.type = lcl::directive_type::else_branch;
+        }
+        else if (name == "end")
+        {
+            result.type = lcl::directive_type::end;
+        }
+        else
+        {
+            return result;
+        }
+
+        const auto rest_of_line = skip_spaces_and_tabs(result.end);
+        
+        result.has_unexpected_characters_after_it = *rest_of_line != '\n' && rest_of_line != code_end && !(*rest_of_line == '/' && *std::next(rest_of_line) == '/');
+
+        return result;
+    }
+
+    //Returns the first newline, `/`, `"` or null character at or after `it`. 
+    //Looks at 16 characters at a time, which can read past the sentinel into the padding of the `source_buffer` but never past the padding.
+    [[nodiscard]] static auto find_next_char_that_matters_in_disabled_region(const char* it) noexcept -> const char*
+    {
+        #if LCL_SSE2
+            const auto newlines = _mm_set1_epi8('\n');
+            const auto slashes  = _mm_set1_epi8('/');
+            const auto quotes   = _mm_set1_epi8('"');
+            const auto nulls    = _mm_setzero_si128();
+
+            while (true)
+            {
+                const auto chars   = _mm_loadu_si128(reinterpret_cast<const __m128i*>(it));
+                const auto matches = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(chars, newlines), _mm_cmpeq_epi8(chars, slashes)), 
+                                                  _mm_or_si128(_mm_cmpeq_epi8(chars, quotes),   _mm_cmpeq_epi8(chars, nulls)));
+                const auto mask    = static_cast<std::uint32_t>(_mm_movemask_epi8(matches));
+
+                if (mask != 0)
                 {
-                    code_iterator = std::find_if_not(code_iterator, code_end, chars::is_white_space);
-                    
-                    continue;
+                    return it + lcl::simd::count_trailing_zeros(mask);
                 }
 
-                case '/':
-                {
-                    const auto iterator_to_initial_forward_slash    = code_iterator;
-                    const auto iterator_after_initial_forward_slash = std::next(iterator_to_initial_forward_slash);
-                    const auto should_tokenize_comment              = iterator_after_initial_forward_slash != code_end && (*iterator_after_initial_forward_slash == '/' || *iterator_after_initial_forward_slash == '*');
+                it += 16;
+            }
+        #else
+            while (*it != '\n' && *it != '/' && *it != '"' && *it != '\0')
+            {
+                ++it;
+            }
 
-                    if (!should_tokenize_comment)
-                    {
-                        tokens.emplace_back(lcl::token_type::forward_slash, string_view_slice(iterator_to_initial_forward_slash, 1));
-                        code_iterator = std::next(code_iterator);
+            return it;
+        #endif
+    }
 
-                        continue;
-                    }
-                    else switch (*iterator_after_initial_forward_slash)
-                    {
-                        //Regular comment
-                        case '/':
-                        {
-                            const auto commend_begin = iterator_to_initial_forward_slash;
-                            const auto comment_end   = std::find(iterator_after_initial_forward_slash, code_end, '\n');
-                            
-                            tokens.emplace_back(lcl::token_type::comment, string_view_slice(commend_begin, comment_end));
-                            code_iterator = comment_end;
+    //Skips the multi-line comment starting at the `/*` at `it`, nested comments included.
+    //Returns an iterator past its `*/`, or `code_end` if it isn't closed. `newline_count` is increased by the newlines skipped.
+    [[nodiscard]] static auto skip_multi_line_comment(std::string_view::const_iterator it, const std::string_view::const_iterator code_end, std::uint32_t& newline_count) noexcept -> std::string_view::const_iterator
+    {
+        const auto is_code_end = [code_end] (const std::string_view::const_iterator it) noexcept
+        {
+            return *it == '\0' && it == code_end;
+        };
 
-                            continue;
-                        }
+        auto inner_comments_count = 0;
 
-                        //Multiline comment
-                        case '*':
-                        {
-                            const auto comment_begin = iterator_to_initial_forward_slash;
+        for (it = std::next(it, 2); !is_code_end(it); it = std::next(it))
+        {
+            if (*it == '\n')
+            {
+                ++newline_count;
+            }
+            else if (*it == '/' && *std::next(it) == '*')
+            {
+                ++inner_comments_count;
+                it = std::next(it);
+            }
+            else if (*it == '*' && *std::next(it) == '/')
+            {
+                it = std::next(it);
 
-                            //A multiline comment ends with `*/`.
-                            //This procedure will return an iterator to the slash at the end of the close `*/` or `code_end` in case it was not found.
-                            //This procedure also takes into account nested comments. 
-                            const auto expected_iterator_to_comment_closer_slash = [&] () -> tl::expected<std::string_view::const_iterator, lcl::tokenizer_error> 
-                            {
-                                //We ignore the initial `/*` so we start 2 chars ahead to look for the end `*/` of the comment.
-                                const auto code_to_look_at_for_comment_closer_begin  = std::next(comment_begin, 2);
-                                const auto code_to_look_at_for_comment_closer_length = std::distance(code_to_look_at_for_comment_closer_begin, code_end);  
-                                
-                                //We use this to count inner comment blocks. Eg: /* /* inner */ */
-                                auto inner_comments_count = 0;
-                                
-                                //We look at 2 chars at a time, advance by one char. Eg: for "Test" we will look at the views: [ "Te", "es", "st" ]
-                                for (auto i = 0; i < code_to_look_at_for_comment_closer_length - 1; ++i)
-                                {
-                                    const auto view = string_view_slice(std::next(code_to_look_at_for_comment_closer_begin, i), 2);
+                if (inner_comments_count == 0)
+                {
+                    break;
+                }
 
-                                    if (view == "/*")
-                                    {
-                                        ++inner_comments_count;
-                                        
-                                        //We need to advance by 2 chars here because we dont want the `*` to be reused, 
-                                        //that would make cases like `/*/` valid and we don't want that.
-                                        ++i;
-                                        
-                                        continue;
-                                    }
+                --inner_comments_count;
+            }
+        }
 
-                                    if (view == "*/")
-                                    {
-                                        if (inner_comments_count == 0)
-                                        {
-                                            return std::next(std::cbegin(view));
-                                        }
+        return is_code_end(it) ? it : std::next(it);
+    }
 
-                                        --inner_comments_count;
+    //Skips the code of a conditional branch that is not taken, without tokenizing it.
+    //Returns an iterator to the `#` of the `#else` or `#end` that ends the branch, or `code_end` if there is none.
+    //Only directives at the start of a line count, and never inside a string or a comment. `newline_count` is increased by the newlines skipped.
+    [[nodiscard]] static auto skip_disabled_region(std::string_view::const_iterator it, const std::string_view::const_iterator code_end, std::uint32_t& newline_count) noexcept -> std::string_view::const_iterator
+    {
+        const auto is_code_end = [code_end] (const std::string_view::const_iterator it) noexcept
+        {
+            return *it == '\0' && it == code_end;
+        };
 
-                                        //We need to advance by 2 chars here because we dont want the `*` to be reused, 
-                                        //that would make cases like `/*/` valid and we don't want that.
-                                        ++i;
-                                    }
-                                }
+        //Counts the `#if` blocks nested inside the skipped branch
+        auto nested_if_count = 0;
 
-                                return tl::unexpected(lcl::tokenizer_error { lcl::tokenizer_error_type::multi_line_comment_not_closed, comment_begin }); 
-                            }();
+        while (true)
+        {
+            const auto char_that_matters = find_next_char_that_matters_in_disabled_region(&*it);
+            it = std::next(it, char_that_matters - &*it);
 
-                            if (!expected_iterator_to_comment_closer_slash)
-                            {
-                                return tl::unexpected(expected_iterator_to_comment_closer_slash.error());
-                            }
+            switch (*it)
+            {
+                case '\0':
+                {
+                    if (it == code_end)
+                    {
+                        return code_end;
+                    }
 
-                            const auto comment_end = std::next(*expected_iterator_to_comment_closer_slash);
+                    it = std::next(it);
+                    continue;
+                }
 
-                            tokens.emplace_back(lcl::token_type::comment, string_view_slice(comment_begin, comment_end));
-                            code_iterator = comment_end;
+                //A string ends on the line it starts on, we leave the newline to be counted
+                case '"':
+                {
+                    for (it = std::next(it); *it != '"' && *it != '\n' && !is_code_end(it); it = std::next(it))
+                    {
+                        if (*it == '\\' && *std::next(it) != '\n' && std::next(it) != code_end)
+                        {
+                            it = std::next(it);
+                        }
+                    }
 
-                            continue;
+                    if (*it == '"')
+                    {
+                        it = std::next(it);
+                    }
+
+                    continue;
+                }
+
+                case '/':
+                {
+                    const auto next_char = *std::next(it);
+
+                    if (next_char == '/')
+                    {
+                        while (*it != '\n' && !is_code_end(it))
+                        {
+                            it = std::next(it);
                         }
                     }
+                    else if (next_char == '*')
+                    {
+                        it = skip_multi_line_comment(it, code_end, newline_count);
+                    }
+                    else
+                    {
+                        it = std::next(it);
+                    }
+
+                    continue;
                 }
 
-                case '"':
+                case '\n':
                 {
-                    const auto string_begin = code_iterator;
-                    
-                    //This proc will return an iterator to the closing `"` or code_end if the string isn't closed properly.
-                    //We start looking after the first `"`.
-                    const auto expected_iterator_to_string_closer = [&] () -> tl::expected<std::string_view::const_iterator, lcl::tokenizer_error> 
+                    ++newline_count;
+
+                    it = skip_spaces_and_tabs(std::next(it));
+
+                    //Multi-line comments can come before a directive on its line, the same as in the code that is tokenized
+                    while (*it == '/' && *std::next(it) == '*')
                     {
-                        //Used to mark if the next character should be escaped, such as `\"`
-                        auto escape_next_character = false;
+                        it = skip_spaces_and_tabs(skip_multi_line_comment(it, code_end, newline_count));
+                    }
 
-                        for (auto it = std::next(string_begin); it < code_end; it = std::next(it))
+                    if (*it != '#')
+                    {
+                        continue;
+                    }
+
+                    switch (read_directive(it, code_end).type)
+                    {
+                        case lcl::directive_type::if_defined:
+                        case lcl::directive_type::if_not_defined:
                         {
-                            const auto char_at_it = *it;
+                            ++nested_if_count;
+                            break;
+                        }
 
-                            if (chars::is_newline(char_at_it))
+                        case lcl::directive_type::else_branch:
+                        {
+                            if (nested_if_count == 0)
                             {
-                                return tl::unexpected(lcl::tokenizer_error { lcl::tokenizer_error_type::newline_in_string_literal, string_begin });
+                                return it;
                             }
 
-                            if (char_at_it  == 0)
-                            {
-                                return tl::unexpected(lcl::tokenizer_error { lcl::tokenizer_error_type::null_character_in_string_literal, string_begin });
-                            }
+                            break;
+                        }
 
-                            switch (char_at_it )
+                        case lcl::directive_type::end:
+                        {
+                            if (nested_if_count == 0)
                             {
-                                case '\\': 
-                                {
-                                    escape_next_character = true; 
-                                    continue;
-                                }
+                                return it;
+                            }
 
-                                case '"' : 
-                                {
-                                    if (escape_next_character) 
-                                    { 
-                                        escape_next_character = false;
-                                        continue; 
-                                    } 
-                                    else 
-                                    { 
-                                        return it;
-                                    }
-                                }
+                            --nested_if_count;
+                            break;
+                        }
 
-                                default: 
-                                {
-                                    escape_next_character = false; 
-                                    continue;
-                                }
-                            }
+                        case lcl::directive_type::none:
+                        {
+                            break;
                         }
+                    }
 
-                        return tl::unexpected(lcl::tokenizer_error { lcl::tokenizer_error_type::string_literal_not_closed_properly, string_begin });
-                    }();
+                    it = std::next(it);
+                    continue;
+                }
+            }
+        }
+    }
 
-                    if (!expected_iterator_to_string_closer)
-                    {
-                        return tl::unexpected(expected_iterator_to_string_closer.error());
-                    }
+    //A sink that has `wants_more_tokens()` can stop the tokenizer before the end of the code
+    template <class TokenSink, class = void> 
+    struct can_stop_early : std::false_type {};
 
-                    const auto string_end = std::next(*expected_iterator_to_string_closer);
+    template <class TokenSink> 
+    struct can_stop_early<TokenSink, std::void_t<decltype(std::declval<const TokenSink&>().wants_more_tokens())>> : std::true_type {};
 
-                    tokens.emplace_back(lcl::token_type::string_literal, string_view_slice(string_begin, string_end));
-                    code_iterator = string_end;
+    //`padded_code` must hold the characters of `code` followed by a null sentinel and the padding of a `source_buffer`.
+    //The loops below stop on the sentinel instead of comparing against `code_end`, only a null character needs the extra check
+    //to tell the sentinel apart from a null character inside the code.
+    //The produced tokens and errors refer to `code`, which lets callers tokenize a copy while keeping views into their own code.
+    //The tokens are handed to `tokens` through `emplace_back`, so they can be stored or sent elsewhere as they are produced.
+    //When `brackets` is not null the brackets are paired as they are tokenized.
+    //When `tokens` stops wanting tokens, see `can_stop_early`, tokenizing stops without looking at the rest of the code.
+    //`#if NAME`, `#if not NAME`, `#else` and `#end` at the start of a line are evaluated against `defined_symbols`,
+    //the branches that are not taken are skipped without being tokenized and the directives produce no tokens.
+    //`Policy` picks the features at compile time, see `tokenizer_policy`. With `Policy::collect_errors` the errors are pushed into `errors`
+    //and tokenizing carries on after each one, otherwise `errors` is unused and the first error is returned.
+    template <class Policy, class TokenSink>
+    [[nodiscard]] static auto tokenize_padded_code(const std::string_view& padded_code, const std::string_view& code, TokenSink& tokens, const std::vector<std::string_view>& defined_symbols, lcl::bracket_pairs* const brackets = nullptr, std::vector<lcl::tokenizer_error>* const errors = nullptr) -> tl::expected<void, lcl::tokenizer_error>
+    {
+        assert(padded_code.size() >= code.size() + 1 + lcl::source_buffer::padding_size && padded_code[code.size()] == '\0');
 
-                    continue;
-                }
+        const auto code_begin = std::cbegin(padded_code);
+        const auto code_end   = std::next(code_begin, lcl::ssize(code));
 
-                default: 
-                {
-                    if (chars::is_ascii_digit(*code_iterator))
+        const auto is_code_end = [code_end] (const std::string_view::const_iterator it) noexcept
+        {
+            return *it == '\0' && it == code_end;
+        };
+
+        const auto view_into_code = [&] (const std::string_view& view_into_padded_code) noexcept
+        {
+            return std::string_view { code.data() + (view_into_padded_code.data() - padded_code.data()), view_into_padded_code.size() };
+        };
+
+        auto code_iterator = code_begin;
+        auto token_count   = std::uint32_t { 0 };
+        auto line          = std::uint32_t { 1 };
+
+        const auto count_lines = [&] (const std::string_view::const_iterator begin, const std::string_view::const_iterator end)
+        {
+            if constexpr (Policy::track_line_numbers)
+            {
+                line += static_cast<std::uint32_t>(std::count(begin, end, '\n'));
+            }
+        };
+
+        //Decodes the code point starting at `it` and returns it with its length in bytes.
+        //Invalid UTF-8 is returned as a single byte code point that is neither a letter nor a digit.
+        const auto decode_code_point = [&] (const std::string_view::const_iterator it) noexcept -> std::pair<char32_t, std::ptrdiff_t>
+        {
+            auto       code_point = utf8proc_int32_t { 0 };
+            const auto length     = utf8proc_iterate(reinterpret_cast<const utf8proc_uint8_t*>(&*it), std::distance(it, code_end), &code_point);
+
+            if (length <= 0)
+            {
+                return { U'\uFFFD', 1 };
+            }
+
+            return { static_cast<char32_t>(code_point), length };
+        };
+
+        //Set when a newline was skipped since the last token, the first token in the code also counts as being on a new line.
+        auto next_token_is_preceded_by_newline = true;
+
+        //Set when only white space and comments came since the last newline, which is where directives are read.
+        //Kept apart from the flag above because comments are only tokens under some policies, and every policy must read the same directives.
+        auto only_comments_since_newline = true;
+
+        //Where the last token ends, a token that starts there is joined to it
+        auto previous_token_end = static_cast<const char*>(nullptr);
+
+        const auto add_token = [&] (const lcl::token_type tk_type, const std::string_view& tk_code, lcl::token_flags tk_flags = lcl::token_flags::none) 
+        { 
+            if (next_token_is_preceded_by_newline)
+            {
+                tk_flags |= lcl::token_flags::preceded_by_newline;
+                next_token_is_preceded_by_newline = false;
+            }
+
+            if (tk_code.data() == previous_token_end)
+            {
+                tk_flags |= lcl::token_flags::joined_to_previous;
+            }
+
+            previous_token_end = tk_code.data() + tk_code.size();
+
+            if (tk_type != lcl::token_type::comment)
+            {
+                only_comments_since_newline = false;
+            }
+
+            tokens.emplace_back(tk_type, view_into_code(tk_code), tk_flags, Policy::track_line_numbers ? line : 0); 
+            ++token_count;
+        };
+
+        const auto is_unicode_word_start = [&] (const std::string_view::const_iterator it) noexcept
+        {
+            return static_cast<unsigned char>(*it) >= 0x80 && chars::is_unicode_letter(decode_code_point(it).first);
+        };
+
+        //Token index and type of the brackets that are still open and the (opener, closer) pairs found so far.
+        auto open_brackets = std::vector<std::pair<std::uint32_t, lcl::token_type>>{};
+        auto bracket_pairs = std::vector<std::pair<std::uint32_t, std::uint32_t>>{};
+
+        //How many of the open brackets each closing bracket could match, so a closer without any opener is not searched for.
+        //Without it `((((...]]]]` would look through every open bracket for every closer.
+        auto open_bracket_counts = std::array<std::uint32_t, 3> { 0, 0, 0 };
+
+        const auto open_bracket_count_of = [&] (const lcl::token_type closing_bracket) noexcept -> std::uint32_t&
+        {
+            switch (closing_bracket)
+            {
+                case lcl::token_type::close_parans:          return open_bracket_counts[0];
+                case lcl::token_type::close_square_breacket: return open_bracket_counts[1];
+                default:                                     return open_bracket_counts[2];
+            }
+        };
+
+        const auto pair_bracket = [&] (const lcl::token_type tk_type)
+        {
+            const auto token_index = token_count - 1;
+
+            if (lcl::is_opening_bracket(tk_type))
+            {
+                open_brackets.emplace_back(token_index, tk_type);
+                ++open_bracket_count_of(lcl::get_closing_bracket_of(tk_type));
+                return;
+            }
+
+            if (open_bracket_count_of(tk_type) == 0)
+            {
+                brackets->unmatched_brackets.push_back(token_index);
+                return;
+            }
+
+            //Find the innermost open bracket this closer can match. Brackets opened inside it that are still open were never closed.
+            //Eg: `( [ )` -> `[` is unmatched and `(` matches `)`
+            const auto matching_opener = std::find_if(std::crbegin(open_brackets), std::crend(open_brackets), [&] (const auto& opener) 
+            { 
+                return lcl::get_closing_bracket_of(opener.second) == tk_type; 
+            });
+
+            if (matching_opener == std::crend(open_brackets))
+            {
+                brackets->unmatched_brackets.push_back(token_index);
+                return;
+            }
+
+            const auto matching_opener_position = std::prev(matching_opener.base());
+
+            //Every open bracket looked at is removed, so the searches take linear time in total
+            for (auto it = matching_opener_position; it != std::cend(open_brackets); it = std::next(it))
+            {
+                --open_bracket_count_of(lcl::get_closing_bracket_of(it->second));
+
+                if (it != matching_opener_position)
+                {
+                    brackets->unmatched_brackets.push_back(it->first);
+                }
+            }
+
+            bracket_pairs.emplace_back(matching_opener_position->first, token_index);
+            open_brackets.erase(matching_opener_position, std::cend(open_brackets));
+        };
+
+        auto conditional_blocks = std::vector<lcl::conditional_block>{};
+
+        while (!is_code_end(code_iterator))
+        {
+            if constexpr (can_stop_early<TokenSink>::value)
+            {
+                //Blocks that are still open may be closed in the code that is not tokenized
+                if (!tokens.wants_more_tokens())
+                {
+                    return {};
+                }
+            }
+
+            switch (*code_iterator)
+            {
+                case '#':
+                {
+                    const auto directive = only_comments_since_newline ? read_directive(code_iterator, code_end) : lcl::directive { lcl::directive_type::none, {}, code_iterator, false };
+
+                    if (directive.type == lcl::directive_type::none)
                     {
-                        /*
-                        1 - Number
-                        1.0 - Number
-                        1.0. - Number dot
-                        1.0.0 - Number dot number
-                        */
-                        
-                        const auto numeric_literal_begin = code_iterator;
-                        
-                        auto dot_encountered     = false;
-                        auto prev_was_dot        = false;
-                        auto prev_was_underscore = false;
-                        auto it                  = numeric_literal_begin;
+                        add_token(lcl::token_type::hashtag, string_view_slice(code_iterator, std::next(code_iterator)));
+                        code_iterator = std::next(code_iterator);
+
+                        continue;
+                    }
 
-                        for (; it < code_end; it = std::next(it))
+                    auto directive_error = std::optional<lcl::tokenizer_error_type>{};
+                    auto skip_branch     = false;
+
+                    switch (directive.type)
+                    {
+                        case lcl::directive_type::if_defined:
+                        case lcl::directive_type::if_not_defined:
                         {
-                            if (*it == '.')
+                            const auto is_symbol_defined = std::find(std::cbegin(defined_symbols), std::cend(defined_symbols), directive.symbol) != std::cend(defined_symbols);
+                            const auto is_branch_taken   = !directive.symbol.empty() && is_symbol_defined == (directive.type == lcl::directive_type::if_defined);
+
+                            if (directive.symbol.empty())
                             {
-                                //Here we take the numbers up to the previous dot as a numeric literal and advance the code_iterator up to the previous dot and keep tokenizing from there
-                                //Eg: 1.. -> [numeric_literal, dot, dot]
-                                if (prev_was_dot)
-                                {
-                                    prev_was_dot = false;
+                                directive_error = lcl::tokenizer_error_type::directive_condition_missing;
+                            }
 
-                                    const auto iterator_to_prev_dot = std::prev(it);
-                                    tokens.emplace_back(lcl::token_type::numeric_literal, string_view_slice(numeric_literal_begin, iterator_to_prev_dot));
-                                    code_iterator = iterator_to_prev_dot;
-                                    break;
-                                }
-                                
-                                //We end the number here and keep tokenizing from this dot
-                                //Eg: 1.0.0 -> [numeric_literal, dot, numeric_literal]
-                                if (dot_encountered) 
-                                {
-                                    tokens.emplace_back(lcl::token_type::numeric_literal, string_view_slice(numeric_literal_begin, it));
-                                    code_iterator = it;
-                                    break;
-                                }
+                            conditional_blocks.push_back(lcl::conditional_block { code_iterator, is_branch_taken, false });
+                            skip_branch = !is_branch_taken;
+                            break;
+                        }
 
-                                prev_was_dot    = true;
-                                dot_encountered = true;
-                            }
-                            else if (*it == '_')
+                        case lcl::directive_type::else_branch:
+                        {
+                            if (conditional_blocks.empty())
                             {
-                                prev_was_underscore = true;
+                                directive_error = lcl::tokenizer_error_type::directive_else_without_if;
                             }
-                            else if (chars::is_ascii_digit(*it))
+                            else if (conditional_blocks.back().else_encountered)
                             {
-                                prev_was_dot        = false;
-                                prev_was_underscore = false;
+                                //Nothing after a second `#else` is taken
+                                directive_error = lcl::tokenizer_error_type::directive_else_repeated;
+                                skip_branch     = true;
                             }
-                            else //if not valid character in number
+                            else
                             {
-                                //This dot should not be parsed as part of the number
-                                if (prev_was_dot)
-                                {
-                                    const auto iterator_prev_was_dot = std::prev(it);
-                                    tokens.emplace_back(lcl::token_type::numeric_literal, string_view_slice(numeric_literal_begin, iterator_prev_was_dot));
-                                    code_iterator = iterator_prev_was_dot;
-                                }
-                                else if (prev_was_underscore)
-                                {
-                                    return tl::unexpected(lcl::tokenizer_error { lcl::tokenizer_error_type::numeric_literal_ends_with_underscore, numeric_literal_begin });
-                                }
-                                else //if unexpected character
-                                {
-                                    if (!lcl::is_single_char_represented_by_token_type(*it) && !chars::is_white_space(*it))
-                                    {
-                                        return tl::unexpected(lcl::tokenizer_error { lcl::tokenizer_error_type::numeric_literal_contains_unexpected_character, numeric_literal_begin });
-                                    }
+                                auto& block = conditional_blocks.back();
 
-                                    tokens.emplace_back(lcl::token_type::numeric_literal, string_view_slice(numeric_literal_begin, it));
-                                    code_iterator = it;
-                                    break;
-                                }
+                                block.else_encountered = true;
+                                skip_branch            = block.is_branch_taken;
+                                block.is_branch_taken  = !block.is_branch_taken;
                             }
+
+                            break;
                         }
 
-                        //Here we take the numbers up to the previous dot as a numeric literal and advance the code_iterator up to the previous dot and keep tokenizing from there
-                        //Eg: 1.. -> [numeric_literal, dot, dot]
-                        if (prev_was_dot)
+                        case lcl::directive_type::end:
                         {
-                            const auto iterator_to_prev_dot = std::prev(it);
-                            tokens.emplace_back(lcl::token_type::numeric_literal, string_view_slice(numeric_literal_begin, iterator_to_prev_dot));
-                            code_iterator = iterator_to_prev_dot;
+                            if (conditional_blocks.empty())
+                            {
+                                directive_error = lcl::tokenizer_error_type::directive_end_without_if;
+                            }
+                            else
+                            {
+                                conditional_blocks.pop_back();
+                            }
+
+                            break;
                         }
-                        else if (prev_was_underscore)
+
+                        case lcl::directive_type::none:
                         {
-                            return tl::unexpected(lcl::tokenizer_error { lcl::tokenizer_error_type::numeric_literal_ends_with_underscore, numeric_literal_begin });
+                            break;
                         }
-                        else if (it == code_end)
+                    }
+
+                    if (!directive_error && directive.has_unexpected_characters_after_it)
+                    {
+                        directive_error = lcl::tokenizer_error_type::unexpected_characters_after_directive;
+                    }
+
+                    if (directive_error)
+                    {
+                        const auto error = lcl::tokenizer_error { *directive_error, code_iterator };
+
+                        if constexpr (!Policy::collect_errors)
                         {
-                            //If we reached the end of the code without problem
-                            tokens.emplace_back(lcl::token_type::numeric_literal, string_view_slice(numeric_literal_begin, code_end));
-                            code_iterator = code_end;
+                            return tl::unexpected(error);
                         }
+
+                        errors->push_back(error);
                     }
-                    else if (lcl::is_valid_first_character_in_word(*code_iterator))
+
+                    code_iterator = directive.end;
+
+                    if (skip_branch)
                     {
-                        const auto word_literal_begin = code_iterator;
-                        const auto word_literal_end   = std::find_if_not(word_literal_begin, code_end, lcl::is_valid_mid_character_in_word);
+                        auto skipped_newline_count = std::uint32_t { 0 };
+                        code_iterator = skip_disabled_region(code_iterator, code_end, skipped_newline_count);
 
-                        tokens.emplace_back(lcl::token_type::word, string_view_slice(word_literal_begin, word_literal_end));
-                        code_iterator = word_literal_end;
+                        if constexpr (Policy::track_line_numbers)
+                        {
+                            line += skipped_newline_count;
+                        }
+
+                        //The branch ends with a directive at the start of a line
+                        next_token_is_preceded_by_newline = true;
+                        only_comments_since_newline       = true;
                     }
+
+                    continue;
                 }
-            }
+
+                //One character tokens
+                case '`':
+                case '~':
+                case '!':
+                case '@':
+                case '%':
+                case '^':
+                case '&':
+                case '*':
+                case '(':
+                case ')':
+                case '-':
+                case '+':
+                case '=':
+                case ':':
+                case '<':
+                case '>':
+                case ',':
+                case '.':
+                case '[':
+                case ']':
+                case '{':
+                case '}':
+                case '|':
+                case ';':
+                //case '/': We dont handle / here because it is used to produce comments
+                case '\\':
+                {
+                    const auto tk_type = lcl::get_token_type_that_represents_char(*code_iterator);
+
+                    add_token(tk_type, string_view_slice(code_iterator, std::next(code_iterator))); 
+                    code_iterator = std::next(code_iterator);
+
+                    if (brackets != nullptr && (lcl::is_opening_bracket(tk_type) || lcl::is_closing_bracket(tk_type)))
+                    {
+                        pair_bracket(tk_type);
+                    }
+                    
+                    continue;
+                }
+
+                case '\t':
+                case '\r':
+                case '\n':
+                case ' ' :
+                {
+                    auto white_space_end = code_iterator;
+
+                    while (chars::is_white_space(*white_space_end))
+                    {
+                        white_space_end = std::next(white_space_end);
+                    }
+
+                    if (std::find(code_iterator, white_space_end, '\n') != white_space_end)
+                    {
+                        next_token_is_preceded_by_newline = true;
+                        only_comments_since_newline       = true;
+                        count_lines(code_iterator, white_space_end);
+                    }
+
+                    code_iterator = white_space_end;
+                    
+                    continue;
+                }
+
+                case '/':
+                {
+                    const auto iterator_to_initial_forward_slash    = code_iterator;
+                    const auto iterator_after_initial_forward_slash = std::next(iterator_to_initial_forward_slash);
+                    const auto should_tokenize_comment              = *iterator_after_initial_forward_slash == '/' || *iterator_after_initial_forward_slash == '*';
+
+                    if (!should_tokenize_comment)
+                    {
+                        add_token(lcl::token_type::forward_slash, string_view_slice(iterator_to_initial_forward_slash, 1));
+                        code_iterator = std::next(code_iterator);
+
+                        continue;
+                    }
+                    else switch (*iterator_after_initial_forward_slash)
+                    {
+                        //Regular comment
+                        case '/':
+                        {
+                            const auto commend_begin = iterator_to_initial_forward_slash;
+                            auto       comment_end   = iterator_after_initial_forward_slash;
+
+                            while (*comment_end != '\n' && !is_code_end(comment_end))
+                            {
+                                comment_end = std::next(comment_end);
+                            }
+                            
+                            if constexpr (Policy::keep_comments)
+                            {
+                                add_token(lcl::token_type::comment, string_view_slice(commend_begin, comment_end), lcl::token_flags::single_line_comment);
+                            }
+
+                            code_iterator = comment_end;
+
+                            continue;
+                        }
+
+                        //Multiline comment
+                        case '*':
+                        {
+                            const auto comment_begin = iterator_to_initial_forward_slash;
+
+                            //A multiline comment ends with `*/`.
+                            //This procedure will return an iterator to the slash at the end of the close `*/` or `code_end` in case it was not found.
+                            //This procedure also takes into account nested comments. 
+                            const auto expected_iterator_to_comment_closer_slash = [&] () -> tl::expected<std::string_view::const_iterator, lcl::tokenizer_error> 
+                            {
+                                //We use this to count inner comment blocks. Eg: /* /* inner */ */
+                                auto inner_comments_count = 0;
+                                
+                                //We ignore the initial `/*` so we start 2 chars ahead to look for the end `*/` of the comment.
+                                //We look at 2 chars at a time, advance by one char. Eg: for "Test" we will look at the views: [ "Te", "es", "st" ]
+                                //Reading the char after the last one is fine since it is the sentinel.
+                                for (auto it = std::next(comment_begin, 2); !is_code_end(it); it = std::next(it))
+                                {
+                                    const auto next_char = *std::next(it);
+
+                                    if (*it == '/' && next_char == '*')
+                                    {
+                                        ++inner_comments_count;
+                                        
+                                        //We need to advance by 2 chars here because we dont want the `*` to be reused, 
+                                        //that would make cases like `/*/` valid and we don't want that.
+                                        it = std::next(it);
+                                        
+                                        continue;
+                                    }
+
+                                    if (*it == '*' && next_char == '/')
+                                    {
+                                        if (inner_comments_count == 0)
+                                        {
+                                            return std::next(it);
+                                        }
+
+                                        --inner_comments_count;
+
+                                        //We need to advance by 2 chars here because we dont want the `*` to be reused, 
+                                        //that would make cases like `/*/` valid and we don't want that.
+                                        it = std::next(it);
+                                    }
+                                }
+
+                                return tl::unexpected(lcl::tokenizer_error { lcl::tokenizer_error_type::multi_line_comment_not_closed, comment_begin }); 
+                            }();
+
+                            if (!expected_iterator_to_comment_closer_slash)
+                            {
+                                if constexpr (!Policy::collect_errors)
+                                {
+                                    return tl::unexpected(expected_iterator_to_comment_closer_slash.error());
+                                }
+
+                                //The comment takes the rest of the code
+                                errors->push_back(expected_iterator_to_comment_closer_slash.error());
+                            }
+
+                            const auto comment_end = expected_iterator_to_comment_closer_slash ? std::next(*expected_iterator_to_comment_closer_slash) : code_end;
+
+                            if constexpr (Policy::keep_comments)
+                            {
+                                //The comment keeps the line it starts on
+                                add_token(lcl::token_type::comment, string_view_slice(comment_begin, comment_end), lcl::token_flags::multi_line_comment);
+                            }
+
+                            count_lines(comment_begin, comment_end);
+                            code_iterator = comment_end;
+
+                            continue;
+                        }
+                    }
+                }
+
+                case '"':
+                {
+                    const auto string_begin = code_iterator;
+                    
+                    auto string_has_escapes = false;
+
+                    //Set when the string is not closed on the line it starts on
+                    auto string_error = std::optional<lcl::tokenizer_error_type>{};
+
+                    //This proc will return an iterator to the closing `"`, or to the newline or code_end the string ran into if it isn't closed properly.
+                    //We start looking after the first `"`.
+                    const auto iterator_to_string_closer = [&] () -> std::string_view::const_iterator 
+                    {
+                        //Used to mark if the next character should be escaped, such as `\"`
+                        auto escape_next_character = false;
+
+                        for (auto it = std::next(string_begin); ; it = std::next(it))
+                        {
+                            const auto char_at_it = *it;
+
+                            if (chars::is_newline(char_at_it))
+                            {
+                                string_error = lcl::tokenizer_error_type::newline_in_string_literal;
+                                return it;
+                            }
+
+                            if (char_at_it  == 0)
+                            {
+                                if (it == code_end)
+                                {
+                                    string_error = lcl::tokenizer_error_type::string_literal_not_closed_properly;
+                                    return it;
+                                }
+
+                                if constexpr (!Policy::collect_errors)
+                                {
+                                    string_error = lcl::tokenizer_error_type::null_character_in_string_literal;
+                                    return it;
+                                }
+
+                                //The null character is reported and kept as part of the string
+                                errors->push_back(lcl::tokenizer_error { lcl::tokenizer_error_type::null_character_in_string_literal, string_begin });
+                                escape_next_character = false;
+                                continue;
+                            }
+
+                            switch (char_at_it )
+                            {
+                                //An escaped backslash does not escape the character after it. Eg: `"\\"`
+                                case '\\': 
+                                {
+                                    escape_next_character = !escape_next_character; 
+                                    string_has_escapes    = true;
+                                    continue;
+                                }
+
+                                case '"' : 
+                                {
+                                    if (escape_next_character) 
+                                    { 
+                                        escape_next_character = false;
+                                        continue; 
+                                    } 
+                                    else 
+                                    { 
+                                        return it;
+                                    }
+                                }
+
+                                default: 
+                                {
+                                    escape_next_character = false; 
+                                    continue;
+                                }
+                            }
+                        }
+                    }();
+
+                    if (string_error)
+                    {
+                        const auto error = lcl::tokenizer_error { *string_error, string_begin };
+
+                        if constexpr (!Policy::collect_errors)
+                        {
+                            return tl::unexpected(error);
+                        }
+
+                        errors->push_back(error);
+                    }
+
+                    //A string that is not closed ends right before the newline or the end of the code
+                    const auto string_end = string_error ? iterator_to_string_closer : std::next(iterator_to_string_closer);
+
+                    add_token(lcl::token_type::string_literal, string_view_slice(string_begin, string_end), string_has_escapes ? lcl::token_flags::has_escapes : lcl::token_flags::none);
+                    code_iterator = string_end;
+
+                    continue;
+                }
+
+                default: 
+                {
+                    if (chars::is_ascii_digit(*code_iterator))
+                    {
+                        /*
+                        1 - Number
+                        1.0 - Number
+                        1.0. - Number dot
+                        1.0.0 - Number dot number
+                        */
+                        
+                        const auto numeric_literal_begin = code_iterator;
+                        
+                        auto dot_encountered        = false;
+                        auto prev_was_dot           = false;
+                        auto underscore_encountered = false;
+                        auto prev_was_underscore    = false;
+                        auto it                     = numeric_literal_begin;
+
+                        //A literal that stops right before a dot never contains a dot, since a literal can contain at most one
+                        const auto numeric_literal_flags = [&] (const bool literal_contains_dot)
+                        {
+                            const auto underscore_flags = underscore_encountered ? lcl::token_flags::has_underscores : lcl::token_flags::none;
+                            const auto kind_flags       = literal_contains_dot   ? lcl::token_flags::float_literal   : lcl::token_flags::int_literal;
+
+                            return kind_flags | underscore_flags;
+                        };
+
+                        for (; !is_code_end(it); it = std::next(it))
+                        {
+                            if (*it == '.')
+                            {
+                                //Here we take the numbers up to the previous dot as a numeric literal and advance the code_iterator up to the previous dot and keep tokenizing from there
+                                //Eg: 1.. -> [numeric_literal, dot, dot]
+                                if (prev_was_dot)
+                                {
+                                    prev_was_dot = false;
+
+                                    const auto iterator_to_prev_dot = std::prev(it);
+                                    add_token(lcl::token_type::numeric_literal, string_view_slice(numeric_literal_begin, iterator_to_prev_dot), numeric_literal_flags(false));
+                                    code_iterator = iterator_to_prev_dot;
+                                    break;
+                                }
+                                
+                                //We end the number here and keep tokenizing from this dot
+                                //Eg: 1.0.0 -> [numeric_literal, dot, numeric_literal]
+                                if (dot_encountered) 
+                                {
+                                    add_token(lcl::token_type::numeric_literal, string_view_slice(numeric_literal_begin, it), numeric_literal_flags(true));
+                                    code_iterator = it;
+                                    break;
+                                }
+
+                                prev_was_dot    = true;
+                                dot_encountered = true;
+                            }
+                            else if (*it == '_')
+                            {
+                                prev_was_underscore    = true;
+                                underscore_encountered = true;
+                            }
+                            else if (chars::is_ascii_digit(*it))
+                            {
+                                prev_was_dot        = false;
+                                prev_was_underscore = false;
+                            }
+                            else //if not valid character in number
+                            {
+                                //This dot should not be parsed as part of the number
+                                if (prev_was_dot)
+                                {
+                                    prev_was_dot = false;
+
+                                    const auto iterator_prev_was_dot = std::prev(it);
+                                    add_token(lcl::token_type::numeric_literal, string_view_slice(numeric_literal_begin, iterator_prev_was_dot), numeric_literal_flags(false));
+                                    code_iterator = iterator_prev_was_dot;
+                                    break;
+                                }
+                                else if (prev_was_underscore)
+                                {
+                                    const auto error = lcl::tokenizer_error { lcl::tokenizer_error_type::numeric_literal_ends_with_underscore, numeric_literal_begin };
+
+                                    if constexpr (!Policy::collect_errors)
+                                    {
+                                        return tl::unexpected(error);
+                                    }
+
+                                    //The literal keeps its trailing underscores
+                                    errors->push_back(error);
+                                    prev_was_underscore = false;
+
+                                    add_token(lcl::token_type::numeric_literal, string_view_slice(numeric_literal_begin, it), numeric_literal_flags(dot_encountered));
+                                    code_iterator = it;
+                                    break;
+                                }
+                                else //if unexpected character
+                                {
+                                    if (!lcl::is_single_char_represented_by_token_type(*it) && !chars::is_white_space(*it))
+                                    {
+                                        const auto error = lcl::tokenizer_error { lcl::tokenizer_error_type::numeric_literal_contains_unexpected_character, numeric_literal_begin };
+
+                                        if constexpr (!Policy::collect_errors)
+                                        {
+                                            return tl::unexpected(error);
+                                        }
+
+                                        //The literal ends before the unexpected character, which is tokenized on its own
+                                        errors->push_back(error);
+                                    }
+
+                                    add_token(lcl::token_type::numeric_literal, string_view_slice(numeric_literal_begin, it), numeric_literal_flags(dot_encountered));
+                                    code_iterator = it;
+                                    break;
+                                }
+                            }
+                        }
+
+                        //Here we take the numbers up to the previous dot as a numeric literal and advance the code_iterator up to the previous dot and keep tokenizing from there
+                        //Eg: 1.. -> [numeric_literal, dot, dot]
+                        if (prev_was_dot)
+                        {
+                            const auto iterator_to_prev_dot = std::prev(it);
+                            add_token(lcl::token_type::numeric_literal, string_view_slice(numeric_literal_begin, iterator_to_prev_dot), numeric_literal_flags(false));
+                            code_iterator = iterator_to_prev_dot;
+                        }
+                        else if (prev_was_underscore)
+                        {
+                            const auto error = lcl::tokenizer_error { lcl::tokenizer_error_type::numeric_literal_ends_with_underscore, numeric_literal_begin };
+
+                            if constexpr (!Policy::collect_errors)
+                            {
+                                return tl::unexpected(error);
+                            }
+
+                            //The literal keeps its trailing underscores
+                            errors->push_back(error);
+
+                            add_token(lcl::token_type::numeric_literal, string_view_slice(numeric_literal_begin, it), numeric_literal_flags(dot_encountered));
+                            code_iterator = it;
+                        }
+                        else if (it == code_end)
+                        {
+                            //If we reached the end of the code without problem
+                            add_token(lcl::token_type::numeric_literal, string_view_slice(numeric_literal_begin, code_end), numeric_literal_flags(dot_encountered));
+                            code_iterator = code_end;
+                        }
+                    }
+                    else if (lcl::is_valid_first_character_in_word(*code_iterator) || (Policy::unicode_identifiers && is_unicode_word_start(code_iterator)))
+                    {
+                        const auto word_literal_begin = code_iterator;
+                        auto       word_literal_end   = word_literal_begin;
+
+                        while (true)
+                        {
+                            if (lcl::is_valid_mid_character_in_word(*word_literal_end))
+                            {
+                                word_literal_end = std::next(word_literal_end);
+                                continue;
+                            }
+
+                            if constexpr (Policy::unicode_identifiers)
+                            {
+                                if (static_cast<unsigned char>(*word_literal_end) >= 0x80)
+                                {
+                                    const auto [code_point, code_point_length] = decode_code_point(word_literal_end);
+
+                                    if (chars::is_unicode_letter(code_point) || chars::is_unicode_digit(code_point))
+                                    {
+                                        word_literal_end = std::next(word_literal_end, code_point_length);
+                                        continue;
+                                    }
+                                }
+                            }
+
+                            break;
+                        }
+
+                        const auto word_literal       = string_view_slice(word_literal_begin, word_literal_end);
+
+                        add_token(lcl::token_type::word, word_literal, lcl::is_keyword(word_literal) ? lcl::token_flags::keyword : lcl::token_flags::none);
+                        code_iterator = word_literal_end;
+                    }
+                    else //Eg: `$`, `?`, a null character or a code point that can't start a word
+                    {
+                        const auto error = lcl::tokenizer_error { lcl::tokenizer_error_type::unknown_character, code_iterator };
+
+                        if constexpr (!Policy::collect_errors)
+                        {
+                            return tl::unexpected(error);
+                        }
+
+                        //The whole code point is skipped, every iteration of the loop has to advance
+                        errors->push_back(error);
+                        code_iterator = std::next(code_iterator, decode_code_point(code_iterator).second);
+                    }
+                }
+            }
+        }
+
+        for (const auto& block : conditional_blocks)
+        {
+            const auto error = lcl::tokenizer_error { lcl::tokenizer_error_type::directive_if_not_closed, block.if_directive };
+
+            if constexpr (!Policy::collect_errors)
+            {
+                return tl::unexpected(error);
+            }
+
+            errors->push_back(error);
+        }
+
+        if (brackets != nullptr)
+        {
+            for (const auto& [opener_index, opener_type] : open_brackets)
+            {
+                brackets->unmatched_brackets.push_back(opener_index);
+            }
+
+            std::sort(std::begin(brackets->unmatched_brackets), std::end(brackets->unmatched_brackets));
+
+            brackets->matching_closers.assign(token_count, lcl::bracket_pairs::no_matching_bracket);
+
+            for (const auto& [opener_index, closer_index] : bracket_pairs)
+            {
+                brackets->matching_closers[opener_index] = closer_index;
+            }
+        }
+
+        return {};
+    }
+
+    template <class Policy>
+    [[nodiscard]] auto tokenize_code(const lcl::source_buffer& code, const std::vector<std::string_view>& defined_symbols) -> lcl::tokenizer_result<Policy>
+    {
+        auto tokens = std::vector<lcl::token>{};
+
+        if constexpr (Policy::collect_errors)
+        {
+            auto errors = std::vector<lcl::tokenizer_error>{};
+
+            //Never fails, every error ends up in `errors`
+            const auto result = tokenize_padded_code<Policy>(code.padded_code(), code.code(), tokens, defined_symbols, nullptr, &errors);
+            assert(result.has_value());
+
+            return lcl::tokenized_code_with_errors { std::move(tokens), std::move(errors) };
+        }
+        else
+        {
+            return tokenize_padded_code<Policy>(code.padded_code(), code.code(), tokens, defined_symbols).map([&] () 
+            { 
+                return std::move(tokens); 
+            });
+        }
+    }
+
+    //Every combination of the `tokenizer_policy` switches gets its own instantiation
+    template auto tokenize_code<lcl::tokenizer_policy<false, false, false, false>>(const lcl::source_buffer&, const std::vector<std::string_view>&) -> lcl::tokenizer_result<lcl::tokenizer_policy<false, false, false, false>>;
+    template auto tokenize_code<lcl::tokenizer_policy<false, false, false, true >>(const lcl::source_buffer&, const std::vector<std::string_view>&) -> lcl::tokenizer_result<lcl::tokenizer_policy<false, false, false, true >>;
+    template auto tokenize_code<lcl::tokenizer_policy<false, false, true,  false>>(const lcl::source_buffer&, const std::vector<std::string_view>&) -> lcl::tokenizer_result<lcl::tokenizer_policy<false, false, true,  false>>;
+    template auto tokenize_code<lcl::tokenizer_policy<false, false, true,  true >>(const lcl::source_buffer&, const std::vector<std::string_view>&) -> lcl::tokenizer_result<lcl::tokenizer_policy<false, false, true,  true >>;
+    template auto tokenize_code<lcl::tokenizer_policy<false, true,  false, false>>(const lcl::source_buffer&, const std::vector<std::string_view>&) -> lcl::tokenizer_result<lcl::tokenizer_policy<false, true,  false, false>>;
+    template auto tokenize_code<lcl::tokenizer_policy<false, true,  false, true >>(const lcl::source_buffer&, const std::vector<std::string_view>&) -> lcl::tokenizer_result<lcl::tokenizer_policy<false, true,  false, true >>;
+    template auto tokenize_code<lcl::tokenizer_policy<false, true,  true,  false>>(const lcl::source_buffer&, const std::vector<std::string_view>&) -> lcl::tokenizer_result<lcl::tokenizer_policy<false, true,  true,  false>>;
+    template auto tokenize_code<lcl::tokenizer_policy<false, true,  true,  true >>(const lcl::source_buffer&, const std::vector<std::string_view>&) -> lcl::tokenizer_result<lcl::tokenizer_policy<false, true,  true,  true >>;
+    template auto tokenize_code<lcl::tokenizer_policy<true,  false, false, false>>(const lcl::source_buffer&, const std::vector<std::string_view>&) -> lcl::tokenizer_result<lcl::tokenizer_policy<true,  false, false, false>>;
+    template auto tokenize_code<lcl::tokenizer_policy<true,  false, false, true >>(const lcl::source_buffer&, const std::vector<std::string_view>&) -> lcl::tokenizer_result<lcl::tokenizer_policy<true,  false, false, true >>;
+    template auto tokenize_code<lcl::tokenizer_policy<true,  false, true,  false>>(const lcl::source_buffer&, const std::vector<std::string_view>&) -> lcl::tokenizer_result<lcl::tokenizer_policy<true,  false, true,  false>>;
+    template auto tokenize_code<lcl::tokenizer_policy<true,  false, true,  true >>(const lcl::source_buffer&, const std::vector<std::string_view>&) -> lcl::tokenizer_result<lcl::tokenizer_policy<true,  false, true,  true >>;
+    template auto tokenize_code<lcl::tokenizer_policy<true,  true,  false, false>>(const lcl::source_buffer&, const std::vector<std::string_view>&) -> lcl::tokenizer_result<lcl::tokenizer_policy<true,  true,  false, false>>;
+    template auto tokenize_code<lcl::tokenizer_policy<true,  true,  false, true >>(const lcl::source_buffer&, const std::vector<std::string_view>&) -> lcl::tokenizer_result<lcl::tokenizer_policy<true,  true,  false, true >>;
+    template auto tokenize_code<lcl::tokenizer_policy<true,  true,  true,  false>>(const lcl::source_buffer&, const std::vector<std::string_view>&) -> lcl::tokenizer_result<lcl::tokenizer_policy<true,  true,  true,  false>>;
+    template auto tokenize_code<lcl::tokenizer_policy<true,  true,  true,  true >>(const lcl::source_buffer&, const std::vector<std::string_view>&) -> lcl::tokenizer_result<lcl::tokenizer_policy<true,  true,  true,  true >>;
+
+    [[nodiscard]] auto tokenize_code(const lcl::source_buffer& code) -> tl::expected<std::vector<lcl::token>, lcl::tokenizer_error>
+    {
+        return tokenize_code<lcl::default_tokenizer_policy>(code, {});
+    }
+
+    [[nodiscard]] auto tokenize_code(const std::string_view& code) -> tl::expected<std::vector<lcl::token>, lcl::tokenizer_error>
+    {
+        const auto buffer = lcl::source_buffer { code };
+
+        auto tokens = std::vector<lcl::token>{};
+
+        //The errors point into the buffer, we move them back into `code` before the buffer goes away.
+        return tokenize_padded_code<lcl::default_tokenizer_policy>(buffer.padded_code(), code, tokens, {}).map([&] () 
+        { 
+            return std::move(tokens); 
+        }).map_error([&] (const lcl::tokenizer_error& error)
+        {
+            const auto error_offset = std::distance(std::cbegin(buffer.padded_code()), error.iterator_when_error_occured);
+
+            return lcl::tokenizer_error { error.error_type, std::next(std::cbegin(code), error_offset) };
+        });
+    }
+
+    [[nodiscard]] auto tokenize_code_with_bracket_pairs(const lcl::source_buffer& code) -> tl::expected<lcl::tokenized_code, lcl::tokenizer_error>
+    {
+        auto tokens   = std::vector<lcl::token>{};
+        auto brackets = lcl::bracket_pairs{};
+
+        return tokenize_padded_code<lcl::default_tokenizer_policy>(code.padded_code(), code.code(), tokens, {}, &brackets).map([&] ()
+        {
+            return lcl::tokenized_code { std::move(tokens), std::move(brackets) };
+        });
+    }
+
+    //Collects the tokens into batches so the queue indices are published once per batch instead of once per token.
+    //Once the consumer cancelled the queue it stops wanting tokens, the cancellation is only looked at once per batch.
+    class token_queue_sink
+    {
+        static constexpr std::size_t batch_size = 256;
+
+        lcl::token_queue&       m_queue;
+        std::vector<lcl::token> m_batch;
+        bool                    m_cancelled = false;
+
+        public:
+        explicit token_queue_sink(lcl::token_queue& queue) : m_queue(queue)
+        {
+            m_batch.reserve(batch_size);
+        }
+
+        template <class... Args> auto emplace_back(Args&&... args) -> void
+        {
+            m_batch.emplace_back(std::forward<Args>(args)...);
+
+            if (m_batch.size() == batch_size)
+            {
+                flush();
+            }
+        }
+
+        auto flush() -> void
+        {
+            m_queue.push_tokens(m_batch);
+            m_batch.clear();
+
+            m_cancelled = m_queue.is_cancelled();
+        }
+
+        [[nodiscard]] auto wants_more_tokens() const noexcept -> bool
+        {
+            return !m_cancelled;
+        }
+    };
+
+    auto tokenize_code_into_queue(const lcl::source_buffer& code, lcl::token_queue& queue) -> void
+    {
+        auto       tokens = token_queue_sink { queue };
+        const auto result = tokenize_padded_code<lcl::default_tokenizer_policy>(code.padded_code(), code.code(), tokens, {});
+
+        tokens.flush();
+        queue.finish(result ? std::nullopt : std::optional<lcl::tokenizer_error> { result.error() });
+    }
+
+    //Builds the import statements out of the tokens as they are produced and stops wanting tokens on the first one that is not part of them.
+    class import_prescan_sink
+    {
+        enum class state
+        {
+            before_statement,  // import
+            module_name,       // Name
+            colon,             // :
+            first_name,        // * | name
+            name,              // name
+            after_name,        // , | ;
+            semicolon,         // ;
+            done,
+        };
+
+        std::vector<lcl::module_import>& m_imports;
+        state                            m_state = state::before_statement;
+
+        public:
+        explicit import_prescan_sink(std::vector<lcl::module_import>& imports) : m_imports(imports)
+        {
+            //Empty
+        }
+
+        auto emplace_back(const lcl::token_type type, const std::string_view& code, const lcl::token_flags, const std::uint32_t) -> void
+        {
+            const auto is_word = type == lcl::token_type::word;
+
+            switch (m_state)
+            {
+                case state::before_statement:
+                {
+                    if (is_word && code == "import")
+                    {
+                        m_imports.emplace_back();
+                        m_state = state::module_name;
+                        return;
+                    }
+
+                    m_state = state::done;
+                    return;
+                }
+
+                case state::module_name:
+                {
+                    if (is_word)
+                    {
+                        m_imports.back().module_name = code;
+                        m_state = state::colon;
+                        return;
+                    }
+
+                    break;
+                }
+
+                case state::colon:
+                {
+                    if (type == lcl::token_type::colon)
+                    {
+                        m_state = state::first_name;
+                        return;
+                    }
+
+                    break;
+                }
+
+                case state::first_name:
+                case state::name:
+                {
+                    if (m_state == state::first_name && type == lcl::token_type::star)
+                    {
+                        m_imports.back().is_full_import = true;
+                        m_state = state::semicolon;
+                        return;
+                    }
+
+                    if (is_word)
+                    {
+                        m_imports.back().imported_names.push_back(code);
+                        m_state = state::after_name;
+                        return;
+                    }
+
+                    break;
+                }
+
+                case state::after_name:
+                {
+                    if (type == lcl::token_type::comma)
+                    {
+                        m_state = state::name;
+                        return;
+                    }
+
+                    if (type == lcl::token_type::semicolon)
+                    {
+                        m_state = state::before_statement;
+                        return;
+                    }
+
+                    break;
+                }
+
+                case state::semicolon:
+                {
+                    if (type == lcl::token_type::semicolon)
+                    {
+                        m_state = state::before_statement;
+                        return;
+                    }
+
+                    break;
+                }
+
+                case state::done:
+                {
+                    return;
+                }
+            }
+
+            //Malformed import statement
+            m_imports.pop_back();
+            m_state = state::done;
+        }
+
+        [[nodiscard]] auto wants_more_tokens() const noexcept -> bool
+        {
+            return m_state != state::done;
+        }
+
+        //Drops the last statement if the code ended in the middle of it
+        auto finish() -> void
+        {
+            if (m_state != state::before_statement && m_state != state::done)
+            {
+                m_imports.pop_back();
+            }
+
+            m_state = state::done;
+        }
+    };
+
+    [[nodiscard]] auto prescan_imports(const lcl::source_buffer& code, const std::vector<std::string_view>& defined_symbols) -> tl::expected<std::vector<lcl::module_import>, lcl::tokenizer_error>
+    {
+        auto imports = std::vector<lcl::module_import>{};
+        auto sink    = import_prescan_sink { imports };
+
+        const auto result = tokenize_padded_code<lcl::minimal_tokenizer_policy>(code.padded_code(), code.code(), sink, defined_symbols);
+
+        if (!result)
+        {
+            return tl::unexpected(result.error());
+        }
+
+        sink.finish();
+
+        return imports;
+    }
+
+    //Writes the tokens one after the other in an arena that nothing else allocates from while a file is tokenized, so they end up as one array
+    class arena_token_sink
+    {
+        lcl::memory::contiguous_virtual_memory_arena& m_arena;
+        lcl::token*                                   m_first_token = nullptr;
+        std::size_t                                   m_token_count = 0;
+
+        public:
+        explicit arena_token_sink(lcl::memory::contiguous_virtual_memory_arena& arena) noexcept : m_arena(arena)
+        {
+            //Empty
+        }
+
+        template <class... Args> auto emplace_back(Args&&... args) -> void
+        {
+            //The size of a token is a multiple of its alignment, so every token starts where the one before it ended
+            auto* const token = new (m_arena.allocate(sizeof(lcl::token), alignof(lcl::token))) lcl::token(std::forward<Args>(args)...);
+
+            if (m_first_token == nullptr)
+            {
+                m_first_token = token;
+            }
+
+            ++m_token_count;
+        }
+
+        [[nodiscard]] auto tokens() const noexcept -> gsl::span<const lcl::token>
+        {
+            return gsl::span<const lcl::token> { m_first_token, m_token_count };
+        }
+    };
+
+    tokenizer_pool::tokenizer_pool(const std::size_t worker_count, const std::size_t bytes_per_arena) : m_arenas((bytes_per_arena + lcl::memory::get_page_size() - 1) / lcl::memory::get_page_size())
+    {
+        const auto arena_count = std::max(worker_count, std::size_t { 1 });
+
+        m_worker_arenas.reserve(arena_count);
+
+        for (auto i = std::size_t { 0 }; i < arena_count; ++i)
+        {
+            auto scratch = m_arenas.acquire();
+            auto tokens  = m_arenas.acquire();
+
+            m_worker_arenas.push_back(worker_arenas { std::move(scratch), std::move(tokens) });
+        }
+
+        //Destroying a thread that is still joinable terminates, the threads that started are stopped before an exception leaves
+        try
+        {
+            for (auto i = std::size_t { 1 }; i < arena_count; ++i)
+            {
+                m_threads.emplace_back(&tokenizer_pool::run_thread, this, i);
+            }
+        }
+        catch (...)
+        {
+            stop_threads();
+            throw;
+        }
+    }
+
+    tokenizer_pool::~tokenizer_pool()
+    {
+        stop_threads();
+    }
+
+    auto tokenizer_pool::stop_threads() -> void
+    {
+        {
+            const auto lock = std::lock_guard<std::mutex> { m_mutex };
+            m_stopping = true;
+        }
+
+        m_batch_ready.notify_all();
+
+        for (auto& thread : m_threads)
+        {
+            thread.join();
+        }
+
+        m_threads.clear();
+    }
+
+    auto tokenizer_pool::run_thread(const std::size_t worker_index) -> void
+    {
+        auto last_batch_number = std::size_t { 0 };
+
+        while (true)
+        {
+            {
+                auto lock = std::unique_lock<std::mutex> { m_mutex };
+                m_batch_ready.wait(lock, [&] () { return m_stopping || m_batch_number != last_batch_number; });
+
+                if (m_stopping)
+                {
+                    return;
+                }
+
+                last_batch_number = m_batch_number;
+            }
+
+            work(worker_index);
+
+            {
+                const auto lock = std::lock_guard<std::mutex> { m_mutex };
+
+                if (--m_busy_threads != 0)
+                {
+                    continue;
+                }
+            }
+
+            m_batch_done.notify_one();
+        }
+    }
+
+    auto tokenizer_pool::work(const std::size_t worker_index) -> void
+    {
+        try
+        {
+            tokenize_files(worker_index);
+        }
+        catch (...)
+        {
+            //No more files are handed out, the other workers stop after the file they are on
+            m_next_file_index.store(m_files.size(), std::memory_order_relaxed);
+
+            const auto lock = std::lock_guard<std::mutex> { m_first_exception_mutex };
+
+            if (!m_first_exception)
+            {
+                m_first_exception = std::current_exception();
+            }
+        }
+    }
+
+    auto tokenizer_pool::tokenize_files(const std::size_t worker_index) -> void
+    {
+        auto& scratch_arena = m_worker_arenas[worker_index].scratch.arena();
+        auto& token_arena   = m_worker_arenas[worker_index].tokens.arena();
+
+        for (auto file_index = m_next_file_index.fetch_add(1, std::memory_order_relaxed); file_index < m_files.size(); file_index = m_next_file_index.fetch_add(1, std::memory_order_relaxed))
+        {
+            const auto& code = m_files[file_index];
+
+            //The padded copy is only needed while the file is tokenized
+            const auto scratch_marker = lcl::memory::scoped_arena_marker { scratch_arena };
+            const auto padded_size    = code.size() + 1 + lcl::source_buffer::padding_size;
+            auto* const padded_data   = reinterpret_cast<char*>(scratch_arena.allocate(padded_size, 1));
+
+            std::copy(std::cbegin(code), std::cend(code), padded_data);
+            std::memset(padded_data + code.size(), 0, 1 + lcl::source_buffer::padding_size);
+
+            const auto padded_code = std::string_view { padded_data, padded_size };
+            const auto tokens_mark = token_arena.checkpoint();
+            auto       tokens      = arena_token_sink { token_arena };
+
+            const auto result = tokenize_padded_code<lcl::default_tokenizer_policy>(padded_code, code, tokens, {});
+
+            if (result)
+            {
+                (*m_results)[file_index].emplace(tokens.tokens());
+            }
+            else
+            {
+                //The tokens of a file that failed are not kept, and the error points into the copy, we move it back into `code`
+                token_arena.rollback(tokens_mark);
+
+                const auto error_offset = std::distance(std::cbegin(padded_code), result.error().iterator_when_error_occured);
+
+                (*m_results)[file_index].emplace(tl::unexpected(lcl::tokenizer_error { result.error().error_type, std::next(std::cbegin(code), error_offset) }));
+            }
+        }
+    }
+
+    auto tokenizer_pool::tokenize(const gsl::span<const std::string_view> files) -> std::vector<file_result>
+    {
+        if (files.empty())
+        {
+            return {};
+        }
+
+        //Each file is written by a single worker, the optional only lets the results be made in any order
+        auto results = std::vector<std::optional<file_result>>(files.size());
+
+        //The tokens of the last batch are freed at once
+        for (auto& arenas : m_worker_arenas)
+        {
+            arenas.tokens.arena().rollback(lcl::memory::arena_mark { 0 });
+        }
+
+        m_files           = files;
+        m_results         = &results;
+        m_first_exception = nullptr;
+        m_next_file_index.store(0, std::memory_order_relaxed);
+
+        {
+            const auto lock = std::lock_guard<std::mutex> { m_mutex };
+
+            m_busy_threads = m_threads.size();
+            ++m_batch_number;
+        }
+
+        m_batch_ready.notify_all();
+
+        work(0);
+
+        {
+            auto lock = std::unique_lock<std::mutex> { m_mutex };
+            m_batch_done.wait(lock, [this] () { return m_busy_threads == 0; });
+        }
+
+        m_results = nullptr;
+
+        if (m_first_exception)
+        {
+            std::rethrow_exception(m_first_exception);
+        }
+
+        auto ordered_results = std::vector<file_result>{};
+        ordered_results.reserve(files.size());
+
+        for (auto& result : results)
+        {
+            ordered_results.push_back(std::move(*result));
         }
 
-        return tokens;
+        return ordered_results;
     }
-}
\ No newline at end of file
+}
@@ -1,12 +1,15 @@
 #ifndef LCLCOMPILER_TOKENIZER_HPP
 #define LCLCOMPILER_TOKENIZER_HPP
 
+#include <cstdint>
+#include <type_traits>
 #include <vector>
 #include <string_view>
 
 #include <tl/expected.hpp>
 
 #include <chars.hpp>
+#include <source_buffer.hpp>
 #include <std_utils.hpp>
 
 namespace lcl
@@ -19,6 +22,15 @@ namespace lcl
         string_literal_not_closed_properly,
         numeric_literal_ends_with_underscore,
         numeric_literal_contains_unexpected_character,
+        directive_condition_missing,
+        directive_else_without_if,
+        directive_else_repeated,
+        directive_end_without_if,
+        directive_if_not_closed,
+        unexpected_characters_after_directive,
+        unknown_escape_sequence,
+        hex_escape_sequence_not_valid,
+        unknown_character,
     };
 
     struct tokenizer_error
@@ -377,61 +389,73 @@ namespace lcl
         return static_cast<lcl::token_type>(0);
     }
 
+    //Facts about a token that the tokenizer already knows when it creates it.
+    //They are stored so that asking about a token never has to look at its code again.
+    enum class token_flags : std::uint16_t
+    {
+        none                = 0,
+        multi_line_comment  = 1 << 0, // /* Comment */
+        single_line_comment = 1 << 1, // //Comment
+        int_literal         = 1 << 2, // 123
+        float_literal       = 1 << 3, // 1.23
+        keyword             = 1 << 4, // if, for, while
+        has_escapes         = 1 << 5, // "\"Test\""
+        preceded_by_newline = 1 << 6, // First token on its line, including the first token in the code
+        has_underscores     = 1 << 7, // 1_000
+        joined_to_previous  = 1 << 8, // The second `=` of `==`, starts right where the previous token ends
+    };
+
+    [[nodiscard]] constexpr auto operator|(const lcl::token_flags lhs, const lcl::token_flags rhs) noexcept -> lcl::token_flags
+    {
+        return static_cast<lcl::token_flags>(static_cast<std::uint16_t>(lhs) | static_cast<std::uint16_t>(rhs));
+    }
+
+    [[nodiscard]] constexpr auto operator&(const lcl::token_flags lhs, const lcl::token_flags rhs) noexcept -> lcl::token_flags
+    {
+        return static_cast<lcl::token_flags>(static_cast<std::uint16_t>(lhs) & static_cast<std::uint16_t>(rhs));
+    }
+
+    constexpr auto operator|=(lcl::token_flags& lhs, const lcl::token_flags rhs) noexcept -> lcl::token_flags&
+    {
+        lhs = lhs | rhs;
+        return lhs;
+    }
+
     struct token
     {
         const lcl::token_type  type;
         const std::string_view code;
+        const lcl::token_flags flags;
+        const std::uint32_t    line; //Starts at 1, 0 when the tokenizer was not tracking line numbers
 
-        constexpr explicit token(const lcl::token_type type, const std::string_view& code_of_token) : type(type), code(code_of_token)
+        constexpr explicit token(const lcl::token_type type, const std::string_view& code_of_token, const lcl::token_flags flags = lcl::token_flags::none, const std::uint32_t line = 0) : type(type), code(code_of_token), flags(flags), line(line)
         {
             //Empty
         }
 
+        [[nodiscard]] constexpr auto has_flags(const lcl::token_flags flags_to_check) const noexcept -> bool
+        {
+            return (flags & flags_to_check) == flags_to_check;
+        }
+
         [[nodiscard]] constexpr auto is_multi_line_comment() const noexcept -> bool
         {
-            return type == lcl::token_type::comment && string_view_slice(code, 2) == "/*";
+            return has_flags(lcl::token_flags::multi_line_comment);
         }
 
         [[nodiscard]] constexpr auto is_single_line_comment() const noexcept -> bool
         {
-            return type == lcl::token_type::comment && string_view_slice(code, 2) == "//";
+            return has_flags(lcl::token_flags::single_line_comment);
         }
 
         [[nodiscard]] constexpr auto is_int_literal() const noexcept -> bool 
         {
-            if (type == lcl::token_type::numeric_literal)
-            {
-                for (const auto& it : code)
-                {
-                    if (it == '.')
-                    {
-                        return false;
-                    }
-                }
-
-                return true;
-            }
-
-            return false;
+            return has_flags(lcl::token_flags::int_literal);
         }
 
-        //@Cleanup: replace loop with contsexpr std::find in C++20
         [[nodiscard]] constexpr auto is_float_literal() const noexcept -> bool 
         {
-            if (type == lcl::token_type::numeric_literal)
-            {
-                for (const auto& it : code)
-                {
-                    if (it == '.')
-                    {
-                        return true;
-                    }
-                }
-
-                return false;
-            }
-
-            return false;
+            return has_flags(lcl::token_flags::float_literal);
         }
 
         [[nodiscard]] constexpr auto is_single_char_token() const noexcept -> bool 
@@ -441,12 +465,34 @@ namespace lcl
 
         [[nodiscard]] constexpr auto is_keyword() const noexcept -> bool 
         {
-            return type == lcl::token_type::word && lcl::is_keyword(code);
+            return has_flags(lcl::token_flags::keyword);
         }
 
         [[nodiscard]] constexpr auto is_identifier() const noexcept -> bool 
         {
-            return type == lcl::token_type::word && !lcl::is_keyword(code);
+            return type == lcl::token_type::word && !has_flags(lcl::token_flags::keyword);
+        }
+
+        [[nodiscard]] constexpr auto has_escapes() const noexcept -> bool 
+        {
+            return has_flags(lcl::token_flags::has_escapes);
+        }
+
+        [[nodiscard]] constexpr auto is_preceded_by_newline() const noexcept -> bool 
+        {
+            return has_flags(lcl::token_flags::preceded_by_newline);
+        }
+
+        //Operators made of many characters are single char tokens joined together, Eg: `==` or `->`.
+        //Recorded by the tokenizer because the code of tokens that are interned or stored away no longer sits where it was written.
+        [[nodiscard]] constexpr auto is_joined_to_previous() const noexcept -> bool 
+        {
+            return has_flags(lcl::token_flags::joined_to_previous);
+        }
+
+        [[nodiscard]] constexpr auto has_underscores() const noexcept -> bool 
+        {
+            return has_flags(lcl::token_flags::has_underscores);
         }
     };
 
@@ -465,7 +511,111 @@ namespace lcl
         return chars::is_ascii_digit(it) || it == '.' || it == '_';
     }
 
+    [[nodiscard]] constexpr auto is_opening_bracket(const lcl::token_type it) noexcept -> bool
+    {
+        return it == lcl::token_type::open_parans || it == lcl::token_type::open_square_bracket || it == lcl::token_type::open_curly;
+    }
+
+    [[nodiscard]] constexpr auto is_closing_bracket(const lcl::token_type it) noexcept -> bool
+    {
+        return it == lcl::token_type::close_parans || it == lcl::token_type::close_square_breacket || it == lcl::token_type::close_curly;
+    }
+
+    [[nodiscard]] constexpr auto get_closing_bracket_of(const lcl::token_type opening_bracket) noexcept -> lcl::token_type
+    {
+        assert(is_opening_bracket(opening_bracket));
+
+        switch (opening_bracket)
+        {
+            case lcl::token_type::open_parans:         return lcl::token_type::close_parans;
+            case lcl::token_type::open_square_bracket: return lcl::token_type::close_square_breacket;
+            case lcl::token_type::open_curly:          return lcl::token_type::close_curly;
+            default:                                   break;
+        }
+
+        //Should never be reached
+        assert(false);
+        return static_cast<lcl::token_type>(0);
+    }
+
+    //Pairs of `()`, `[]` and `{}` found while tokenizing, so a parser can jump over a bracketed range without counting tokens.
+    struct bracket_pairs
+    {
+        static constexpr std::uint32_t no_matching_bracket = UINT32_MAX;
+
+        //Indexed by token index. Holds the index of the matching closer for an opener and `no_matching_bracket` for every other token.
+        std::vector<std::uint32_t> matching_closers;
+
+        //Token indices, in order, of the brackets that have no matching bracket. Empty when the brackets are balanced.
+        std::vector<std::uint32_t> unmatched_brackets;
+
+        [[nodiscard]] auto matching_closer(const std::size_t opener_token_index) const noexcept -> std::uint32_t
+        {
+            assert(opener_token_index < matching_closers.size());
+
+            return matching_closers[opener_token_index];
+        }
+
+        [[nodiscard]] auto are_balanced() const noexcept -> bool
+        {
+            return unmatched_brackets.empty();
+        }
+    };
+
+    struct tokenized_code
+    {
+        std::vector<lcl::token> tokens;
+        lcl::bracket_pairs      brackets;
+    };
+
+    //Features of the tokenizer that are picked at compile time. Every combination is its own instantiation of `tokenize_code`,
+    //so a feature that is turned off costs nothing in the tokenizer loop.
+    template <bool KeepComments, bool TrackLineNumbers, bool UnicodeIdentifiers, bool CollectErrors>
+    struct tokenizer_policy
+    {
+        //Produce `comment` tokens, otherwise comments are skipped like white space.
+        static constexpr bool keep_comments       = KeepComments;
+
+        //Fill in `token::line`.
+        static constexpr bool track_line_numbers  = TrackLineNumbers;
+
+        //Accept Unicode letters and digits in words, otherwise words are ASCII only.
+        static constexpr bool unicode_identifiers = UnicodeIdentifiers;
+
+        //Record every error and keep tokenizing after it, otherwise stop at the first error.
+        static constexpr bool collect_errors      = CollectErrors;
+    };
+
+    //Used when no policy is given
+    using default_tokenizer_policy = lcl::tokenizer_policy<true, true, false, false>;
+
+    //Only what a parser needs
+    using minimal_tokenizer_policy = lcl::tokenizer_policy<false, false, false, false>;
+
+    struct tokenized_code_with_errors
+    {
+        std::vector<lcl::token>           tokens;
+        std::vector<lcl::tokenizer_error> errors;
+    };
+
+    //Policies that collect errors always produce tokens, the rest produce tokens or the first error
+    template <class Policy>
+    using tokenizer_result = std::conditional_t<Policy::collect_errors, lcl::tokenized_code_with_errors, tl::expected<std::vector<lcl::token>, lcl::tokenizer_error>>;
+
+    //Instantiated for every `tokenizer_policy`. The tokens point into the code inside the buffer, so the buffer must outlive them.
+    //`#if NAME` and `#if not NAME` blocks, with an optional `#else` and closed by `#end`, are evaluated against `defined_symbols` while tokenizing.
+    //The directives must start their line, they produce no tokens and the branches that are not taken are never tokenized.
+    template <class Policy>
+    [[nodiscard]] auto tokenize_code(const lcl::source_buffer& code, const std::vector<std::string_view>& defined_symbols = {}) -> lcl::tokenizer_result<Policy>;
+
+    //Uses the `default_tokenizer_policy`. The tokens point into the code inside the buffer, so the buffer must outlive them.
+    [[nodiscard]] tl::expected<std::vector<lcl::token>, lcl::tokenizer_error> tokenize_code(const lcl::source_buffer& code);
+
+    //Copies the code into a temporary `source_buffer`, the tokens still point into `code`.
     [[nodiscard]] tl::expected<std::vector<lcl::token>, lcl::tokenizer_error> tokenize_code(const std::string_view& code);
+
+    //Same as `tokenize_code` but also pairs the brackets in the same pass. Unbalanced brackets are not an error, they are listed in `unmatched_brackets`.
+    [[nodiscard]] tl::expected<lcl::tokenized_code, lcl::tokenizer_error> tokenize_code_with_bracket_pairs(const lcl::source_buffer& code);
 }
 
 #endif //LCLCOMPILER_TOKENIZER_HPP
@@ -0,0 +1,193 @@
+#ifndef LCLCOMPILER_VIRTUAL_VECTOR_HPP
+#define LCLCOMPILER_VIRTUAL_VECTOR_HPP
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <utility>
+
+#include <memory.hpp>
+
+namespace lcl::memory
+{
+    //A vector that reserves the address range for `max_size` elements up front and commits pages as it grows.
+    //The elements never move, so pointers and views into them stay valid while it grows, and growing never copies.
+    //Reserving costs no memory, so `max_size` can be far bigger than what is expected to be used.
+    template <class T> class virtual_vector
+    {
+        public:
+        using value_type      = T;
+        using size_type       = std::size_t;
+        using difference_type = std::ptrdiff_t;
+        using iterator        = T*;
+        using const_iterator  = const T*;
+
+        private:
+        T*          m_data            = nullptr;
+        std::size_t m_size            = 0;
+        std::size_t m_max_size        = 0;
+        std::size_t m_reserved_pages  = 0;
+        std::size_t m_committed_pages = 0;
+
+        //Grows like an arena, see `contiguous_virtual_memory_arena::pages_to_commit`
+        auto grow_committed_memory() -> void
+        {
+            const auto pages_to_commit = contiguous_virtual_memory_arena::pages_to_commit((m_size + 1) * sizeof(T), m_committed_pages, m_reserved_pages);
+
+            commit_memory_pages(reinterpret_cast<std::byte*>(m_data) + m_committed_pages * get_page_size(), pages_to_commit);
+            m_committed_pages += pages_to_commit;
+        }
+
+        public:
+        //Throws `std::bad_alloc` when `max_size` elements don't fit in the address space
+        explicit virtual_vector(const std::size_t max_size) : m_max_size(max_size)
+        {
+            const auto page_size = get_page_size();
+
+            if (max_size > (SIZE_MAX - (page_size - 1)) / sizeof(T))
+            {
+                throw std::bad_alloc{};
+            }
+
+            m_reserved_pages = std::max<std::size_t>((max_size * sizeof(T) + page_size - 1) / page_size, 1);
+            m_data           = reinterpret_cast<T*>(reserve_memory_pages(m_reserved_pages));
+        }
+
+        virtual_vector(virtual_vector&& other) noexcept : m_data(std::exchange(other.m_data, nullptr)), m_size(std::exchange(other.m_size, 0)), m_max_size(other.m_max_size), m_reserved_pages(other.m_reserved_pages), m_committed_pages(std::exchange(other.m_committed_pages, 0))
+        {
+            //Empty
+        }
+
+        virtual_vector& operator=(virtual_vector&& other) noexcept
+        {
+            std::swap(m_data,            other.m_data);
+            std::swap(m_size,            other.m_size);
+            std::swap(m_max_size,        other.m_max_size);
+            std::swap(m_reserved_pages,  other.m_reserved_pages);
+            std::swap(m_committed_pages, other.m_committed_pages);
+
+            return *this;
+        }
+
+        virtual_vector(const virtual_vector&) = delete;
+        virtual_vector& operator=(const virtual_vector&) = delete;
+
+        //Throws `std::bad_alloc` once `max_size` elements are in the vector
+        template <class... Args> auto emplace_back(Args&&... args) -> T&
+        {
+            if (m_size == m_max_size)
+            {
+                throw std::bad_alloc{};
+            }
+
+            if ((m_size + 1) * sizeof(T) > m_committed_pages * get_page_size())
+            {
+                grow_committed_memory();
+            }
+
+            const auto element = new (m_data + m_size) T(std::forward<Args>(args)...);
+            ++m_size;
+
+            return *element;
+        }
+
+        auto push_back(const T& value) -> void
+        {
+            emplace_back(value);
+        }
+
+        auto push_back(T&& value) -> void
+        {
+            emplace_back(std::move(value));
+        }
+
+        //The pages stay committed, see `shrink_to_fit`
+        auto pop_back() noexcept -> void
+        {
+            assert(m_size != 0);
+
+            --m_size;
+            m_data[m_size].~T();
+        }
+
+        auto clear() noexcept -> void
+        {
+            while (m_size != 0)
+            {
+                pop_back();
+            }
+        }
+
+        //Decommits the pages after the last element
+        auto shrink_to_fit() -> void
+        {
+            const auto page_size  = get_page_size();
+            const auto pages_used = (m_size * sizeof(T) + page_size - 1) / page_size;
+
+            if (pages_used < m_committed_pages)
+            {
+                decommit_memory_pages(reinterpret_cast<std::byte*>(m_data) + pages_used * page_size, m_committed_pages - pages_used);
+                m_committed_pages = pages_used;
+            }
+        }
+
+        [[nodiscard]] auto operator[](const std::size_t index) noexcept -> T&
+        {
+            assert(index < m_size);
+            return m_data[index];
+        }
+
+        [[nodiscard]] auto operator[](const std::size_t index) const noexcept -> const T&
+        {
+            assert(index < m_size);
+            return m_data[index];
+        }
+
+        [[nodiscard]] auto front() noexcept -> T&             { assert(m_size != 0); return m_data[0]; }
+        [[nodiscard]] auto front() const noexcept -> const T& { assert(m_size != 0); return m_data[0]; }
+        [[nodiscard]] auto back() noexcept -> T&              { assert(m_size != 0); return m_data[m_size - 1]; }
+        [[nodiscard]] auto back() const noexcept -> const T&  { assert(m_size != 0); return m_data[m_size - 1]; }
+
+        [[nodiscard]] auto begin() noexcept -> iterator              { return m_data; }
+        [[nodiscard]] auto begin() const noexcept -> const_iterator  { return m_data; }
+        [[nodiscard]] auto end() noexcept -> iterator                { return m_data + m_size; }
+        [[nodiscard]] auto end() const noexcept -> const_iterator    { return m_data + m_size; }
+
+        [[nodiscard]] auto data() noexcept -> T*             { return m_data; }
+        [[nodiscard]] auto data() const noexcept -> const T* { return m_data; }
+
+        [[nodiscard]] auto size() const noexcept -> std::size_t
+        {
+            return m_size;
+        }
+
+        [[nodiscard]] auto empty() const noexcept -> bool
+        {
+            return m_size == 0;
+        }
+
+        [[nodiscard]] auto max_size() const noexcept -> std::size_t
+        {
+            return m_max_size;
+        }
+
+        //Elements that fit in the committed pages
+        [[nodiscard]] auto capacity() const noexcept -> std::size_t
+        {
+            return std::min(m_committed_pages * get_page_size() / sizeof(T), m_max_size);
+        }
+
+        ~virtual_vector()
+        {
+            if (m_data != nullptr)
+            {
+                clear();
+                unreserve_memory_pages(m_data, m_reserved_pages);
+            }
+        }
+    };
+}
+
+#endif //LCLCOMPILER_VIRTUAL_VECTOR_HPP
@@ -1,6 +1,9 @@
+#if defined(_WIN32)
+
 #include <cstddef>
 #include <cassert>
 #include <exception>
+#include <new>
 #include <windows.h>
 
 namespace lcl::memory
@@ -37,16 +40,92 @@ namespace lcl::memory
     
     auto commit_memory_pages(const void* base_address, const std::size_t pages_to_commit) -> void
     {
-        //@Todo
+        auto result = VirtualAlloc(const_cast<void*>(base_address), pages_to_commit * get_page_size(), MEM_COMMIT, PAGE_READWRITE);
+
+        if (result == nullptr)
+        {
+            throw std::bad_alloc{};
+        }
     }
 
     auto decommit_memory_pages(const void* base_address, const std::size_t pages_to_uncommit) -> void
     {
-        //@Todo
+        const auto result = VirtualFree(const_cast<void*>(base_address), pages_to_uncommit * get_page_size(), MEM_DECOMMIT);
+
+        assert(result != 0);
+        static_cast<void>(result);
     }
 
+    //The whole reservation is released, `base_address` must be the address returned by `reserve_memory_pages`
     auto unreserve_memory_pages(const void* base_address, const std::size_t pages_to_unreserve) -> void
     {
-        //@Todo
+        const auto result = VirtualFree(const_cast<void*>(base_address), 0, MEM_RELEASE);
+
+        assert(result != 0);
+        static_cast<void>(result);
+    }
+
+    auto release_memory_pages(const void* base_address, const std::size_t pages_to_release) -> void
+    {
+        //The pages stay committed, their content can be thrown away instead of being written to the page file
+        const auto result = VirtualAlloc(const_cast<void*>(base_address), pages_to_release * get_page_size(), MEM_RESET, PAGE_READWRITE);
+
+        assert(result != nullptr);
+        static_cast<void>(result);
+    }
+
+    auto advise_huge_memory_pages(const void* base_address, const std::size_t pages_to_advise) -> void
+    {
+        //Large pages on windows need the SeLockMemoryPrivilege and have to be committed when reserved with MEM_LARGE_PAGES,
+        //they don't fit reserving and committing separately, so the pages stay regular ones
+        static_cast<void>(base_address);
+        static_cast<void>(pages_to_advise);
+    }
+
+    [[nodiscard]] auto map_file(const char* path, std::size_t& file_size) -> const std::byte*
+    {
+        const auto file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+
+        if (file == INVALID_HANDLE_VALUE)
+        {
+            return nullptr;
+        }
+
+        auto size = LARGE_INTEGER {};
+
+        if (!GetFileSizeEx(file, &size) || size.QuadPart == 0)
+        {
+            CloseHandle(file);
+            return nullptr;
+        }
+
+        file_size = static_cast<std::size_t>(size.QuadPart);
+
+        const auto mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        CloseHandle(file);
+
+        if (mapping == nullptr)
+        {
+            return nullptr;
+        }
+
+        //The view keeps the mapping and the file open
+        const auto result = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+        CloseHandle(mapping);
+
+        return static_cast<const std::byte*>(result);
+    }
+
+    auto unmap_file(const void* base_address, const std::size_t file_size) -> void
+    {
+        //The view is unmapped whole, only `munmap` needs the size
+        static_cast<void>(file_size);
+
+        const auto result = UnmapViewOfFile(base_address);
+
+        assert(result != 0);
+        static_cast<void>(result);
     }
-}
\ No newline at end of file
+}
+
+#endif
@@ -0,0 +1,136 @@
+#define CATCH_CONFIG_MAIN
+#define CATCH_CONFIG_ENABLE_BENCHMARKING
+#include <catch2/catch.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <flat_hash_map.hpp>
+#include <memory.hpp>
+#include <small_vector.hpp>
+
+//About as many distinct identifiers as a large module declares, with the shapes they usually have
+static auto make_identifiers() -> std::vector<std::string>
+{
+    static constexpr const char* prefixes[] = { "get_", "set_", "is_", "m_", "make_", "", "to_", "parse_" };
+    static constexpr const char* stems[]    = { "token", "node", "buffer", "index", "value", "type", "scope", "symbol", "name", "count" };
+
+    auto identifiers = std::vector<std::string>{};
+
+    for (auto i = std::size_t { 0 }; i < 100000; ++i)
+    {
+        identifiers.push_back(std::string { prefixes[i % 8] } + stems[(i / 8) % 10] + "_" + std::to_string(i / 80));
+    }
+
+    return identifiers;
+}
+
+//Every identifier is looked up as many times as it is used, which is a few times more than it is declared
+template <class Map> static auto declare_and_look_up(Map& map, const std::vector<std::string_view>& identifiers) -> std::size_t
+{
+    for (auto i = std::size_t { 0 }; i < identifiers.size(); ++i)
+    {
+        map.try_emplace(identifiers[i], i);
+    }
+
+    auto checksum = std::size_t { 0 };
+
+    for (auto round = 0; round < 4; ++round)
+    {
+        for (const auto identifier : identifiers)
+        {
+            checksum += map.find(identifier)->second;
+        }
+
+        //Misses, like the lookups that walk up through the enclosing scopes
+        for (const auto identifier : identifiers)
+        {
+            checksum += map.find(identifier.substr(1)) == map.end();
+        }
+    }
+
+    return checksum;
+}
+
+TEST_CASE("Hash maps on identifiers", "[benchmark]")
+{
+    const auto identifier_strings = make_identifiers();
+    const auto identifiers        = std::vector<std::string_view>(std::cbegin(identifier_strings), std::cend(identifier_strings));
+
+    BENCHMARK("std::unordered_map")
+    {
+        auto map = std::unordered_map<std::string_view, std::size_t>{};
+        return declare_and_look_up(map, identifiers);
+    };
+
+    BENCHMARK("lcl::flat_hash_map")
+    {
+        auto map = lcl::flat_hash_map<std::string_view, std::size_t>{};
+        return declare_and_look_up(map, identifiers);
+    };
+
+    BENCHMARK("lcl::flat_hash_map in an arena")
+    {
+        using allocator = lcl::memory::virtual_arena_allocator<std::pair<const std::string_view, std::size_t>>;
+
+        auto arena = lcl::memory::contiguous_virtual_memory_arena { 4096 };
+        auto map   = lcl::flat_hash_map<std::string_view, std::size_t, std::hash<std::string_view>, std::equal_to<std::string_view>, allocator> { identifiers.size(), allocator { arena } };
+
+        return declare_and_look_up(map, identifiers);
+    };
+}
+
+//The children lists of a large AST, most nodes have a handful
+template <class Vector, class... Args> static auto build_child_lists(Args&&... args) -> std::size_t
+{
+    auto lists    = std::vector<Vector>{};
+    auto checksum = std::size_t { 0 };
+
+    lists.reserve(200000);
+
+    for (auto i = std::size_t { 0 }; i < 200000; ++i)
+    {
+        auto& children = lists.emplace_back(args...);
+
+        for (auto j = std::size_t { 0 }; j < (i % 7 == 0 ? 12 : i % 4); ++j)
+        {
+            children.push_back(static_cast<std::uint32_t>(i + j));
+        }
+    }
+
+    for (const auto& children : lists)
+    {
+        for (const auto child : children)
+        {
+            checksum += child;
+        }
+    }
+
+    return checksum;
+}
+
+TEST_CASE("Small vectors of children", "[benchmark]")
+{
+    BENCHMARK("std::vector")
+    {
+        return build_child_lists<std::vector<std::uint32_t>>();
+    };
+
+    BENCHMARK("lcl::small_vector")
+    {
+        return build_child_lists<lcl::small_vector<std::uint32_t, 4>>();
+    };
+
+    BENCHMARK("lcl::small_vector in an arena")
+    {
+        using allocator = lcl::memory::virtual_arena_allocator<std::uint32_t>;
+
+        auto arena = lcl::memory::contiguous_virtual_memory_arena { 4096 };
+        return build_child_lists<lcl::small_vector<std::uint32_t, 4, allocator>>(allocator { arena });
+    };
+}
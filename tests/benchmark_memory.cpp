@@ -0,0 +1,101 @@
+#define CATCH_CONFIG_MAIN
+#define CATCH_CONFIG_ENABLE_BENCHMARKING
+#include <catch2/catch.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <vector>
+
+#include <memory.hpp>
+#include <tokenizer.hpp>
+#include <virtual_vector.hpp>
+
+//About as many nodes as the AST of a large file has, of the sizes tokens and nodes have
+static constexpr auto allocation_count = std::size_t { 1000000 };
+
+[[nodiscard]] static auto allocation_size(const std::size_t index) noexcept -> std::size_t
+{
+    return 16 + (index % 4) * 8;
+}
+
+TEST_CASE("Arena allocation against malloc", "[benchmark]")
+{
+    BENCHMARK("malloc and free")
+    {
+        auto allocations = std::vector<void*>(allocation_count);
+        auto checksum    = std::uintptr_t { 0 };
+
+        for (auto i = std::size_t { 0 }; i < allocation_count; ++i)
+        {
+            allocations[i] = std::malloc(allocation_size(i));
+            *static_cast<std::byte*>(allocations[i]) = std::byte { 1 };
+            checksum += reinterpret_cast<std::uintptr_t>(allocations[i]);
+        }
+
+        for (const auto allocation : allocations)
+        {
+            std::free(allocation);
+        }
+
+        return checksum;
+    };
+
+    const auto arena_benchmark = [] (const lcl::memory::page_backing backing)
+    {
+        //Reserving much more than what is used costs nothing
+        auto arena    = lcl::memory::contiguous_virtual_memory_arena { 256 * 1024, backing };
+        auto checksum = std::uintptr_t { 0 };
+
+        for (auto i = std::size_t { 0 }; i < allocation_count; ++i)
+        {
+            const auto allocation = arena.allocate(allocation_size(i), 8);
+            *allocation = std::byte { 1 };
+            checksum += reinterpret_cast<std::uintptr_t>(allocation);
+        }
+
+        return checksum;
+    };
+
+    BENCHMARK("Arena")
+    {
+        return arena_benchmark(lcl::memory::page_backing::regular);
+    };
+
+    BENCHMARK("Arena with transparent huge pages")
+    {
+        return arena_benchmark(lcl::memory::page_backing::transparent_huge_pages);
+    };
+}
+
+TEST_CASE("Growing a token vector", "[benchmark]")
+{
+    //The token count of a large file
+    constexpr auto token_count = std::size_t { 5000000 };
+
+    const auto token = lcl::token { lcl::token_type::word, "hello_world" };
+
+    BENCHMARK("std::vector")
+    {
+        auto tokens = std::vector<lcl::token>{};
+
+        for (auto i = std::size_t { 0 }; i < token_count; ++i)
+        {
+            tokens.push_back(token);
+        }
+
+        return tokens.size();
+    };
+
+    BENCHMARK("virtual_vector")
+    {
+        auto tokens = lcl::memory::virtual_vector<lcl::token> { 1 << 28 };
+
+        for (auto i = std::size_t { 0 }; i < token_count; ++i)
+        {
+            tokens.push_back(token);
+        }
+
+        return tokens.size();
+    };
+}
@@ -0,0 +1,98 @@
+#define CATCH_CONFIG_MAIN
+#define CATCH_CONFIG_ENABLE_BENCHMARKING
+#include <catch2/catch.hpp>
+
+#include <chrono>
+#include <cstddef>
+#include <string>
+
+#include <memory.hpp>
+#include <parser.hpp>
+#include <source_buffer.hpp>
+#include <tokenizer.hpp>
+
+//Roughly 10MB of code, a mix of declarations, control flow and expressions
+static auto make_large_code() -> std::string
+{
+    auto code = std::string { "import Print: print, printf;\n\nVector :: struct { x: int; y: int; next: *Vector; }\n\n" };
+
+    for (auto i = 0; i < 40000; ++i)
+    {
+        const auto number = std::to_string(i);
+
+        code += "function_" + number + " :: (vector: *Vector, count: int) -> int\n"
+                "{\n"
+                "    //Comment\n"
+                "    total := 0;\n"
+                "    while count > 0 { total = total + vector.x * count - data[count % 4]; count = count - 1; }\n"
+                "    if total >= 1_000 and not done { print(\"Hello Sailor!\", total); } else return -1;\n"
+                "    return total << 2;\n"
+                "}\n";
+    }
+
+    return code;
+}
+
+//Roughly 10MB of long expressions that climb up and down every precedence level
+static auto make_expression_code() -> std::string
+{
+    auto code = std::string{};
+
+    for (auto i = 0; i < 20000; ++i)
+    {
+        code += "value_" + std::to_string(i) + " := a";
+
+        for (auto term = 0; term < 8; ++term)
+        {
+            code += " * b + c << 2 | d & e ^ f == g and h or i - j / k % l >= -m";
+        }
+
+        code += ";\n";
+    }
+
+    return code;
+}
+
+TEST_CASE("Parser throughput", "[benchmark]")
+{
+    const auto buffer = lcl::source_buffer { make_large_code() };
+    const auto tokens = lcl::tokenize_code(buffer).value();
+
+    //Each parse rolls back what it allocated, so the arena doesn't run out
+    auto arena = lcl::memory::contiguous_virtual_memory_arena { 1024 * 1024 };
+
+    //The target is at least 50MB of code a second on one core, the tokens are made up front
+    const auto start    = std::chrono::steady_clock::now();
+    const auto ast      = lcl::parse_tokens(tokens, arena);
+    const auto duration = std::chrono::duration<double>(std::chrono::steady_clock::now() - start);
+
+    REQUIRE(ast.has_value());
+    WARN("Parsed " << buffer.size() / 1000000.0 << "MB into " << ast->size() << " nodes at " << buffer.size() / 1000000.0 / duration.count() << "MB/s");
+
+    BENCHMARK("Parse")
+    {
+        const auto marker = lcl::memory::scoped_arena_marker { arena };
+        return lcl::parse_tokens(tokens, arena).value().size();
+    };
+
+    BENCHMARK("Tokenize and parse")
+    {
+        const auto marker      = lcl::memory::scoped_arena_marker { arena };
+        const auto file_tokens = lcl::tokenize_code(buffer).value();
+        return lcl::parse_tokens(file_tokens, arena).value().size();
+    };
+}
+
+TEST_CASE("Expression parser throughput", "[benchmark]")
+{
+    const auto buffer = lcl::source_buffer { make_expression_code() };
+    const auto tokens = lcl::tokenize_code(buffer).value();
+
+    auto arena = lcl::memory::contiguous_virtual_memory_arena { 1024 * 1024 };
+
+    BENCHMARK("Parse long expressions")
+    {
+        const auto marker = lcl::memory::scoped_arena_marker { arena };
+        return lcl::parse_tokens(tokens, arena).value().size();
+    };
+}
@@ -0,0 +1,144 @@
+#define CATCH_CONFIG_MAIN
+#define CATCH_CONFIG_ENABLE_BENCHMARKING
+#include <catch2/catch.hpp>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <batch_tokenizer.hpp>
+#include <import_prescan.hpp>
+#include <source_buffer.hpp>
+#include <token_queue.hpp>
+#include <tokenizer.hpp>
+
+//Roughly 10MB of code made of the kind of lines the tokenizer sees the most
+static auto make_large_code() -> std::string
+{
+    auto code = std::string{};
+
+    for (auto i = 0; i < 200000; ++i)
+    {
+        code += "    hello_world := print(\"Hello Sailor!\", 1_000, 2.5) + x * y; //Comment\n";
+    }
+
+    return code;
+}
+
+//Stands in for the parser, does a bit of work for every token
+static auto consume_tokens(const std::vector<lcl::token>& tokens, std::uint64_t& hash) -> void
+{
+    for (const auto& token : tokens)
+    {
+        for (const auto it : token.code)
+        {
+            hash = (hash ^ static_cast<std::uint8_t>(it)) * 1099511628211u;
+        }
+    }
+}
+
+TEST_CASE("Tokenizer and parser overlap", "[benchmark]")
+{
+    const auto buffer = lcl::source_buffer { make_large_code() };
+
+    BENCHMARK("Tokenize then parse")
+    {
+        auto hash = std::uint64_t { 14695981039346656037u };
+
+        consume_tokens(lcl::tokenize_code(buffer).value(), hash);
+
+        return hash;
+    };
+
+    BENCHMARK("Tokenize and parse pipelined")
+    {
+        auto hash      = std::uint64_t { 14695981039346656037u };
+        auto tokenizer = lcl::pipelined_tokenizer { buffer };
+        auto tokens    = std::vector<lcl::token>{};
+
+        while (tokenizer.pop_tokens(tokens, 1024))
+        {
+            consume_tokens(tokens, hash);
+            tokens.clear();
+        }
+
+        return hash;
+    };
+}
+
+TEST_CASE("Tokenizer policies", "[benchmark]")
+{
+    const auto buffer = lcl::source_buffer { make_large_code() };
+
+    BENCHMARK("Default policy")
+    {
+        return lcl::tokenize_code<lcl::default_tokenizer_policy>(buffer).value().size();
+    };
+
+    BENCHMARK("Minimal policy")
+    {
+        return lcl::tokenize_code<lcl::minimal_tokenizer_policy>(buffer).value().size();
+    };
+}
+
+TEST_CASE("Disabled conditional branches", "[benchmark]")
+{
+    const auto buffer = lcl::source_buffer { "#if PLATFORM\n" + make_large_code() + "#end\n" };
+
+    BENCHMARK("Branch taken")
+    {
+        return lcl::tokenize_code<lcl::minimal_tokenizer_policy>(buffer, { "PLATFORM" }).value().size();
+    };
+
+    BENCHMARK("Branch skipped")
+    {
+        return lcl::tokenize_code<lcl::minimal_tokenizer_policy>(buffer).value().size();
+    };
+}
+
+TEST_CASE("Import prescan", "[benchmark]")
+{
+    const auto buffer = lcl::source_buffer { "import Print: print, printf;\nimport Math: *;\n\n" + make_large_code() };
+
+    BENCHMARK("Tokenize everything")
+    {
+        return lcl::tokenize_code<lcl::minimal_tokenizer_policy>(buffer).value().size();
+    };
+
+    BENCHMARK("Prescan imports")
+    {
+        return lcl::prescan_imports(buffer).value().size();
+    };
+}
+
+TEST_CASE("Batch tokenization", "[benchmark]")
+{
+    //Thousands of small files, like the driver gets for a build
+    auto file_codes = std::vector<std::string>{};
+
+    for (auto i = 0; i < 4000; ++i)
+    {
+        file_codes.push_back("import Print: print;\n\n" + std::string(static_cast<std::size_t>(i % 50 + 1) * 40, ' ') + "main := () { print(\"Hello Sailor!\", 1_000, 2.5); }\n");
+    }
+
+    const auto files = std::vector<std::string_view>(std::cbegin(file_codes), std::cend(file_codes));
+
+    BENCHMARK("tokenize_code in a loop")
+    {
+        auto token_count = std::size_t { 0 };
+
+        for (const auto& file : files)
+        {
+            token_count += lcl::tokenize_code(file).value().size();
+        }
+
+        return token_count;
+    };
+
+    auto pool = lcl::tokenizer_pool{};
+
+    BENCHMARK("tokenizer_pool")
+    {
+        return pool.tokenize(files).size();
+    };
+}
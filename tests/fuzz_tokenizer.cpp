@@ -0,0 +1,95 @@
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <string_view>
+
+#include <source_buffer.hpp>
+#include <tokenizer.hpp>
+
+//libFuzzer target. Besides crashes and hangs it flags any input that takes more than linear time to tokenize.
+//The input is repeated until it is large enough for a superlinear tokenizer to stand out, repeating it also deepens
+//the patterns that are the most likely to be superlinear. Eg: `/* /*`, `((((]]` or `1....`
+//The repeated input is timed, then timed again repeated 16 times more. A linear tokenizer takes 16 times as long, 
+//a quadratic one 256 times, so only how the time grows is compared and not how fast the machine is.
+//Run it with the seeds in tests/fuzz_corpus: lcl_fuzz_tokenizer tests/fuzz_corpus
+
+static constexpr auto min_amplified_size = std::size_t { 1 << 14 };
+static constexpr auto size_ratio         = std::size_t { 16 };
+
+//The larger code and its tokens no longer fit in the caches, which makes even a linear tokenizer up to a few times slower per byte.
+//Half the growth of a quadratic tokenizer leaves room for that on both sides.
+static constexpr auto max_time_ratio = static_cast<double>(size_ratio * size_ratio) / 2.0;
+
+using collect_errors_policy = lcl::tokenizer_policy<true, true, true, true>;
+
+[[nodiscard]] static auto nanoseconds_to_tokenize(const lcl::source_buffer& buffer) -> double
+{
+    //The fastest of a few runs, so a single slow run caused by the machine is not reported
+    auto fastest = std::chrono::nanoseconds::max();
+
+    for (auto i = 0; i < 3; ++i)
+    {
+        const auto begin = std::chrono::steady_clock::now();
+
+        const auto result   = lcl::tokenize_code<collect_errors_policy>(buffer);
+        const auto brackets = lcl::tokenize_code_with_bracket_pairs(buffer);
+
+        const auto end = std::chrono::steady_clock::now();
+
+        //Keep the results alive so tokenizing is not optimized away
+        if (result.tokens.size() + result.errors.size() + (brackets ? 1 : 0) == SIZE_MAX)
+        {
+            std::abort();
+        }
+
+        fastest = std::min(fastest, std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin));
+    }
+
+    return static_cast<double>(fastest.count());
+}
+
+extern "C" auto LLVMFuzzerTestOneInput(const std::uint8_t* data, const std::size_t size) -> int
+{
+    if (size == 0)
+    {
+        return 0;
+    }
+
+    const auto input = std::string_view { reinterpret_cast<const char*>(data), size };
+
+    //Every error is collected, so the whole input is always tokenized
+    static_cast<void>(lcl::tokenize_code<collect_errors_policy>(lcl::source_buffer { input }));
+
+    auto amplified_code = std::string{};
+
+    while (amplified_code.size() < min_amplified_size)
+    {
+        amplified_code += input;
+    }
+
+    auto larger_code = std::string{};
+
+    for (auto i = std::size_t { 0 }; i < size_ratio; ++i)
+    {
+        larger_code += amplified_code;
+    }
+
+    const auto amplified_nanoseconds = nanoseconds_to_tokenize(lcl::source_buffer { amplified_code });
+    const auto larger_nanoseconds    = nanoseconds_to_tokenize(lcl::source_buffer { larger_code });
+
+    //At least a nanosecond, so a run too fast to time does not divide by zero
+    const auto time_ratio = larger_nanoseconds / std::max(amplified_nanoseconds, 1.0);
+
+    if (time_ratio > max_time_ratio)
+    {
+        std::fprintf(stderr, "Superlinear tokenization: %zu bytes took %.0fns, %zu bytes took %.0fns, %.1f times as long\n", 
+                     amplified_code.size(), amplified_nanoseconds, larger_code.size(), larger_nanoseconds, time_ratio);
+        std::abort();
+    }
+
+    return 0;
+}
@@ -0,0 +1,123 @@
+#define CATCH_CONFIG_MAIN
+#include <catch2/catch.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <vector>
+
+#include <ast.hpp>
+#include <memory.hpp>
+#include <source_buffer.hpp>
+#include <tokenizer.hpp>
+
+//import Print: print, printf;
+//import Math: *;
+static auto build_import_ast(lcl::ast& ast) -> void
+{
+    const auto global_scope = ast.open_node(lcl::ast_node_kind::global_scope, 0);
+    {
+        const auto print_import = ast.open_node(lcl::ast_node_kind::import_statement, 0);
+        ast.add_node(lcl::ast_node_kind::imported_module, 1);
+        ast.add_node(lcl::ast_node_kind::imported_name, 3);
+        ast.add_node(lcl::ast_node_kind::imported_name, 5);
+        ast.close_node(print_import);
+
+        const auto math_import = ast.open_node(lcl::ast_node_kind::import_statement, 7);
+        ast.add_node(lcl::ast_node_kind::imported_module, 8);
+        ast.add_node(lcl::ast_node_kind::import_everything, 10);
+        ast.close_node(math_import);
+    }
+    ast.close_node(global_scope);
+}
+
+TEST_CASE("Flat AST", "[ast]")
+{
+    static_assert(lcl::ast::bytes_per_node <= 16);
+
+    const auto buffer = lcl::source_buffer { "import Print: print, printf;\nimport Math: *;\n" };
+    const auto tokens = lcl::tokenize_code(buffer).value();
+
+    auto arena = lcl::memory::contiguous_virtual_memory_arena { 16 };
+    auto ast   = lcl::ast { tokens, tokens.size() + 1, arena };
+    build_import_ast(ast);
+
+    REQUIRE(ast.size() == 8);
+
+    SECTION("Nodes are in pre-order with the size of their subtree")
+    {
+        const auto expected_kinds         = std::vector<lcl::ast_node_kind> { lcl::ast_node_kind::global_scope, lcl::ast_node_kind::import_statement, lcl::ast_node_kind::imported_module, lcl::ast_node_kind::imported_name,
+                                                                              lcl::ast_node_kind::imported_name, lcl::ast_node_kind::import_statement, lcl::ast_node_kind::imported_module, lcl::ast_node_kind::import_everything };
+        const auto expected_subtree_sizes = std::vector<std::uint32_t> { 8, 4, 1, 1, 1, 3, 1, 1 };
+
+        for (auto i = lcl::ast_index { 0 }; i < ast.size(); ++i)
+        {
+            REQUIRE(ast.kind(i) == expected_kinds[i]);
+            REQUIRE(ast.subtree_size(i) == expected_subtree_sizes[i]);
+        }
+    }
+
+    SECTION("Children skip the subtrees of their siblings")
+    {
+        auto imports = std::vector<lcl::ast_index>{};
+
+        for (const auto child : ast.children(0))
+        {
+            imports.push_back(child);
+        }
+
+        REQUIRE(imports == std::vector<lcl::ast_index> { 1, 5 });
+
+        auto imported_names = std::vector<std::string_view>{};
+
+        for (const auto child : ast.children(imports[0]))
+        {
+            imported_names.push_back(ast.first_token(child).code);
+        }
+
+        REQUIRE(imported_names == std::vector<std::string_view> { "Print", "print", "printf" });
+        REQUIRE(ast.first_token(imports[1]).code == "import");
+        REQUIRE(ast.children(2).empty());
+    }
+
+    SECTION("A pass is a scan of the kinds")
+    {
+        auto imported_modules = std::vector<std::string_view>{};
+        const auto kinds      = ast.kinds();
+
+        for (auto i = lcl::ast_index { 0 }; i < kinds.size(); ++i)
+        {
+            if (kinds[i] == lcl::ast_node_kind::imported_module)
+            {
+                imported_modules.push_back(ast.first_token(i).code);
+            }
+        }
+
+        REQUIRE(imported_modules == std::vector<std::string_view> { "Print", "Math" });
+    }
+
+    SECTION("Backtracking removes the nodes")
+    {
+        ast.truncate(5);
+        ast.close_node(0);
+
+        REQUIRE(ast.size() == 5);
+        REQUIRE(ast.subtree_size(0) == 5);
+    }
+
+    SECTION("The nodes are in the arena")
+    {
+        const auto kinds = ast.kinds();
+
+        REQUIRE(reinterpret_cast<const std::byte*>(kinds.data()) >= arena.base_pointer());
+        REQUIRE(arena.used_bytes() >= (tokens.size() + 1) * lcl::ast::bytes_per_node);
+
+        //The arrays don't grow
+        while (ast.size() < tokens.size() + 1)
+        {
+            ast.add_node(lcl::ast_node_kind::identifier, 0);
+        }
+
+        REQUIRE_THROWS_AS(ast.add_node(lcl::ast_node_kind::identifier, 0), std::bad_alloc);
+    }
+}
@@ -0,0 +1,321 @@
+#define CATCH_CONFIG_MAIN
+#include <catch2/catch.hpp>
+
+#include <cstddef>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include <flat_hash_map.hpp>
+#include <memory.hpp>
+#include <small_vector.hpp>
+
+using namespace std::string_view_literals;
+
+//Its move can throw, so a small_vector copies it when it grows, and the copies throw once `copies_left` runs out
+struct throwing_copy
+{
+    static inline int copies_left = 1000;
+
+    int value = 0;
+
+    explicit throwing_copy(const int value) : value(value)
+    {
+        //Empty
+    }
+
+    throwing_copy(const throwing_copy& other) : value(other.value)
+    {
+        if (copies_left-- == 0)
+        {
+            throw std::runtime_error("Copy failed");
+        }
+    }
+
+    throwing_copy(throwing_copy&& other) noexcept(false) : throwing_copy(static_cast<const throwing_copy&>(other))
+    {
+        //Empty
+    }
+};
+
+TEST_CASE("Small vector", "[containers]")
+{
+    SECTION("Elements stay inline until the inline capacity is exceeded")
+    {
+        auto values = lcl::small_vector<int, 4>{};
+        REQUIRE(values.empty());
+        REQUIRE(values.capacity() == 4);
+
+        for (auto i = 0; i < 4; ++i)
+        {
+            values.push_back(i);
+        }
+
+        REQUIRE(values.is_inline());
+
+        values.push_back(4);
+        REQUIRE_FALSE(values.is_inline());
+        REQUIRE(values.size() == 5);
+        REQUIRE(values.capacity() >= 5);
+
+        for (auto i = 0; i < 5; ++i)
+        {
+            REQUIRE(values[static_cast<std::size_t>(i)] == i);
+        }
+
+        values.pop_back();
+        values.shrink_to_fit();
+        REQUIRE(values.is_inline());
+        REQUIRE(values == lcl::small_vector<int, 4> { 0, 1, 2, 3 });
+    }
+
+    SECTION("Elements with owned memory are moved and destroyed")
+    {
+        auto values = lcl::small_vector<std::string, 2>{};
+
+        for (auto i = 0; i < 10; ++i)
+        {
+            values.emplace_back(64, static_cast<char>('a' + i));
+        }
+
+        auto copy = values;
+        REQUIRE(copy == values);
+
+        auto moved = std::move(values);
+        REQUIRE(values.empty());
+        REQUIRE(moved == copy);
+        REQUIRE(moved.back() == std::string(64, 'j'));
+
+        auto inline_values = lcl::small_vector<std::string, 2> { "hello", "sailor" };
+        moved = std::move(inline_values);
+        REQUIRE(moved.is_inline());
+        REQUIRE(moved == lcl::small_vector<std::string, 2> { "hello", "sailor" });
+
+        moved.resize(5);
+        REQUIRE(moved.size() == 5);
+        REQUIRE(moved[4].empty());
+    }
+
+    SECTION("Pushing one of its own elements while full")
+    {
+        auto values = lcl::small_vector<std::string, 2> { std::string(40, 'a'), std::string(40, 'b') };
+
+        values.push_back(values[0]);
+        values.push_back(values[1]);
+        values.emplace_back(values[2]);
+
+        REQUIRE(values.size() == 5);
+        REQUIRE(values[2] == std::string(40, 'a'));
+        REQUIRE(values[3] == std::string(40, 'b'));
+        REQUIRE(values[4] == std::string(40, 'a'));
+    }
+
+    SECTION("A copy that throws while growing leaves the vector as it was")
+    {
+        auto values = lcl::small_vector<throwing_copy, 2>{};
+
+        values.emplace_back(1);
+        values.emplace_back(2);
+
+        throwing_copy::copies_left = 1;
+        REQUIRE_THROWS_AS(values.emplace_back(3), std::runtime_error);
+
+        REQUIRE(values.is_inline());
+        REQUIRE(values.size() == 2);
+        REQUIRE(values[0].value == 1);
+        REQUIRE(values[1].value == 2);
+
+        throwing_copy::copies_left = 2;
+        values.emplace_back(3);
+        REQUIRE(values.size() == 3);
+        REQUIRE(values[2].value == 3);
+    }
+
+    SECTION("Heap storage comes from the arena")
+    {
+        auto arena  = lcl::memory::contiguous_virtual_memory_arena { 16 };
+        auto values = lcl::small_vector<int, 4, lcl::memory::virtual_arena_allocator<int>> { lcl::memory::virtual_arena_allocator<int> { arena } };
+
+        for (auto i = 0; i < 4; ++i)
+        {
+            values.push_back(i);
+        }
+
+        REQUIRE(arena.used_bytes() == 0);
+
+        values.push_back(4);
+        REQUIRE(arena.used_bytes() >= 8 * sizeof(int));
+
+        const auto base    = reinterpret_cast<const std::byte*>(arena.base_pointer());
+        const auto element = reinterpret_cast<const std::byte*>(values.data());
+        REQUIRE(element >= base);
+        REQUIRE(element < base + arena.used_bytes());
+    }
+}
+
+TEST_CASE("Flat hash map", "[containers]")
+{
+    SECTION("An empty map finds nothing")
+    {
+        const auto map = lcl::flat_hash_map<std::string_view, int>{};
+
+        REQUIRE(map.empty());
+        REQUIRE(map.capacity() == 0);
+        REQUIRE(map.find("hello") == map.end());
+        REQUIRE(map.begin() == map.end());
+    }
+
+    SECTION("Inserting, finding and erasing")
+    {
+        auto map = lcl::flat_hash_map<std::string_view, int>{};
+
+        REQUIRE(map.try_emplace("hello", 1).second);
+        REQUIRE(map.try_emplace("sailor", 2).second);
+        REQUIRE_FALSE(map.try_emplace("hello", 3).second);
+
+        REQUIRE(map.size() == 2);
+        REQUIRE(map.find("hello")->second == 1);
+        REQUIRE(map["sailor"] == 2);
+        REQUIRE_FALSE(map.contains("world"));
+
+        map["world"] = 3;
+        REQUIRE(map.size() == 3);
+        REQUIRE(map.insert_or_assign("world", 4).second == false);
+        REQUIRE(map.find("world")->second == 4);
+
+        REQUIRE(map.erase("hello") == 1);
+        REQUIRE(map.erase("hello") == 0);
+        REQUIRE(map.size() == 2);
+        REQUIRE(map.find("hello") == map.end());
+        REQUIRE(map.find("sailor")->second == 2);
+
+        //The erased slot is reused
+        REQUIRE(map.try_emplace("hello", 5).second);
+        REQUIRE(map.find("hello")->second == 5);
+    }
+
+    SECTION("Agrees with std::unordered_map through growth and erasure")
+    {
+        auto names    = std::vector<std::string>{};
+        auto map      = lcl::flat_hash_map<std::string_view, std::size_t>{};
+        auto expected = std::unordered_map<std::string_view, std::size_t>{};
+
+        for (auto i = std::size_t { 0 }; i < 20000; ++i)
+        {
+            names.push_back("identifier_" + std::to_string(i));
+        }
+
+        for (auto i = std::size_t { 0 }; i < names.size(); ++i)
+        {
+            map[names[i]]      = i;
+            expected[names[i]] = i;
+
+            //Erases every third one, leaving tombstones all over the table
+            if (i % 3 == 0)
+            {
+                REQUIRE(map.erase(names[i / 2]) == expected.erase(names[i / 2]));
+            }
+        }
+
+        REQUIRE(map.size() == expected.size());
+        REQUIRE(map.load_factor() <= 0.875f);
+
+        for (const auto& name : names)
+        {
+            const auto found = map.find(name);
+            const auto expected_found = expected.find(name);
+
+            REQUIRE((found == map.end()) == (expected_found == std::cend(expected)));
+
+            if (found != map.end())
+            {
+                REQUIRE(found->second == expected_found->second);
+            }
+        }
+
+        auto iterated_count = std::size_t { 0 };
+
+        for (const auto& [name, value] : map)
+        {
+            REQUIRE(expected.at(name) == value);
+            ++iterated_count;
+        }
+
+        REQUIRE(iterated_count == expected.size());
+
+        map.clear();
+        REQUIRE(map.empty());
+        REQUIRE(map.find(names.front()) == map.end());
+    }
+
+    SECTION("Integer keys with a poor hash")
+    {
+        auto map = lcl::flat_hash_map<std::size_t, std::size_t>{};
+
+        //Multiples of a large power of two only differ in the high bits
+        for (auto i = std::size_t { 0 }; i < 1000; ++i)
+        {
+            map[i << 20] = i;
+        }
+
+        REQUIRE(map.size() == 1000);
+
+        for (auto i = std::size_t { 0 }; i < 1000; ++i)
+        {
+            REQUIRE(map.find(i << 20)->second == i);
+        }
+    }
+
+    SECTION("Copies and moves")
+    {
+        auto map = lcl::flat_hash_map<std::string, std::string>{};
+
+        for (auto i = 0; i < 100; ++i)
+        {
+            map[std::to_string(i)] = std::string(32, 'x');
+        }
+
+        auto copy = map;
+        REQUIRE(copy.size() == 100);
+        REQUIRE(copy.find("42")->second == std::string(32, 'x'));
+
+        auto moved = std::move(map);
+        REQUIRE(map.empty());
+        REQUIRE(map.find("42") == map.end());
+        REQUIRE(moved.size() == 100);
+
+        map = copy;
+        REQUIRE(map.size() == 100);
+        REQUIRE(map.contains("99"));
+    }
+
+    SECTION("The table comes from the arena")
+    {
+        using allocator = lcl::memory::virtual_arena_allocator<std::pair<const std::string_view, int>>;
+
+        auto arena = lcl::memory::contiguous_virtual_memory_arena { 1024 };
+        auto map   = lcl::flat_hash_map<std::string_view, int, std::hash<std::string_view>, std::equal_to<std::string_view>, allocator> { 1000, allocator { arena } };
+
+        const auto used_bytes = arena.used_bytes();
+        REQUIRE(used_bytes >= map.capacity() * sizeof(std::pair<const std::string_view, int>));
+
+        auto names = std::vector<std::string>{};
+
+        for (auto i = 0; i < 1000; ++i)
+        {
+            names.push_back("name_" + std::to_string(i));
+        }
+
+        for (auto i = 0; i < 1000; ++i)
+        {
+            map[names[static_cast<std::size_t>(i)]] = i;
+        }
+
+        //Reserved up front, so inserting never grew the table
+        REQUIRE(arena.used_bytes() == used_bytes);
+        REQUIRE(map.find("name_999")->second == 999);
+    }
+}
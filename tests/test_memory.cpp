@@ -0,0 +1,873 @@
+#define CATCH_CONFIG_MAIN
+#include <catch2/catch.hpp>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <list>
+#include <memory>
+#include <new>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include <arena_registry.hpp>
+#include <memory.hpp>
+#include <size_class_pool.hpp>
+#include <tokenizer.hpp>
+#include <virtual_vector.hpp>
+
+#if defined(__linux__)
+
+//Bytes of memory the process is using right now
+static auto resident_set_size() -> std::size_t
+{
+    auto statm          = std::ifstream { "/proc/self/statm" };
+    auto total_pages    = std::size_t { 0 };
+    auto resident_pages = std::size_t { 0 };
+
+    statm >> total_pages >> resident_pages;
+
+    return resident_pages * lcl::memory::get_page_size();
+}
+
+TEST_CASE("Memory pages and resident set size", "[memory]")
+{
+    const auto page_size  = lcl::memory::get_page_size();
+    const auto page_count = std::size_t { 64 * 1024 * 1024 } / page_size;
+    const auto byte_count = page_count * page_size;
+
+    //Other allocations made by the test can move the resident set size a bit
+    const auto tolerance = std::size_t { 4 * 1024 * 1024 };
+
+    const auto rss_before_reserving = resident_set_size();
+
+    //Much more than what is committed, reserving costs no memory
+    const auto reserved_page_count = page_count * 64;
+    const auto pages               = lcl::memory::reserve_memory_pages(reserved_page_count);
+    REQUIRE(pages != nullptr);
+    REQUIRE(resident_set_size() < rss_before_reserving + tolerance);
+
+    lcl::memory::commit_memory_pages(pages, page_count);
+
+    SECTION("Committed pages only use memory once they are touched")
+    {
+        REQUIRE(resident_set_size() < rss_before_reserving + tolerance);
+
+        std::memset(pages, 1, byte_count);
+        REQUIRE(resident_set_size() > rss_before_reserving + byte_count - tolerance);
+    }
+
+    SECTION("Decommitted pages give their memory back")
+    {
+        std::memset(pages, 1, byte_count);
+        lcl::memory::decommit_memory_pages(pages, page_count);
+        REQUIRE(resident_set_size() < rss_before_reserving + tolerance);
+
+        lcl::memory::commit_memory_pages(pages, page_count);
+        REQUIRE(pages[0] == std::byte { 0 });
+        REQUIRE(pages[byte_count - 1] == std::byte { 0 });
+    }
+
+    SECTION("Part of the pages")
+    {
+        std::memset(pages, 1, byte_count);
+        lcl::memory::decommit_memory_pages(pages + byte_count / 2, page_count / 2);
+
+        const auto rss = resident_set_size();
+        REQUIRE(rss > rss_before_reserving + byte_count / 2 - tolerance);
+        REQUIRE(rss < rss_before_reserving + byte_count / 2 + tolerance);
+        REQUIRE(pages[0] == std::byte { 1 });
+    }
+
+    lcl::memory::unreserve_memory_pages(pages, reserved_page_count);
+    REQUIRE(resident_set_size() < rss_before_reserving + tolerance);
+}
+
+#endif
+
+TEST_CASE("Contiguous virtual memory arena", "[memory]")
+{
+    auto arena = lcl::memory::contiguous_virtual_memory_arena { 1024 };
+
+    REQUIRE(arena.base_pointer() != nullptr);
+    REQUIRE(arena.reserved_pages() == 1024);
+    REQUIRE(arena.reserved_bytes() == 1024 * lcl::memory::get_page_size());
+    REQUIRE(arena.committed_pages() == 0);
+
+    arena.commit_memory(2);
+    arena.commit_memory(3);
+    REQUIRE(arena.committed_pages() == 5);
+    REQUIRE(arena.committed_bytes() == 5 * lcl::memory::get_page_size());
+
+    //Every committed byte can be allocated without committing more
+    const auto allocation = arena.allocate(arena.committed_bytes());
+    std::memset(allocation, 1, arena.committed_bytes());
+    REQUIRE(allocation[arena.committed_bytes() - 1] == std::byte { 1 });
+    REQUIRE(arena.committed_pages() == 5);
+}
+
+TEST_CASE("Contiguous virtual memory arena allocation", "[memory]")
+{
+    const auto page_size = lcl::memory::get_page_size();
+
+    auto arena = lcl::memory::contiguous_virtual_memory_arena { 64 * 1024 };
+
+    SECTION("Allocations are aligned and don't overlap")
+    {
+        const auto a = arena.allocate(1, 1);
+        const auto b = arena.allocate(8, 8);
+        const auto c = arena.allocate(3, 64);
+        const auto d = arena.allocate(16);
+
+        REQUIRE(a == arena.base_pointer());
+        REQUIRE(b == arena.base_pointer() + 8);
+        REQUIRE(c == arena.base_pointer() + 64);
+        REQUIRE(reinterpret_cast<std::uintptr_t>(d) % alignof(std::max_align_t) == 0);
+        REQUIRE(d >= c + 3);
+        REQUIRE(arena.used_bytes() == static_cast<std::size_t>(d + 16 - arena.base_pointer()));
+
+        std::memset(a, 1, 1);
+        std::memset(b, 2, 8);
+        std::memset(c, 3, 3);
+        std::memset(d, 4, 16);
+        REQUIRE(a[0] == std::byte { 1 });
+        REQUIRE(c[2] == std::byte { 3 });
+    }
+
+    SECTION("Alignments bigger than a page")
+    {
+        auto small_arena = lcl::memory::contiguous_virtual_memory_arena { 32 };
+
+        static_cast<void>(small_arena.allocate(1, 1));
+        const auto aligned = small_arena.allocate(10, 64 * 1024);
+        REQUIRE(reinterpret_cast<std::uintptr_t>(aligned) % (64 * 1024) == 0);
+
+        std::memset(aligned, 1, 10);
+        REQUIRE(aligned[9] == std::byte { 1 });
+    }
+
+    SECTION("Pages are committed in geometrically growing batches")
+    {
+        REQUIRE(arena.committed_pages() == 0);
+
+        static_cast<void>(arena.allocate(1));
+        REQUIRE(arena.committed_pages() == lcl::memory::contiguous_virtual_memory_arena::minimum_pages_to_commit);
+
+        auto commit_count         = 1;
+        auto last_committed_pages = arena.committed_pages();
+
+        while (arena.used_bytes() < 16 * 1024 * page_size)
+        {
+            std::memset(arena.allocate(page_size / 2), 1, page_size / 2);
+
+            if (arena.committed_pages() != last_committed_pages)
+            {
+                REQUIRE(arena.committed_pages() >= 2 * last_committed_pages);
+                last_committed_pages = arena.committed_pages();
+                ++commit_count;
+            }
+        }
+
+        REQUIRE(commit_count <= 12);
+    }
+
+    SECTION("Allocation bigger than the growth")
+    {
+        const auto big = arena.allocate(1000 * page_size);
+        std::memset(big, 1, 1000 * page_size);
+        REQUIRE(arena.committed_pages() >= 1000);
+    }
+
+    SECTION("Running out of reserved pages")
+    {
+        REQUIRE_THROWS_AS(arena.allocate(arena.reserved_bytes() + 1), std::bad_alloc);
+
+        static_cast<void>(arena.allocate(arena.reserved_bytes()));
+        REQUIRE(arena.committed_pages() == arena.reserved_pages());
+        REQUIRE_THROWS_AS(arena.allocate(1, 1), std::bad_alloc);
+    }
+
+    SECTION("Transparent huge pages")
+    {
+        auto huge_arena = lcl::memory::contiguous_virtual_memory_arena { 64 * 1024, lcl::memory::page_backing::transparent_huge_pages };
+        REQUIRE(huge_arena.backing() == lcl::memory::page_backing::transparent_huge_pages);
+        REQUIRE(reinterpret_cast<std::uintptr_t>(huge_arena.base_pointer()) % lcl::memory::huge_page_size == 0);
+        REQUIRE(huge_arena.reserved_pages() == 64 * 1024);
+
+        std::memset(huge_arena.allocate(1), 1, 1);
+        REQUIRE(huge_arena.committed_bytes() >= lcl::memory::huge_page_size);
+
+        //Only whole huge pages are committed
+        while (huge_arena.used_bytes() < 32 * lcl::memory::huge_page_size)
+        {
+            static_cast<void>(huge_arena.allocate(1000 * page_size + 1));
+            REQUIRE(huge_arena.committed_bytes() % lcl::memory::huge_page_size == 0);
+        }
+    }
+}
+
+TEST_CASE("Virtual arena allocator", "[memory]")
+{
+    auto arena       = lcl::memory::contiguous_virtual_memory_arena { 16 * 1024 };
+    auto other_arena = lcl::memory::contiguous_virtual_memory_arena { 16 };
+
+    const auto is_in_arena = [&] (const void* it)
+    {
+        return it >= arena.base_pointer() && it < arena.base_pointer() + arena.used_bytes();
+    };
+
+    SECTION("Vector of tokens")
+    {
+        auto tokens = std::vector<lcl::token, lcl::memory::virtual_arena_allocator<lcl::token>> { lcl::memory::virtual_arena_allocator<lcl::token> { arena } };
+
+        for (auto i = 0; i < 1000; ++i)
+        {
+            tokens.emplace_back(lcl::token_type::word, "a");
+        }
+
+        REQUIRE(tokens.size() == 1000);
+        REQUIRE(tokens[999].code == "a");
+        REQUIRE(is_in_arena(tokens.data()));
+        REQUIRE(is_in_arena(&tokens.back()));
+
+        //Moving takes the elements and the arena
+        auto moved_tokens = std::move(tokens);
+        REQUIRE(moved_tokens.get_allocator() == lcl::memory::virtual_arena_allocator<lcl::token> { arena });
+        REQUIRE(moved_tokens.size() == 1000);
+    }
+
+    SECTION("Node based container")
+    {
+        //The list rebinds the allocator to its nodes
+        auto list = std::list<int, lcl::memory::virtual_arena_allocator<int>> { lcl::memory::virtual_arena_allocator<int> { arena } };
+
+        list.push_back(1);
+        list.push_back(2);
+        list.pop_front();
+
+        REQUIRE(list.front() == 2);
+        REQUIRE(is_in_arena(&list.front()));
+    }
+
+    SECTION("Equality")
+    {
+        const auto a = lcl::memory::virtual_arena_allocator<int> { arena };
+        const auto b = lcl::memory::virtual_arena_allocator<double> { arena };
+        const auto c = lcl::memory::virtual_arena_allocator<int> { other_arena };
+
+        REQUIRE(a == b);
+        REQUIRE(a == lcl::memory::virtual_arena_allocator<int> { b });
+        REQUIRE(a != c);
+        REQUIRE(!(a != b));
+    }
+
+    SECTION("Deallocating does nothing")
+    {
+        auto allocator = lcl::memory::virtual_arena_allocator<std::uint64_t> { arena };
+
+        const auto first = allocator.allocate(3);
+        REQUIRE(reinterpret_cast<std::uintptr_t>(first) % alignof(std::uint64_t) == 0);
+
+        const auto used_bytes = arena.used_bytes();
+        allocator.deallocate(first, 3);
+        REQUIRE(arena.used_bytes() == used_bytes);
+
+        REQUIRE_THROWS_AS(allocator.allocate(allocator.max_size() + 1), std::bad_alloc);
+    }
+}
+
+TEST_CASE("Virtual vector", "[memory]")
+{
+    using namespace std::string_view_literals;
+
+    auto tokens = lcl::memory::virtual_vector<lcl::token> { 10000000 };
+
+    REQUIRE(tokens.empty());
+    REQUIRE(tokens.capacity() == 0);
+    REQUIRE(tokens.max_size() == 10000000);
+
+    SECTION("Elements never move")
+    {
+        tokens.emplace_back(lcl::token_type::word, "first"sv);
+
+        const auto first_token = &tokens.front();
+        const auto first_code  = tokens.front().code;
+
+        for (auto i = 0; i < 1000000; ++i)
+        {
+            tokens.emplace_back(lcl::token_type::word, "a"sv);
+        }
+
+        REQUIRE(tokens.size() == 1000001);
+        REQUIRE(&tokens.front() == first_token);
+        REQUIRE(first_code == "first");
+        REQUIRE(tokens.back().code == "a");
+        REQUIRE(tokens.capacity() >= tokens.size());
+        REQUIRE(std::distance(std::cbegin(tokens), std::cend(tokens)) == 1000001);
+    }
+
+    SECTION("Popping and shrinking")
+    {
+        for (auto i = 0; i < 100000; ++i)
+        {
+            tokens.emplace_back(lcl::token_type::word, "a"sv);
+        }
+
+        const auto capacity = tokens.capacity();
+
+        while (tokens.size() > 10)
+        {
+            tokens.pop_back();
+        }
+
+        REQUIRE(tokens.capacity() == capacity);
+
+        tokens.shrink_to_fit();
+        REQUIRE(tokens.capacity() < capacity);
+        REQUIRE(tokens.capacity() >= 10);
+        REQUIRE(tokens[9].code == "a");
+
+        //The decommitted pages are committed again
+        for (auto i = 0; i < 100000; ++i)
+        {
+            tokens.emplace_back(lcl::token_type::word, "b"sv);
+        }
+
+        REQUIRE(tokens.back().code == "b");
+    }
+
+    SECTION("Elements are destroyed")
+    {
+        auto       pointers = lcl::memory::virtual_vector<std::shared_ptr<int>> { 16 };
+        const auto value    = std::make_shared<int>(1);
+
+        pointers.push_back(value);
+        pointers.push_back(value);
+        REQUIRE(value.use_count() == 3);
+
+        pointers.pop_back();
+        REQUIRE(value.use_count() == 2);
+
+        {
+            const auto moved_pointers = std::move(pointers);
+            REQUIRE(moved_pointers.size() == 1);
+        }
+
+        REQUIRE(value.use_count() == 1);
+    }
+
+    SECTION("Growing past the maximum size")
+    {
+        auto small = lcl::memory::virtual_vector<int> { 3 };
+
+        small.push_back(1);
+        small.push_back(2);
+        small.push_back(3);
+        REQUIRE_THROWS_AS(small.push_back(4), std::bad_alloc);
+    }
+
+    SECTION("Maximum size too big for the address space")
+    {
+        REQUIRE_THROWS_AS(lcl::memory::virtual_vector<lcl::token> { SIZE_MAX / sizeof(lcl::token) + 2 }, std::bad_alloc);
+        REQUIRE_THROWS_AS(lcl::memory::virtual_vector<std::uint64_t> { SIZE_MAX / 4 }, std::bad_alloc);
+    }
+}
+
+TEST_CASE("Arena checkpoints", "[memory]")
+{
+    const auto page_size = lcl::memory::get_page_size();
+
+    auto arena = lcl::memory::contiguous_virtual_memory_arena { 64 * 1024 };
+
+    static_cast<void>(arena.allocate(100));
+
+    SECTION("Rolling back frees what was allocated after the checkpoint")
+    {
+        const auto mark  = arena.checkpoint();
+        const auto first = arena.allocate(1000);
+        static_cast<void>(arena.allocate(1000));
+
+        arena.rollback(mark);
+        REQUIRE(arena.used_bytes() == mark.used_bytes);
+        REQUIRE(arena.allocate(1000) == first);
+    }
+
+    SECTION("Scoped marker")
+    {
+        const auto used_bytes = arena.used_bytes();
+
+        {
+            const auto marker = lcl::memory::scoped_arena_marker { arena };
+            REQUIRE(marker.mark().used_bytes == used_bytes);
+
+            std::memset(arena.allocate(10 * page_size), 1, 10 * page_size);
+            const auto used_bytes_before_inner_marker = arena.used_bytes();
+
+            {
+                const auto inner_marker = lcl::memory::scoped_arena_marker { arena };
+                static_cast<void>(arena.allocate(1));
+            }
+
+            REQUIRE(arena.used_bytes() == used_bytes_before_inner_marker);
+        }
+
+        REQUIRE(arena.used_bytes() == used_bytes);
+    }
+
+    SECTION("Without a high water mark nothing is decommitted")
+    {
+        const auto mark = arena.checkpoint();
+        static_cast<void>(arena.allocate(1000 * page_size));
+        const auto committed_pages = arena.committed_pages();
+
+        arena.rollback(mark);
+        REQUIRE(arena.committed_pages() == committed_pages);
+    }
+
+    SECTION("Pages above the high water mark are decommitted")
+    {
+        arena.set_high_water_mark(100 * page_size);
+
+        const auto mark = arena.checkpoint();
+        std::memset(arena.allocate(1000 * page_size), 1, 1000 * page_size);
+        REQUIRE(arena.committed_pages() >= 1000);
+
+        arena.rollback(mark);
+        REQUIRE(arena.committed_pages() == 100);
+
+        //The decommitted pages are committed again and read as zeros
+        const auto allocation = arena.allocate(1000 * page_size);
+        REQUIRE(allocation[999 * page_size] == std::byte { 0 });
+        std::memset(allocation, 1, 1000 * page_size);
+    }
+}
+
+TEST_CASE("Arena registry", "[memory]")
+{
+    const auto page_size = lcl::memory::get_page_size();
+
+    auto registry = lcl::memory::arena_registry { 16 * 1024, lcl::memory::page_backing::regular, 64 * page_size };
+
+    SECTION("Each worker allocates from its own arena")
+    {
+        constexpr auto worker_count = 4;
+
+        auto leases  = std::vector<lcl::memory::arena_lease>{};
+        auto workers = std::vector<std::thread>{};
+
+        for (auto i = 0; i < worker_count; ++i)
+        {
+            leases.push_back(registry.acquire());
+        }
+
+        for (auto i = 0; i < worker_count; ++i)
+        {
+            workers.emplace_back([&lease = leases[static_cast<std::size_t>(i)], i]
+            {
+                const auto scope = lcl::memory::thread_arena_scope { lease.arena() };
+
+                for (auto j = 0; j < 10000; ++j)
+                {
+                    *lcl::memory::thread_arena().allocate(1, 1) = static_cast<std::byte>(i);
+                }
+            });
+        }
+
+        for (auto& worker : workers)
+        {
+            worker.join();
+        }
+
+        REQUIRE(registry.arena_count() == worker_count);
+
+        for (auto i = 0; i < worker_count; ++i)
+        {
+            const auto& arena = leases[static_cast<std::size_t>(i)].arena();
+
+            REQUIRE(arena.used_bytes() == 10000);
+            REQUIRE(arena.base_pointer()[9999] == static_cast<std::byte>(i));
+        }
+
+        REQUIRE(lcl::memory::current_thread_arena == nullptr);
+    }
+
+    SECTION("Arenas are freed in bulk and reused")
+    {
+        auto  lease = registry.acquire();
+        auto& arena = lease.arena();
+
+        std::memset(arena.allocate(1000 * page_size), 1, 1000 * page_size);
+
+        lease.release();
+        REQUIRE(registry.free_arena_count() == 1);
+        REQUIRE(arena.used_bytes() == 0);
+        REQUIRE(arena.committed_pages() == 64);
+
+        const auto reused_lease = registry.acquire();
+        REQUIRE(&reused_lease.arena() == &arena);
+        REQUIRE(registry.arena_count() == 1);
+        REQUIRE(registry.free_arena_count() == 0);
+    }
+
+    SECTION("Handing a lease off to another thread")
+    {
+        auto lease = registry.acquire();
+        static_cast<void>(lease.arena().allocate(10));
+
+        auto worker = std::thread { [handed_off_lease = std::move(lease)]
+        {
+            static_cast<void>(handed_off_lease.arena().allocate(10));
+        } };
+
+        worker.join();
+        REQUIRE(registry.free_arena_count() == 1);
+    }
+
+    SECTION("Moving a lease into itself keeps the arena")
+    {
+        auto       lease      = registry.acquire();
+        auto&      same_lease = lease;
+        const auto arena      = &lease.arena();
+
+        lease = std::move(same_lease);
+
+        REQUIRE(&lease.arena() == arena);
+        REQUIRE(registry.free_arena_count() == 0);
+    }
+
+    SECTION("Nested thread arena scopes")
+    {
+        const auto first_lease  = registry.acquire();
+        const auto second_lease = registry.acquire();
+
+        const auto first_scope = lcl::memory::thread_arena_scope { first_lease.arena() };
+
+        {
+            const auto second_scope = lcl::memory::thread_arena_scope { second_lease.arena() };
+            REQUIRE(&lcl::memory::thread_arena() == &second_lease.arena());
+        }
+
+        REQUIRE(&lcl::memory::thread_arena() == &first_lease.arena());
+    }
+}
+
+TEST_CASE("Size class pool", "[memory]")
+{
+    auto arena = lcl::memory::contiguous_virtual_memory_arena { 16 * 1024 };
+    auto pool  = lcl::memory::size_class_pool { arena };
+
+    const auto stats_of = [&] (const std::size_t slot_size) -> const lcl::memory::size_class_stats&
+    {
+        const auto class_index = std::find(std::cbegin(lcl::memory::size_classes), std::cend(lcl::memory::size_classes), slot_size) - std::cbegin(lcl::memory::size_classes);
+        return pool.stats()[static_cast<std::size_t>(class_index)];
+    };
+
+    SECTION("Freed slots are reused")
+    {
+        const auto a = pool.allocate(20);
+        const auto b = pool.allocate(24);
+        REQUIRE(a != b);
+
+        pool.deallocate(a, 20);
+        REQUIRE(pool.allocate(17) == a);
+
+        pool.deallocate(b, 24);
+        pool.deallocate(a, 17);
+
+        //Last freed, first reused
+        REQUIRE(pool.allocate(24) == a);
+        REQUIRE(pool.allocate(24) == b);
+    }
+
+    SECTION("Slots are aligned and don't overlap")
+    {
+        auto slots = std::vector<std::byte*>{};
+
+        for (auto i = 0; i < 1000; ++i)
+        {
+            slots.push_back(static_cast<std::byte*>(pool.allocate(48, 16)));
+            std::memset(slots.back(), i % 256, 48);
+        }
+
+        for (auto i = 0; i < 1000; ++i)
+        {
+            REQUIRE(reinterpret_cast<std::uintptr_t>(slots[static_cast<std::size_t>(i)]) % 16 == 0);
+            REQUIRE(slots[static_cast<std::size_t>(i)][47] == static_cast<std::byte>(i % 256));
+        }
+    }
+
+    SECTION("Objects")
+    {
+        struct node
+        {
+            std::uint32_t first_token;
+            std::uint32_t token_count;
+            node*         parent;
+        };
+
+        const auto parent = pool.make<node>(node { 0, 10, nullptr });
+        const auto child  = pool.make<node>(node { 2, 3, parent });
+        REQUIRE(child->parent->token_count == 10);
+
+        pool.destroy(child);
+        REQUIRE(pool.make<node>(node { 4, 1, parent }) == child);
+    }
+
+    SECTION("Statistics")
+    {
+        auto slots = std::vector<void*>{};
+
+        for (auto i = 0; i < 100; ++i)
+        {
+            slots.push_back(pool.allocate(30));
+        }
+
+        for (auto i = 0; i < 40; ++i)
+        {
+            pool.deallocate(slots[static_cast<std::size_t>(i)], 30);
+        }
+
+        static_cast<void>(pool.allocate(32));
+
+        const auto& stats = stats_of(32);
+        REQUIRE(stats.slot_size == 32);
+        REQUIRE(stats.allocation_count == 101);
+        REQUIRE(stats.deallocation_count == 40);
+        REQUIRE(stats.live_count == 61);
+        REQUIRE(stats.peak_live_count == 100);
+        REQUIRE(stats.slot_count == 2 * lcl::memory::size_class_pool::slots_per_refill);
+        REQUIRE(stats.requested_bytes == 100 * 30 + 32);
+
+        REQUIRE(stats_of(8).allocation_count == 0);
+    }
+
+    SECTION("Oversize allocations")
+    {
+        const auto big = pool.allocate(1000);
+        std::memset(big, 1, 1000);
+        pool.deallocate(big, 1000);
+
+        REQUIRE(pool.oversize_stats().allocation_count == 1);
+        REQUIRE(pool.oversize_stats().deallocation_count == 1);
+        REQUIRE(pool.oversize_stats().requested_bytes == 1000);
+    }
+}
+
+TEST_CASE("Arena reset", "[memory]")
+{
+    const auto page_size = lcl::memory::get_page_size();
+
+    auto arena = lcl::memory::contiguous_virtual_memory_arena { 64 * 1024 };
+
+    const auto run_request = [&] (const std::size_t page_count)
+    {
+        std::memset(arena.allocate(page_count * page_size), 1, page_count * page_size);
+        arena.reset();
+    };
+
+    SECTION("Resetting keeps the pages committed")
+    {
+        REQUIRE(arena.reset_policy().release == lcl::memory::page_release::decommit);
+
+        run_request(100);
+        REQUIRE(arena.used_bytes() == 0);
+        REQUIRE(arena.committed_pages() >= 100);
+
+        const auto first_allocation = arena.allocate(1);
+        REQUIRE(first_allocation == arena.base_pointer());
+    }
+
+    SECTION("Unused pages are decommitted after a while")
+    {
+        arena.set_reset_policy(lcl::memory::arena_reset_policy { 16 * page_size, 4, lcl::memory::page_release::decommit });
+
+        //One big request, then small ones
+        run_request(4000);
+        const auto committed_pages = arena.committed_pages();
+
+        run_request(200);
+        run_request(200);
+        REQUIRE(arena.committed_pages() == committed_pages);
+
+        //The big request is still in the window
+        run_request(200);
+        REQUIRE(arena.committed_pages() == 4000);
+
+        for (auto i = 0; i < 4; ++i)
+        {
+            run_request(200);
+        }
+
+        REQUIRE(arena.committed_pages() == 200);
+
+        //Never below the retained bytes
+        for (auto i = 0; i < 4; ++i)
+        {
+            arena.reset();
+        }
+
+        REQUIRE(arena.committed_pages() == 16);
+    }
+
+    SECTION("Steady requests don't give memory back")
+    {
+        arena.set_reset_policy(lcl::memory::arena_reset_policy { 0, 2, lcl::memory::page_release::decommit });
+
+        for (auto i = 0; i < 10; ++i)
+        {
+            run_request(500);
+        }
+
+        REQUIRE(arena.committed_pages() >= 500);
+    }
+
+    SECTION("Rolled back allocations count towards the peak")
+    {
+        arena.set_reset_policy(lcl::memory::arena_reset_policy { 0, 2, lcl::memory::page_release::decommit });
+
+        //Each request uses a lot of scratch memory it rolls back, then ends small
+        for (auto i = 0; i < 10; ++i)
+        {
+            const auto mark = arena.checkpoint();
+            std::memset(arena.allocate(1000 * page_size), 1, 1000 * page_size);
+            arena.rollback(mark);
+
+            static_cast<void>(arena.allocate(16));
+            arena.reset();
+
+            REQUIRE(arena.committed_pages() >= 1000);
+        }
+
+        REQUIRE(arena.telemetry().decommit_count == 0);
+        REQUIRE(arena.telemetry().commit_count == 1);
+    }
+
+    SECTION("Lazily freed pages stay committed and usable")
+    {
+        arena.set_reset_policy(lcl::memory::arena_reset_policy { 0, 1, lcl::memory::page_release::lazy_free });
+
+        run_request(1000);
+        const auto committed_pages = arena.committed_pages();
+        const auto telemetry       = arena.telemetry();
+
+        run_request(10);
+        REQUIRE(arena.committed_pages() == committed_pages);
+        REQUIRE(arena.telemetry().release_count == telemetry.release_count + 1);
+        REQUIRE(arena.telemetry().released_bytes == telemetry.released_bytes + (committed_pages - 10) * page_size);
+        REQUIRE(arena.telemetry().decommit_count == 0);
+
+        run_request(1000);
+        REQUIRE(arena.reset_policy().release == lcl::memory::page_release::lazy_free);
+    }
+
+    SECTION("Lazily freed pages are only counted once")
+    {
+        arena.set_reset_policy(lcl::memory::arena_reset_policy { 0, 1, lcl::memory::page_release::lazy_free });
+
+        run_request(1000);
+        const auto committed_pages = arena.committed_pages();
+
+        //Resets with nothing allocated in between release the pages once
+        for (auto i = 0; i < 4; ++i)
+        {
+            arena.reset();
+        }
+
+        REQUIRE(arena.telemetry().release_count == 1);
+        REQUIRE(arena.telemetry().released_bytes == committed_pages * page_size);
+
+        //Only the pages used again are released again
+        run_request(10);
+        arena.reset();
+        arena.reset();
+
+        REQUIRE(arena.telemetry().release_count == 2);
+        REQUIRE(arena.telemetry().released_bytes == (committed_pages + 10) * page_size);
+    }
+
+#if defined(__linux__)
+    SECTION("Resident set size stays flat")
+    {
+        //The default policy gives the memory back between requests
+        arena.set_reset_policy(lcl::memory::arena_reset_policy { 0, 4 });
+
+        const auto rss_before = resident_set_size();
+
+        run_request(64 * 1024 * 1024 / page_size);
+
+        for (auto i = 0; i < 100; ++i)
+        {
+            run_request(10);
+        }
+
+        //In ASan builds poisoning the pages also touches their shadow memory, an eighth of their size
+        const auto tolerance = std::size_t { LCL_ASAN ? 12 : 4 } * 1024 * 1024;
+
+        REQUIRE(resident_set_size() < rss_before + tolerance);
+    }
+#endif
+}
+
+TEST_CASE("Arena telemetry", "[memory]")
+{
+    const auto page_size = lcl::memory::get_page_size();
+
+    auto arena = lcl::memory::contiguous_virtual_memory_arena { 64 * 1024 };
+
+    static_cast<void>(arena.allocate(1, 1));
+    static_cast<void>(arena.allocate(8, 8));
+    static_cast<void>(arena.allocate(1000 * page_size, 16));
+
+    auto telemetry = arena.telemetry();
+    REQUIRE(telemetry.reserved_bytes == arena.reserved_bytes());
+    REQUIRE(telemetry.committed_bytes == arena.committed_bytes());
+    REQUIRE(telemetry.peak_committed_bytes == arena.committed_bytes());
+    REQUIRE(telemetry.used_bytes == arena.used_bytes());
+    REQUIRE(telemetry.allocation_count == 3);
+    REQUIRE(telemetry.requested_bytes == 9 + 1000 * page_size);
+    REQUIRE(telemetry.alignment_padding_bytes == 7 + 0);
+    REQUIRE(telemetry.used_bytes == telemetry.requested_bytes + telemetry.alignment_padding_bytes);
+    REQUIRE(telemetry.commit_count == 2);
+    REQUIRE(telemetry.decommit_count == 0);
+    REQUIRE(telemetry.release_count == 0);
+    REQUIRE(telemetry.released_bytes == 0);
+
+    arena.set_high_water_mark(0);
+    arena.rollback(lcl::memory::arena_mark { 0 });
+
+    telemetry = arena.telemetry();
+    REQUIRE(telemetry.committed_bytes == 0);
+    REQUIRE(telemetry.peak_committed_bytes >= 1000 * page_size);
+    REQUIRE(telemetry.used_bytes == 0);
+    REQUIRE(telemetry.allocation_count == 3);
+    REQUIRE(telemetry.decommit_count == 1);
+}
+
+#if LCL_ASAN
+TEST_CASE("Arena poisoning", "[memory]")
+{
+    auto arena = lcl::memory::contiguous_virtual_memory_arena { 1024 };
+
+    const auto first = arena.allocate(64);
+    REQUIRE(__asan_address_is_poisoned(first) == 0);
+    REQUIRE(__asan_address_is_poisoned(first + 63) == 0);
+
+    //Committed but not allocated
+    REQUIRE(__asan_address_is_poisoned(first + 64) != 0);
+    REQUIRE(__asan_address_is_poisoned(arena.base_pointer() + arena.committed_bytes() - 1) != 0);
+
+    const auto mark   = arena.checkpoint();
+    const auto second = arena.allocate(64);
+    REQUIRE(__asan_address_is_poisoned(second) == 0);
+
+    arena.rollback(mark);
+    REQUIRE(__asan_address_is_poisoned(second) != 0);
+    REQUIRE(__asan_address_is_poisoned(first) == 0);
+
+    arena.reset();
+    REQUIRE(__asan_address_is_poisoned(first) != 0);
+}
+#endif
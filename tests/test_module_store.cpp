@@ -0,0 +1,167 @@
+#define CATCH_CONFIG_MAIN
+#include <catch2/catch.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include <module_store.hpp>
+#include <source_buffer.hpp>
+#include <tokenizer.hpp>
+
+using namespace std::string_literals;
+
+static auto spill_directory() -> std::filesystem::path
+{
+    return std::filesystem::temp_directory_path() / "lcl_test_module_store";
+}
+
+static auto module_code(const int module_number) -> std::string
+{
+    auto code = "import Print: print;\n\n"s;
+
+    for (auto i = 0; i < 100; ++i)
+    {
+        code += "function_" + std::to_string(module_number) + "_" + std::to_string(i) + " := () { print(\"Hello Sailor!\", " + std::to_string(i) + "); }\n";
+    }
+
+    return code;
+}
+
+static auto require_same_tokens(const gsl::span<const lcl::token> tokens, const std::vector<lcl::token>& expected_tokens) -> void
+{
+    REQUIRE(static_cast<std::size_t>(tokens.size()) == expected_tokens.size());
+
+    for (auto i = std::size_t { 0 }; i < expected_tokens.size(); ++i)
+    {
+        REQUIRE(tokens[static_cast<std::ptrdiff_t>(i)].type  == expected_tokens[i].type);
+        REQUIRE(tokens[static_cast<std::ptrdiff_t>(i)].code  == expected_tokens[i].code);
+        REQUIRE(tokens[static_cast<std::ptrdiff_t>(i)].flags == expected_tokens[i].flags);
+        REQUIRE(tokens[static_cast<std::ptrdiff_t>(i)].line  == expected_tokens[i].line);
+    }
+}
+
+TEST_CASE("Module store", "[module_store]")
+{
+    auto buffers = std::vector<lcl::source_buffer>{};
+    auto tokens  = std::vector<std::vector<lcl::token>>{};
+
+    for (auto i = 0; i < 8; ++i)
+    {
+        buffers.emplace_back(module_code(i));
+    }
+
+    for (const auto& buffer : buffers)
+    {
+        tokens.push_back(lcl::tokenize_code(buffer).value());
+    }
+
+    SECTION("Without a budget nothing is spilled")
+    {
+        auto store = lcl::module_store { lcl::module_store::unlimited_memory_budget, spill_directory() };
+
+        for (auto i = std::size_t { 0 }; i < tokens.size(); ++i)
+        {
+            REQUIRE(store.add("module_" + std::to_string(i), tokens[i]).value() == i);
+        }
+
+        //The store has its own copy of the code
+        buffers.clear();
+
+        for (auto i = std::size_t { 0 }; i < tokens.size(); ++i)
+        {
+            REQUIRE(store.is_resident(i));
+            REQUIRE(store.tokens(i).value()[5].code == "function_" + std::to_string(i) + "_0");
+        }
+
+        REQUIRE(store.spill_count() == 0);
+        REQUIRE_FALSE(std::filesystem::exists(spill_directory()));
+    }
+
+    SECTION("Modules over the budget are spilled and mapped back in")
+    {
+        //About two modules fit
+        const auto module_size = tokens[0].size() * sizeof(lcl::token) + buffers[0].size();
+        auto       store       = lcl::module_store { module_size * 2, spill_directory() };
+
+        for (auto i = std::size_t { 0 }; i < tokens.size(); ++i)
+        {
+            REQUIRE(store.add("module_" + std::to_string(i), tokens[i]).has_value());
+            REQUIRE(store.memory_usage() <= store.memory_budget());
+        }
+
+        REQUIRE(store.spill_count() >= tokens.size() - 2);
+        REQUIRE_FALSE(store.is_resident(0));
+        REQUIRE(store.is_resident(tokens.size() - 1));
+        REQUIRE(std::filesystem::exists(spill_directory()));
+
+        //In an order that makes every spilled module come back
+        for (auto i = std::size_t { 0 }; i < tokens.size(); ++i)
+        {
+            const auto expected_result = store.tokens(i);
+            REQUIRE(expected_result.has_value());
+            require_same_tokens(*expected_result, tokens[i]);
+            REQUIRE(store.memory_usage() <= store.memory_budget());
+        }
+
+        REQUIRE(store.reload_count() >= tokens.size() - 2);
+
+        //A module is only written once, the file is still there when it is spilled again
+        const auto spill_count = store.spill_count();
+
+        for (auto i = std::size_t { 0 }; i < tokens.size(); ++i)
+        {
+            require_same_tokens(store.tokens(i).value(), tokens[i]);
+        }
+
+        REQUIRE(store.spill_count() == spill_count);
+    }
+
+    SECTION("A module bigger than the budget stays in memory while it is used")
+    {
+        auto store = lcl::module_store { 1, spill_directory() };
+
+        REQUIRE(store.add("module_0", tokens[0]).has_value());
+        REQUIRE(store.is_resident(0));
+
+        REQUIRE(store.add("module_1", tokens[1]).has_value());
+        REQUIRE_FALSE(store.is_resident(0));
+        REQUIRE(store.is_resident(1));
+
+        require_same_tokens(store.tokens(0).value(), tokens[0]);
+        REQUIRE(store.is_resident(0));
+        REQUIRE_FALSE(store.is_resident(1));
+    }
+
+    SECTION("A corrupt spill file is not mapped back in")
+    {
+        auto store = lcl::module_store { 1, spill_directory() };
+
+        REQUIRE(store.add("module_0", tokens[0]).has_value());
+        REQUIRE(store.add("module_1", tokens[1]).has_value());
+        REQUIRE_FALSE(store.is_resident(0));
+
+        //The code offset of the first record, right after the 16 byte header, points past the code
+        {
+            auto file = std::fstream { spill_directory() / "0.lclmodule", std::ios::binary | std::ios::in | std::ios::out };
+            file.seekp(16);
+
+            const auto code_offset = std::uint32_t { 0xFFFFFF00 };
+            file.write(reinterpret_cast<const char*>(&code_offset), sizeof(code_offset));
+            REQUIRE(file.flush());
+        }
+
+        const auto expected_result = store.tokens(0);
+        REQUIRE_FALSE(expected_result.has_value());
+        REQUIRE(expected_result.error() == std::make_error_code(std::errc::illegal_byte_sequence));
+        REQUIRE_FALSE(store.is_resident(0));
+
+        require_same_tokens(store.tokens(1).value(), tokens[1]);
+    }
+
+    //The spill files are removed with the store
+    REQUIRE_FALSE(std::filesystem::exists(spill_directory()));
+}
@@ -0,0 +1,365 @@
+#define CATCH_CONFIG_MAIN
+#include <catch2/catch.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+#include <ast.hpp>
+#include <memory.hpp>
+#include <module_store.hpp>
+#include <parser.hpp>
+#include <source_buffer.hpp>
+#include <string_pool.hpp>
+#include <tokenizer.hpp>
+
+using kind = lcl::ast_node_kind;
+
+//The kinds of every node in pre-order
+static auto node_kinds(const lcl::ast& ast) -> std::vector<lcl::ast_node_kind>
+{
+    return std::vector<lcl::ast_node_kind> { std::begin(ast.kinds()), std::end(ast.kinds()) };
+}
+
+//The code of the first token of every node in pre-order
+static auto node_tokens(const lcl::ast& ast) -> std::vector<std::string>
+{
+    auto result = std::vector<std::string>{};
+
+    for (auto i = lcl::ast_index { 0 }; i < ast.size(); ++i)
+    {
+        result.emplace_back(ast.first_token(i).code);
+    }
+
+    return result;
+}
+
+TEST_CASE("Parser", "[parser]")
+{
+    auto arena = lcl::memory::contiguous_virtual_memory_arena { 64 * 1024 };
+
+    SECTION("Imports")
+    {
+        const auto buffer = lcl::source_buffer { "import Print: print, printf;\nimport Math: *;\n" };
+        const auto tokens = lcl::tokenize_code(buffer).value();
+        const auto ast    = lcl::parse_tokens(tokens, arena);
+
+        REQUIRE(ast.has_value());
+
+        const auto expected_result = std::vector<lcl::ast_node_kind>
+        {
+            kind::global_scope,
+                kind::import_statement, kind::imported_module, kind::imported_name, kind::imported_name,
+                kind::import_statement, kind::imported_module, kind::import_everything,
+        };
+
+        REQUIRE(node_kinds(*ast) == expected_result);
+        REQUIRE(ast->subtree_size(0) == ast->size());
+        REQUIRE(ast->subtree_size(1) == 4);
+        REQUIRE(ast->first_token(5).code == "import");
+        REQUIRE(ast->first_token(6).code == "Math");
+    }
+
+    SECTION("Declarations, structs and unions")
+    {
+        const auto buffer = lcl::source_buffer { "Vector :: struct { x: int; y: *char; }\nNumber :: union { i: int; b: bool; }\ncount: int = 1;\nname := \"Hello Sailor!\";\nlimit :: 10;\n" };
+        const auto tokens = lcl::tokenize_code(buffer).value();
+        const auto ast    = lcl::parse_tokens(tokens, arena);
+
+        REQUIRE(ast.has_value());
+
+        const auto expected_result = std::vector<lcl::ast_node_kind>
+        {
+            kind::global_scope,
+                kind::constant_declaration, kind::struct_definition,
+                    kind::field, kind::named_type,
+                    kind::field, kind::pointer_type, kind::named_type,
+                kind::constant_declaration, kind::union_definition,
+                    kind::field, kind::named_type,
+                    kind::field, kind::named_type,
+                kind::variable_declaration, kind::named_type, kind::numeric_literal,
+                kind::variable_declaration, kind::string_literal,
+                kind::constant_declaration, kind::numeric_literal,
+        };
+
+        REQUIRE(node_kinds(*ast) == expected_result);
+        REQUIRE(ast->first_token(1).code == "Vector");
+        REQUIRE(ast->first_token(7).code == "char");
+        REQUIRE(ast->first_token(17).code == "name");
+    }
+
+    SECTION("Functions and statements")
+    {
+        const auto buffer = lcl::source_buffer
+        {
+            "main :: (argc: int, argv: **char) -> int\n"
+            "{\n"
+            "    //Comment\n"
+            "    i := 0;\n"
+            "    while i < argc { if i == 2 break; else { i = i + 1; continue; } }\n"
+            "    print(\"Hello Sailor!\");\n"
+            "    return 0;\n"
+            "}\n"
+            "run :: () { }\n"
+        };
+        const auto tokens = lcl::tokenize_code(buffer).value();
+        const auto ast    = lcl::parse_tokens(tokens, arena);
+
+        REQUIRE(ast.has_value());
+
+        const auto expected_result = std::vector<lcl::ast_node_kind>
+        {
+            kind::global_scope,
+                kind::constant_declaration, kind::function,
+                    kind::parameter, kind::named_type,
+                    kind::parameter, kind::pointer_type, kind::pointer_type, kind::named_type,
+                    kind::named_type,
+                    kind::block,
+                        kind::variable_declaration, kind::numeric_literal,
+                        kind::while_statement, kind::binary_expression, kind::identifier, kind::identifier,
+                            kind::block, kind::if_statement, kind::binary_expression, kind::identifier, kind::numeric_literal,
+                                kind::break_statement,
+                                kind::block,
+                                    kind::assignment_statement, kind::identifier, kind::binary_expression, kind::identifier, kind::numeric_literal,
+                                    kind::continue_statement,
+                        kind::expression_statement, kind::call_expression, kind::identifier, kind::string_literal,
+                        kind::return_statement, kind::numeric_literal,
+                kind::constant_declaration, kind::function, kind::block,
+        };
+
+        REQUIRE(node_kinds(*ast) == expected_result);
+
+        //The function, then the run declaration right after its subtree
+        REQUIRE(ast->subtree_end(1) == expected_result.size() - 3);
+
+        const auto function = lcl::ast_index { 2 };
+        auto       children = std::vector<lcl::ast_index>{};
+
+        for (const auto child : ast->children(function))
+        {
+            children.push_back(child);
+        }
+
+        REQUIRE(children == std::vector<lcl::ast_index> { 3, 5, 9, 10 });
+        REQUIRE(ast->first_token(14).code == "<");
+        REQUIRE(ast->first_token(24).code == "=");
+    }
+
+    SECTION("Operator precedence")
+    {
+        const auto buffer = lcl::source_buffer { "x := -a + b * c[1] == d.e or not f and g(h, 2) >= 3 << 1;\n" };
+        const auto tokens = lcl::tokenize_code(buffer).value();
+        const auto ast    = lcl::parse_tokens(tokens, arena);
+
+        REQUIRE(ast.has_value());
+
+        //((-a + (b * c[1])) == d.e) or ((not f) and (g(h, 2) >= (3 << 1))), operators such as `==` are recorded by their first token
+        const auto expected_result = std::vector<std::string>
+        {
+            "", "x",
+                "or",
+                    "=",
+                        "+",
+                            "-", "a",
+                            "*", "b", "[", "c", "1",
+                        ".", "d", "e",
+                    "and",
+                        "not", "f",
+                        ">",
+                            "(", "g", "h", "2",
+                            "<", "3", "1",
+        };
+
+        auto result = node_tokens(*ast);
+        result[0]   = "";
+
+        REQUIRE(result == expected_result);
+    }
+
+    SECTION("Binary operators are left associative")
+    {
+        const auto buffer = lcl::source_buffer { "x := a - b - (c - d);\n" };
+        const auto tokens = lcl::tokenize_code(buffer).value();
+        const auto ast    = lcl::parse_tokens(tokens, arena);
+
+        REQUIRE(ast.has_value());
+
+        const auto expected_result = std::vector<std::string> { "x", "-", "-", "a", "b", "-", "c", "d" };
+        const auto result          = node_tokens(*ast);
+
+        REQUIRE(std::vector<std::string> { std::begin(result) + 1, std::end(result) } == expected_result);
+        REQUIRE(ast->first_token(2).code.data() > ast->first_token(3).code.data());
+    }
+
+    SECTION("Prefix and two token operators")
+    {
+        const auto buffer = lcl::source_buffer { "x := a * -b + c != d | e ^ f & g >> 1 <= h;\n" };
+        const auto tokens = lcl::tokenize_code(buffer).value();
+        const auto ast    = lcl::parse_tokens(tokens, arena);
+
+        REQUIRE(ast.has_value());
+
+        //(((a * -b) + c) != (d | (e ^ (f & (g >> 1))))) <= h, the comparisons are left associative
+        const auto expected_result = std::vector<std::string>
+        {
+            "x",
+                "<",
+                    "!",
+                        "+",
+                            "*", "a", "-", "b",
+                            "c",
+                        "|",
+                            "d",
+                            "^",
+                                "e",
+                                "&", "f", ">", "g", "1",
+                    "h",
+        };
+        const auto result = node_tokens(*ast);
+
+        REQUIRE(std::vector<std::string> { std::begin(result) + 1, std::end(result) } == expected_result);
+        REQUIRE(ast->kind(7) == kind::unary_expression);
+        REQUIRE(ast->subtree_size(2) == ast->size() - 2);
+    }
+
+    SECTION("Long expressions")
+    {
+        auto code = std::string { "x := 0" };
+
+        for (auto i = 0; i < 100000; ++i)
+        {
+            code += " + 1 * 2 or 3";
+        }
+
+        const auto buffer = lcl::source_buffer { code + ";\n" };
+        const auto tokens = lcl::tokenize_code(buffer).value();
+        const auto ast    = lcl::parse_tokens(tokens, arena);
+
+        REQUIRE(ast.has_value());
+
+        //Every `or` is the root of the one before it, the last one is the root of the value
+        REQUIRE(ast->size() == 2 + 1 + 100000 * 6);
+        REQUIRE(ast->first_token(2).code == "or");
+        REQUIRE(ast->first_token(2).code.data() == std::next(tokens.rbegin(), 2)->code.data());
+        REQUIRE(ast->subtree_size(2) == ast->size() - 2);
+    }
+
+    SECTION("Operators made of joined tokens")
+    {
+        //Interned tokens share their code, the `=` of `==` and the `=` of `:=` are the same copy
+        const auto buffer   = lcl::source_buffer { "x := a == b;\ny := a < = b;\n" };
+        const auto tokens   = lcl::tokenize_code(buffer).value();
+        auto       pool     = lcl::string_pool{};
+        const auto interned = pool.intern_tokens(gsl::span<const lcl::token> { tokens.data(), 8 });
+
+        REQUIRE(tokens[5].is_joined_to_previous());
+        REQUIRE_FALSE(tokens[13].is_joined_to_previous());
+
+        const auto interned_ast = lcl::parse_tokens(gsl::span<const lcl::token> { interned.data(), interned.size() }, arena);
+        REQUIRE(interned_ast.has_value());
+        REQUIRE(interned_ast->kind(2) == kind::binary_expression);
+        REQUIRE(interned_ast->first_token(2).code == "=");
+
+        //A stored module has its code copied back to back, `< =` still isn't `<=`
+        auto store = lcl::module_store { lcl::module_store::unlimited_memory_budget, std::filesystem::temp_directory_path() / "lcl_test_parser" };
+        REQUIRE(store.add("module", tokens).has_value());
+
+        const auto stored = store.tokens(0).value();
+        REQUIRE(stored[12].code.data() + stored[12].code.size() == stored[13].code.data());
+
+        const auto stored_error = lcl::parse_tokens(stored, arena).error();
+        REQUIRE(stored_error.error_type == lcl::parser_error_type::expected_expression);
+        REQUIRE(stored_error.token_index == 13);
+    }
+
+    SECTION("Nesting")
+    {
+        const auto parse_code = [&](const std::string& code)
+        {
+            const auto buffer = lcl::source_buffer { code };
+            const auto tokens = lcl::tokenize_code(buffer).value();
+
+            return lcl::parse_tokens(tokens, arena);
+        };
+
+        const auto repeat = [](const char* text, const int count)
+        {
+            auto result = std::string{};
+
+            for (auto i = 0; i < count; ++i)
+            {
+                result += text;
+            }
+
+            return result;
+        };
+
+        REQUIRE(parse_code("x := " + repeat("(", 200) + "1" + repeat(")", 200) + ";").has_value());
+        REQUIRE(parse_code("main :: () " + repeat("{", 200) + repeat("}", 200)).has_value());
+        REQUIRE(parse_code("x: " + repeat("*", 100000) + "int;").has_value());
+
+        const auto too_deep = [&](const std::string& code)
+        {
+            const auto ast = parse_code(code);
+            REQUIRE_FALSE(ast.has_value());
+            REQUIRE(ast.error().error_type == lcl::parser_error_type::nesting_too_deep);
+        };
+
+        too_deep("x := " + repeat("(", 100000) + "1" + repeat(")", 100000) + ";");
+        too_deep("x := " + repeat("f(", 100000) + repeat(")", 100000) + ";");
+        too_deep("x := " + repeat("a[", 100000) + "1" + repeat("]", 100000) + ";");
+        too_deep("main :: () " + repeat("{", 100000) + repeat("}", 100000));
+        too_deep("main :: () { " + repeat("if x ", 100000) + "return; }");
+        too_deep("main :: () { " + repeat("while x ", 100000) + "break; }");
+    }
+
+    SECTION("Errors")
+    {
+        const auto parse_error = [&](const char* code) -> lcl::parser_error
+        {
+            const auto buffer = lcl::source_buffer { code };
+            const auto tokens = lcl::tokenize_code(buffer).value();
+
+            return lcl::parse_tokens(tokens, arena).error();
+        };
+
+        //What a failed parse allocated is given back
+        const auto used_bytes        = arena.used_bytes();
+        const auto missing_semicolon = parse_error("x := 1\ny := 2;");
+        REQUIRE(arena.used_bytes() == used_bytes);
+
+        REQUIRE(missing_semicolon.error_type == lcl::parser_error_type::expected_semicolon);
+        REQUIRE(missing_semicolon.token_index == 4);
+
+        REQUIRE(parse_error("import Print print;").error_type            == lcl::parser_error_type::expected_colon);
+        REQUIRE(parse_error("import Print: 1;").error_type               == lcl::parser_error_type::expected_identifier);
+        REQUIRE(parse_error("x : 1;").error_type                         == lcl::parser_error_type::expected_type);
+        REQUIRE(parse_error("x : : 5;").error_type                       == lcl::parser_error_type::expected_type);
+        REQUIRE(parse_error("x := (1 + 2;").error_type                   == lcl::parser_error_type::expected_close_parans);
+        REQUIRE(parse_error("x := a[1;").error_type                      == lcl::parser_error_type::expected_close_square_bracket);
+        REQUIRE(parse_error("x := 1 + ;").error_type                     == lcl::parser_error_type::expected_expression);
+        REQUIRE(parse_error("main :: () -> int return 0;").error_type    == lcl::parser_error_type::expected_open_curly);
+        REQUIRE(parse_error("1 := 2;").error_type                        == lcl::parser_error_type::unexpected_token);
+
+        const auto unfinished = parse_error("main :: () { return 0;");
+        REQUIRE(unfinished.error_type == lcl::parser_error_type::unexpected_end_of_code);
+        REQUIRE(unfinished.token_index == 9);
+    }
+
+    SECTION("Empty code")
+    {
+        const auto buffer = lcl::source_buffer { "//Nothing but a comment\n" };
+        const auto tokens = lcl::tokenize_code(buffer).value();
+        const auto ast    = lcl::parse_tokens(tokens, arena);
+
+        REQUIRE(ast.has_value());
+        REQUIRE(node_kinds(*ast) == std::vector<lcl::ast_node_kind> { kind::global_scope });
+        REQUIRE(ast->has_first_token(0));
+
+        const auto no_tokens = lcl::parse_tokens(gsl::span<const lcl::token>{}, arena);
+        REQUIRE(no_tokens.has_value());
+        REQUIRE_FALSE(no_tokens->has_first_token(0));
+    }
+}
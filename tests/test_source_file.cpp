@@ -0,0 +1,126 @@
+#define CATCH_CONFIG_MAIN
+#include <catch2/catch.hpp>
+
+#include <cstddef>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include <source_buffer.hpp>
+#include <source_file.hpp>
+#include <string_pool.hpp>
+#include <tokenizer.hpp>
+
+//Writes `code` to a file that is removed at the end of the test
+class temporary_file
+{
+    std::string m_path;
+
+    public:
+    explicit temporary_file(const std::string& code)
+    {
+        static auto file_count = std::size_t { 0 };
+
+        m_path = (std::filesystem::temp_directory_path() / ("lcl_test_source_file_" + std::to_string(file_count++) + ".lcl")).string();
+
+        auto file = std::ofstream { m_path, std::ios::binary };
+        file << code;
+    }
+
+    temporary_file(const temporary_file&) = delete;
+    temporary_file& operator=(const temporary_file&) = delete;
+
+    [[nodiscard]] auto path() const -> const std::string&
+    {
+        return m_path;
+    }
+
+    ~temporary_file()
+    {
+        std::filesystem::remove(m_path);
+    }
+};
+
+TEST_CASE("Source file lifetime", "[source_file]")
+{
+    const auto file   = temporary_file { "import Print: print;\n\nmain := () { print(hello_sailor); }\n" };
+    auto       source = lcl::source_file { file.path() };
+
+    REQUIRE_FALSE(source.is_loaded());
+
+    SECTION("Every user shares the buffer that is loaded")
+    {
+        const auto first  = source.load();
+        const auto second = source.load();
+        REQUIRE(first.has_value());
+        REQUIRE(second.has_value());
+
+        REQUIRE(first->get() == second->get());
+        REQUIRE(source.load_count() == 1);
+        REQUIRE(source.is_loaded());
+    }
+
+    SECTION("The buffer is freed with its last user and reloaded on demand")
+    {
+        auto location = lcl::source_location{};
+
+        {
+            const auto buffer = source.load().value();
+            const auto tokens = lcl::tokenize_code(*buffer).value();
+
+            REQUIRE(tokens[13].code == "hello_sailor");
+            location = lcl::source_file::location_of(*buffer, tokens[13].code);
+        }
+
+        REQUIRE_FALSE(source.is_loaded());
+
+        const auto expected_result = source.text_at(location);
+        REQUIRE(expected_result.has_value());
+        REQUIRE(*expected_result == "hello_sailor");
+        REQUIRE(source.load_count() == 2);
+
+        //The text was only loaded to be copied
+        REQUIRE_FALSE(source.is_loaded());
+
+        REQUIRE(source.lines_at(location).value() == "main := () { print(hello_sailor); }");
+        REQUIRE(source.lines_at(lcl::source_location { 0, 6 }).value() == "import Print: print;");
+        REQUIRE(source.lines_at(lcl::source_location { 21, 0 }).value().empty());
+    }
+
+    SECTION("Interned tokens outlive the buffer")
+    {
+        auto pool   = lcl::string_pool{};
+        auto tokens = std::vector<lcl::token>{};
+
+        {
+            const auto buffer = source.load().value();
+            tokens = pool.intern_tokens(lcl::tokenize_code(*buffer).value());
+        }
+
+        REQUIRE_FALSE(source.is_loaded());
+
+        REQUIRE(tokens[0].is_keyword());
+        REQUIRE(tokens[1].code == "Print");
+        REQUIRE(tokens[13].code == "hello_sailor");
+        REQUIRE(tokens[13].line == 3);
+
+        //`print` is used twice and interned once
+        REQUIRE(tokens[3].code == "print");
+        REQUIRE(tokens[3].code.data() == tokens[11].code.data());
+    }
+
+    SECTION("Locations outside of the file")
+    {
+        REQUIRE(source.text_at(lcl::source_location { 1000, 1 }).error() == std::errc::invalid_argument);
+    }
+}
+
+TEST_CASE("Missing source file", "[source_file]")
+{
+    auto source = lcl::source_file { "/this/file/does/not/exist.lcl" };
+
+    REQUIRE(source.load().error() == std::errc::no_such_file_or_directory);
+    REQUIRE(source.text_at(lcl::source_location { 0, 1 }).error() == std::errc::no_such_file_or_directory);
+    REQUIRE(source.load_count() == 0);
+}
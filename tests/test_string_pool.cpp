@@ -0,0 +1,207 @@
+#define CATCH_CONFIG_MAIN
+#include <catch2/catch.hpp>
+
+#include <new>
+#include <string>
+
+#include <tl/expected.hpp>
+
+#include <source_buffer.hpp>
+#include <string_pool.hpp>
+#include <tokenizer.hpp>
+
+using namespace std::string_view_literals;
+
+static auto tokenize_single_string_literal(const lcl::source_buffer& buffer) -> lcl::token
+{
+    const auto expected_result = lcl::tokenize_code(buffer);
+    REQUIRE(expected_result.has_value());
+    REQUIRE(expected_result->size() == 1);
+    REQUIRE((*expected_result)[0].type == lcl::token_type::string_literal);
+
+    return (*expected_result)[0];
+}
+
+TEST_CASE("Decoding of string literals", "[string_pool]")
+{
+    auto pool = lcl::string_pool{};
+
+    SECTION("String without escapes is not copied")
+    {
+        const auto buffer = lcl::source_buffer { "\"Hello Sailor!\""sv };
+        const auto token  = tokenize_single_string_literal(buffer);
+
+        const auto expected_result = pool.decode_string_literal(token);
+        REQUIRE(expected_result.has_value());
+
+        REQUIRE(*expected_result == "Hello Sailor!");
+        REQUIRE(expected_result->data() == token.code.data() + 1);
+        REQUIRE(pool.used_bytes() == 0);
+        REQUIRE(pool.arena().committed_pages() == 0);
+    }
+
+    SECTION("Empty string")
+    {
+        const auto buffer = lcl::source_buffer { "\"\""sv };
+        const auto token  = tokenize_single_string_literal(buffer);
+
+        const auto expected_result = pool.decode_string_literal(token);
+        REQUIRE(expected_result.has_value());
+        REQUIRE(expected_result->empty());
+    }
+
+    SECTION("String with escapes")
+    {
+        const auto buffer = lcl::source_buffer { R"("a\n\t\r\\\"\'\x41\0b")"sv };
+        const auto token  = tokenize_single_string_literal(buffer);
+
+        const auto expected_result = pool.decode_string_literal(token);
+        REQUIRE(expected_result.has_value());
+
+        REQUIRE(*expected_result == "a\n\t\r\\\"'A\0b"sv);
+        REQUIRE(pool.used_bytes() == expected_result->size());
+    }
+
+    SECTION("String ending with an escaped backslash")
+    {
+        const auto buffer = lcl::source_buffer { R"("\\" a)"sv };
+
+        const auto expected_tokens = lcl::tokenize_code(buffer);
+        REQUIRE(expected_tokens.has_value());
+        REQUIRE(expected_tokens->size() == 2);
+
+        const auto expected_result = pool.decode_string_literal((*expected_tokens)[0]);
+        REQUIRE(expected_result.has_value());
+        REQUIRE(*expected_result == "\\");
+    }
+
+    SECTION("Decoded strings stay valid")
+    {
+        const auto buffer = lcl::source_buffer { R"("\n")"sv };
+        const auto token  = tokenize_single_string_literal(buffer);
+
+        const auto first = pool.decode_string_literal(token);
+        REQUIRE(first.has_value());
+
+        for (auto i = 0; i < 100000; ++i)
+        {
+            REQUIRE(pool.decode_string_literal(token).has_value());
+        }
+
+        REQUIRE(pool.arena().telemetry().commit_count > 1);
+        REQUIRE(*first == "\n");
+    }
+
+    SECTION("String bigger than the first commit")
+    {
+        const auto size   = lcl::memory::contiguous_virtual_memory_arena::minimum_pages_to_commit * lcl::memory::get_page_size() * 2;
+        const auto code   = "\"\\n" + std::string(size, 'a') + "\"";
+        const auto buffer = lcl::source_buffer { code };
+        const auto token  = tokenize_single_string_literal(buffer);
+
+        const auto expected_result = pool.decode_string_literal(token);
+        REQUIRE(expected_result.has_value());
+        REQUIRE(expected_result->size() == size + 1);
+        REQUIRE(pool.used_bytes() == size + 1);
+    }
+
+    SECTION("String bigger than the pool")
+    {
+        auto small_pool = lcl::string_pool { lcl::memory::get_page_size() };
+
+        const auto buffer = lcl::source_buffer { "\"\\n" + std::string(lcl::memory::get_page_size(), 'a') + "\"" };
+        const auto token  = tokenize_single_string_literal(buffer);
+
+        REQUIRE_THROWS_AS(small_pool.decode_string_literal(token), std::bad_alloc);
+    }
+
+    SECTION("Decoding failure")
+    {
+        SECTION("Unknown escape sequence")
+        {
+            const auto buffer = lcl::source_buffer { R"("ab\q")"sv };
+            const auto token  = tokenize_single_string_literal(buffer);
+
+            const auto expected_result = pool.decode_string_literal(token);
+            REQUIRE(!expected_result.has_value());
+            REQUIRE(expected_result.error().error_type == lcl::tokenizer_error_type::unknown_escape_sequence);
+            REQUIRE(&*expected_result.error().iterator_when_error_occured == token.code.data() + 3);
+            REQUIRE(pool.used_bytes() == 0);
+        }
+
+        SECTION("Hex escape sequence not valid")
+        {
+            const auto buffer = lcl::source_buffer { R"("\x4")"sv };
+            const auto token  = tokenize_single_string_literal(buffer);
+
+            const auto expected_result = pool.decode_string_literal(token);
+            REQUIRE(!expected_result.has_value());
+            REQUIRE(expected_result.error().error_type == lcl::tokenizer_error_type::hex_escape_sequence_not_valid);
+        }
+
+        SECTION("String not closed")
+        {
+            using collect_errors_policy = lcl::tokenizer_policy<false, false, false, true>;
+
+            //The literals end before the newline or the end of the code, the last one with an escaped quote
+            const auto buffer = lcl::source_buffer { "\"abc\n\"a\\n\n\"\n\"a\\\""sv };
+            const auto result = lcl::tokenize_code<collect_errors_policy>(buffer);
+            REQUIRE(result.tokens.size() == 4);
+
+            for (const auto& token : result.tokens)
+            {
+                REQUIRE(token.type == lcl::token_type::string_literal);
+
+                const auto expected_result = pool.decode_string_literal(token);
+                REQUIRE(!expected_result.has_value());
+                REQUIRE(expected_result.error().error_type == lcl::tokenizer_error_type::string_literal_not_closed_properly);
+                REQUIRE(&*expected_result.error().iterator_when_error_occured == token.code.data());
+            }
+
+            REQUIRE(pool.used_bytes() == 0);
+        }
+    }
+}
+
+TEST_CASE("Interning", "[string_pool]")
+{
+    auto pool = lcl::string_pool{};
+
+    auto hello = std::string { "hello" };
+
+    const auto interned = pool.intern(hello);
+    REQUIRE(interned == "hello");
+    REQUIRE(interned.data() != hello.data());
+
+    //Equal texts share a copy, the original can go away
+    hello = "sailor";
+    REQUIRE(pool.intern("hello"sv).data() == interned.data());
+    REQUIRE(pool.intern(hello) == "sailor");
+    REQUIRE(pool.interned_count() == 2);
+    REQUIRE(pool.used_bytes() == 11);
+    REQUIRE(interned == "hello");
+
+    //In the order they were first interned
+    REQUIRE(pool.interned_index("hello"sv) == 0u);
+    REQUIRE(pool.interned_index("sailor"sv) == 1u);
+    REQUIRE(!pool.interned_index("world"sv).has_value());
+}
+
+TEST_CASE("Resetting the pool", "[string_pool]")
+{
+    auto pool = lcl::string_pool{};
+    pool.arena().set_reset_policy(lcl::memory::arena_reset_policy { 0, 1 });
+
+    const auto first = pool.intern("hello"sv);
+    REQUIRE(pool.arena().telemetry().used_bytes == 5);
+
+    pool.reset();
+    REQUIRE(pool.used_bytes() == 0);
+    REQUIRE(pool.interned_count() == 0);
+    REQUIRE(!pool.interned_index("hello"sv).has_value());
+    REQUIRE(pool.arena().telemetry().used_bytes == 0);
+
+    //The memory is reused from the start
+    REQUIRE(pool.intern("sailor"sv).data() == first.data());
+    REQUIRE(pool.interned_index("sailor"sv) == 0u);
+}
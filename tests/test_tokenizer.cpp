@@ -1,8 +1,13 @@
 #define CATCH_CONFIG_MAIN
 #include <catch2/catch.hpp>
 
+#include <string>
+
 #include <tl/expected.hpp>
 
+#include <batch_tokenizer.hpp>
+#include <import_prescan.hpp>
+#include <token_queue.hpp>
 #include <tokenizer.hpp>
 #include <std_utils.hpp>
 
@@ -583,4 +588,717 @@ TEST_CASE("Tokenization of complex example", "[tokenizer]")
             }
         }
     }
-}
\ No newline at end of file
+}
+
+TEST_CASE("Token flags", "[tokenizer]")
+{
+    SECTION("Comment flags")
+    {
+        const auto code = "//Single\n/* Multi */"sv;
+        const auto expected_result = lcl::tokenize_code(code);
+        REQUIRE(expected_result.has_value());
+        const auto result = *expected_result;
+
+        REQUIRE(result.size() == 2);
+
+        REQUIRE(result[0].is_single_line_comment());
+        REQUIRE(!result[0].is_multi_line_comment());
+
+        REQUIRE(result[1].is_multi_line_comment());
+        REQUIRE(!result[1].is_single_line_comment());
+    }
+
+    SECTION("Numeric literal flags")
+    {
+        const auto code = "1 1.5 1_000 1.0. 1.."sv;
+        const auto expected_result = lcl::tokenize_code(code);
+        REQUIRE(expected_result.has_value());
+        const auto result = *expected_result;
+
+        REQUIRE(result.size() == 8);
+
+        REQUIRE(result[0].is_int_literal());
+        REQUIRE(!result[0].is_float_literal());
+        REQUIRE(!result[0].has_underscores());
+
+        REQUIRE(result[1].is_float_literal());
+        REQUIRE(!result[1].is_int_literal());
+
+        REQUIRE(result[2].is_int_literal());
+        REQUIRE(result[2].has_underscores());
+
+        REQUIRE(result[3].code == "1.0");
+        REQUIRE(result[3].is_float_literal());
+
+        REQUIRE(result[5].code == "1");
+        REQUIRE(result[5].is_int_literal());
+    }
+
+    SECTION("String literal flags")
+    {
+        const auto code = "\"Test\" \"\\\"Test\\\"\""sv;
+        const auto expected_result = lcl::tokenize_code(code);
+        REQUIRE(expected_result.has_value());
+        const auto result = *expected_result;
+
+        REQUIRE(result.size() == 2);
+
+        REQUIRE(!result[0].has_escapes());
+        REQUIRE(result[1].has_escapes());
+    }
+
+    SECTION("Word flags")
+    {
+        const auto code = "while test"sv;
+        const auto expected_result = lcl::tokenize_code(code);
+        REQUIRE(expected_result.has_value());
+        const auto result = *expected_result;
+
+        REQUIRE(result.size() == 2);
+
+        REQUIRE(result[0].is_keyword());
+        REQUIRE(!result[0].is_identifier());
+
+        REQUIRE(result[1].is_identifier());
+        REQUIRE(!result[1].is_keyword());
+    }
+
+    SECTION("Preceded by newline")
+    {
+        const auto code = "a b\n  c\r\n(d"sv;
+        const auto expected_result = lcl::tokenize_code(code);
+        REQUIRE(expected_result.has_value());
+        const auto result = *expected_result;
+
+        REQUIRE(result.size() == 5);
+
+        REQUIRE(result[0].is_preceded_by_newline());
+        REQUIRE(!result[1].is_preceded_by_newline());
+        REQUIRE(result[2].is_preceded_by_newline());
+        REQUIRE(result[3].is_preceded_by_newline());
+        REQUIRE(!result[4].is_preceded_by_newline());
+    }
+
+    SECTION("Joined to previous")
+    {
+        const auto buffer          = lcl::source_buffer { "a==b < =c=/**/=d"sv };
+        const auto expected_result = lcl::tokenize_code<lcl::minimal_tokenizer_policy>(buffer);
+        REQUIRE(expected_result.has_value());
+        const auto result = *expected_result;
+
+        REQUIRE(result.size() == 10);
+
+        REQUIRE(!result[0].is_joined_to_previous());
+        REQUIRE(result[1].is_joined_to_previous());
+        REQUIRE(result[2].is_joined_to_previous());
+        REQUIRE(result[3].is_joined_to_previous());
+        REQUIRE(!result[4].is_joined_to_previous());
+        REQUIRE(!result[5].is_joined_to_previous());
+        REQUIRE(result[6].is_joined_to_previous());
+        REQUIRE(result[7].is_joined_to_previous());
+
+        //A comment in between splits them, even when it isn't kept
+        REQUIRE(!result[8].is_joined_to_previous());
+    }
+}
+
+TEST_CASE("Tokenization of source buffer", "[tokenizer]")
+{
+    SECTION("Buffer is sentinel terminated and padded")
+    {
+        const auto buffer = lcl::source_buffer { "test"sv };
+
+        REQUIRE(buffer.code() == "test");
+        REQUIRE(buffer.padded_code().size() == buffer.size() + 1 + lcl::source_buffer::padding_size);
+
+        for (auto i = buffer.size(); i < buffer.padded_code().size(); ++i)
+        {
+            REQUIRE(buffer.padded_code()[i] == '\0');
+        }
+    }
+
+    SECTION("Moved from buffer is empty and can be reused")
+    {
+        auto buffer       = lcl::source_buffer { "hello"sv };
+        auto moved_buffer = std::move(buffer);
+
+        REQUIRE(moved_buffer.code() == "hello");
+        REQUIRE(buffer.code().empty());
+        REQUIRE(buffer.size() == 0);
+
+        //Still sentinel terminated and padded
+        REQUIRE(buffer.padded_code().size() == 1 + lcl::source_buffer::padding_size);
+        REQUIRE(buffer.padded_code()[0] == '\0');
+
+        const auto expected_result = lcl::tokenize_code(buffer);
+        REQUIRE(expected_result.has_value());
+        REQUIRE(expected_result->empty());
+
+        buffer.assign("abc"sv);
+        REQUIRE(buffer.code() == "abc");
+        REQUIRE(buffer.padded_code()[3] == '\0');
+
+        moved_buffer = std::move(buffer);
+        REQUIRE(moved_buffer.code() == "abc");
+        REQUIRE(buffer.size() == 0);
+
+        buffer.assign("a"sv);
+        REQUIRE(buffer.code() == "a");
+    }
+
+    SECTION("Tokens point into the buffer")
+    {
+        const auto buffer = lcl::source_buffer { "hello := 1; //Comment"sv };
+
+        const auto expected_result = lcl::tokenize_code(buffer);
+        REQUIRE(expected_result.has_value());
+        const auto result = *expected_result;
+
+        REQUIRE(result.size() == 6);
+
+        for (const auto& token : result)
+        {
+            REQUIRE(token.code.data() >= buffer.data());
+            REQUIRE(token.code.data() + token.code.size() <= buffer.data() + buffer.size());
+        }
+
+        REQUIRE(result[5].code == "//Comment");
+    }
+
+    SECTION("Tokens and errors of a string view point into the string view")
+    {
+        const auto code = "hello \"world"sv;
+
+        const auto expected_result = lcl::tokenize_code(code.substr(0, 5));
+        REQUIRE(expected_result.has_value());
+        REQUIRE((*expected_result)[0].code.data() == code.data());
+
+        const auto expected_error = lcl::tokenize_code(code);
+        REQUIRE(!expected_error.has_value());
+        REQUIRE(expected_error.error().error_type == lcl::tokenizer_error_type::string_literal_not_closed_properly);
+        REQUIRE(&*expected_error.error().iterator_when_error_occured == code.data() + 6);
+    }
+
+    SECTION("Null character inside code is not the end of the code")
+    {
+        const auto code = "//a\0b\nc"sv;
+
+        const auto expected_result = lcl::tokenize_code(code);
+        REQUIRE(expected_result.has_value());
+        const auto result = *expected_result;
+
+        REQUIRE(result.size() == 2);
+        REQUIRE(result[0].code == "//a\0b"sv);
+        REQUIRE(result[1].code == "c");
+    }
+}
+
+TEST_CASE("Bracket pairs", "[tokenizer]")
+{
+    SECTION("Nested brackets")
+    {
+        const auto buffer = lcl::source_buffer { "main :: () { a[(1)]; }"sv };
+
+        const auto expected_result = lcl::tokenize_code_with_bracket_pairs(buffer);
+        REQUIRE(expected_result.has_value());
+        const auto& result = *expected_result;
+
+        REQUIRE(result.tokens.size() == 14);
+        REQUIRE(result.brackets.are_balanced());
+        REQUIRE(result.brackets.matching_closers.size() == result.tokens.size());
+
+        REQUIRE(result.brackets.matching_closer(3)  == 4);
+        REQUIRE(result.brackets.matching_closer(5)  == 13);
+        REQUIRE(result.brackets.matching_closer(7)  == 11);
+        REQUIRE(result.brackets.matching_closer(8)  == 10);
+        REQUIRE(result.brackets.matching_closer(0)  == lcl::bracket_pairs::no_matching_bracket);
+        REQUIRE(result.brackets.matching_closer(13) == lcl::bracket_pairs::no_matching_bracket);
+    }
+
+    SECTION("Unbalanced brackets")
+    {
+        const auto buffer = lcl::source_buffer { "] ( [ ) {"sv };
+
+        const auto expected_result = lcl::tokenize_code_with_bracket_pairs(buffer);
+        REQUIRE(expected_result.has_value());
+        const auto& result = *expected_result;
+
+        REQUIRE(!result.brackets.are_balanced());
+        REQUIRE(result.brackets.unmatched_brackets == std::vector<std::uint32_t> { 0, 2, 4 });
+        REQUIRE(result.brackets.matching_closer(1) == 3);
+    }
+}
+
+TEST_CASE("Pipelined tokenization", "[tokenizer]")
+{
+    SECTION("Tokens match the regular tokenizer")
+    {
+        auto code = std::string{};
+
+        for (auto i = 0; i < 1000; ++i)
+        {
+            code += "hello := world(1, 2.5); //Comment\n";
+        }
+
+        const auto buffer          = lcl::source_buffer { code };
+        const auto expected_result = lcl::tokenize_code(buffer);
+        REQUIRE(expected_result.has_value());
+
+        //A small queue makes the tokenizer wait for the consumer
+        auto tokenizer = lcl::pipelined_tokenizer { buffer, 64 };
+        auto result    = std::vector<lcl::token>{};
+
+        while (tokenizer.pop_tokens(result, 100))
+        {
+            //Empty
+        }
+
+        REQUIRE(!tokenizer.error().has_value());
+        REQUIRE(result.size() == expected_result->size());
+
+        for (auto i = 0; i < lcl::ssize(result); ++i)
+        {
+            REQUIRE(result[i].type        == (*expected_result)[i].type);
+            REQUIRE(result[i].code.data() == (*expected_result)[i].code.data());
+            REQUIRE(result[i].flags       == (*expected_result)[i].flags);
+        }
+    }
+
+    SECTION("Tokenization failure")
+    {
+        const auto buffer = lcl::source_buffer { "hello \"world"sv };
+
+        auto tokenizer = lcl::pipelined_tokenizer { buffer };
+        auto result    = std::vector<lcl::token>{};
+
+        while (tokenizer.pop_tokens(result, 100))
+        {
+            //Empty
+        }
+
+        REQUIRE(result.size() == 1);
+        REQUIRE(tokenizer.error().has_value());
+        REQUIRE(tokenizer.error()->error_type == lcl::tokenizer_error_type::string_literal_not_closed_properly);
+    }
+
+    SECTION("Consumer stops early")
+    {
+        const auto buffer = lcl::source_buffer { std::string(100000, '+') };
+
+        auto tokenizer = lcl::pipelined_tokenizer { buffer, 64 };
+        auto result    = std::vector<lcl::token>{};
+
+        REQUIRE(tokenizer.pop_tokens(result, 10));
+    }
+
+    SECTION("Tokenizing stops once the consumer cancelled")
+    {
+        const auto buffer = lcl::source_buffer { std::string(100000, '+') };
+
+        auto queue  = lcl::token_queue{};
+        auto result = std::vector<lcl::token>{};
+
+        queue.cancel();
+        lcl::tokenize_code_into_queue(buffer, queue);
+
+        while (queue.pop_tokens(result, 1000))
+        {
+            //Empty
+        }
+
+        REQUIRE(!queue.error().has_value());
+        REQUIRE(result.size() < 1000);
+    }
+}
+
+TEST_CASE("Tokenizer policies", "[tokenizer]")
+{
+    using keep_comments_policy       = lcl::tokenizer_policy<true,  false, false, false>;
+    using line_numbers_policy        = lcl::tokenizer_policy<false, true,  false, false>;
+    using unicode_identifiers_policy = lcl::tokenizer_policy<false, false, true,  false>;
+    using collect_errors_policy      = lcl::tokenizer_policy<false, false, false, true >;
+
+    SECTION("Comments are dropped")
+    {
+        const auto buffer = lcl::source_buffer { "a //Comment\n/* Comment */ b"sv };
+
+        const auto expected_with_comments = lcl::tokenize_code<keep_comments_policy>(buffer);
+        REQUIRE(expected_with_comments.has_value());
+        REQUIRE(expected_with_comments->size() == 4);
+
+        const auto expected_result = lcl::tokenize_code<lcl::minimal_tokenizer_policy>(buffer);
+        REQUIRE(expected_result.has_value());
+        const auto result = *expected_result;
+
+        REQUIRE(result.size() == 2);
+        REQUIRE(result[0].code == "a");
+        REQUIRE(result[1].code == "b");
+        REQUIRE(result[1].is_preceded_by_newline());
+    }
+
+    SECTION("Line numbers")
+    {
+        const auto buffer = lcl::source_buffer { "a\nb /* \n\n */ c\r\n\n d"sv };
+
+        const auto expected_result = lcl::tokenize_code<line_numbers_policy>(buffer);
+        REQUIRE(expected_result.has_value());
+        const auto result = *expected_result;
+
+        REQUIRE(result.size() == 4);
+        REQUIRE(result[0].line == 1);
+        REQUIRE(result[1].line == 2);
+        REQUIRE(result[2].line == 4);
+        REQUIRE(result[3].line == 6);
+
+        const auto expected_untracked = lcl::tokenize_code<lcl::minimal_tokenizer_policy>(buffer);
+        REQUIRE(expected_untracked.has_value());
+        REQUIRE((*expected_untracked)[3].line == 0);
+    }
+
+    SECTION("Unicode identifiers")
+    {
+        const auto buffer = lcl::source_buffer { "漢語 a漢1 := 1;"sv };
+
+        const auto expected_result = lcl::tokenize_code<unicode_identifiers_policy>(buffer);
+        REQUIRE(expected_result.has_value());
+        const auto result = *expected_result;
+
+        REQUIRE(result.size() == 6);
+        REQUIRE(result[0].type == lcl::token_type::word);
+        REQUIRE(result[0].code == "漢語");
+        REQUIRE(result[1].type == lcl::token_type::word);
+        REQUIRE(result[1].code == "a漢1");
+    }
+
+    SECTION("Errors are collected")
+    {
+        const auto buffer = lcl::source_buffer { "1_ + \"a\n 1a \"b"sv };
+
+        const auto result = lcl::tokenize_code<collect_errors_policy>(buffer);
+
+        REQUIRE(result.errors.size() == 4);
+        REQUIRE(result.errors[0].error_type == lcl::tokenizer_error_type::numeric_literal_ends_with_underscore);
+        REQUIRE(result.errors[1].error_type == lcl::tokenizer_error_type::newline_in_string_literal);
+        REQUIRE(result.errors[2].error_type == lcl::tokenizer_error_type::numeric_literal_contains_unexpected_character);
+        REQUIRE(result.errors[3].error_type == lcl::tokenizer_error_type::string_literal_not_closed_properly);
+
+        REQUIRE(result.tokens.size() == 6);
+        REQUIRE(result.tokens[0].code == "1_");
+        REQUIRE(result.tokens[2].code == "\"a");
+        REQUIRE(result.tokens[3].code == "1");
+        REQUIRE(result.tokens[4].code == "a");
+        REQUIRE(result.tokens[5].code == "\"b");
+    }
+}
+
+TEST_CASE("Conditional directives", "[tokenizer]")
+{
+    using policy = lcl::tokenizer_policy<true, true, false, false>;
+
+    const auto code = R"code_code(a
+#if WINDOWS
+    windows "#else" /*
+#else
+    */ // #end
+    #if not LINUX
+        not_linux
+    #end
+#else
+    linux
+#end
+b)code_code"sv;
+
+    SECTION("Taken branch")
+    {
+        const auto buffer          = lcl::source_buffer { code };
+        const auto expected_result = lcl::tokenize_code<policy>(buffer, { "WINDOWS"sv });
+        REQUIRE(expected_result.has_value());
+        const auto result = *expected_result;
+
+        REQUIRE(result.size() == 7);
+        REQUIRE(result[0].code == "a");
+        REQUIRE(result[1].code == "windows");
+        REQUIRE(result[2].type == lcl::token_type::string_literal);
+        REQUIRE(result[3].is_multi_line_comment());
+        REQUIRE(result[4].code == "// #end");
+        REQUIRE(result[5].code == "not_linux");
+        REQUIRE(result[5].line == 7);
+        REQUIRE(result[6].code == "b");
+        REQUIRE(result[6].line == 12);
+    }
+
+    SECTION("Skipped branch")
+    {
+        const auto buffer          = lcl::source_buffer { code };
+        const auto expected_result = lcl::tokenize_code<policy>(buffer);
+        REQUIRE(expected_result.has_value());
+        const auto result = *expected_result;
+
+        REQUIRE(result.size() == 3);
+        REQUIRE(result[0].code == "a");
+        REQUIRE(result[1].code == "linux");
+        REQUIRE(result[1].line == 10);
+        REQUIRE(result[1].is_preceded_by_newline());
+        REQUIRE(result[2].code == "b");
+        REQUIRE(result[2].line == 12);
+    }
+
+    SECTION("Hashtag that is not a directive")
+    {
+        const auto buffer          = lcl::source_buffer { "#define a #if"sv };
+        const auto expected_result = lcl::tokenize_code<policy>(buffer);
+        REQUIRE(expected_result.has_value());
+        const auto result = *expected_result;
+
+        REQUIRE(result.size() == 5);
+        REQUIRE(result[0].type == lcl::token_type::hashtag);
+        REQUIRE(result[3].type == lcl::token_type::hashtag);
+    }
+
+    SECTION("Comments before a directive")
+    {
+        //The directives are the same whether the comments are kept as tokens or not
+        const auto buffer = lcl::source_buffer { "a\n/* c */ #if A\nb\n/* c */ #else\nc\n  /* c */ /*\n*/ #end\nd"sv };
+
+        const auto expected_with_comments = lcl::tokenize_code<lcl::tokenizer_policy<true, false, false, false>>(buffer);
+        REQUIRE(expected_with_comments.has_value());
+        const auto with_comments = *expected_with_comments;
+
+        REQUIRE(with_comments.size() == 6);
+        REQUIRE(with_comments[0].code == "a");
+        REQUIRE(with_comments[1].type == lcl::token_type::comment);
+        REQUIRE(with_comments[2].code == "c");
+        REQUIRE(with_comments[5].code == "d");
+
+        const auto expected_without_comments = lcl::tokenize_code<lcl::minimal_tokenizer_policy>(buffer);
+        REQUIRE(expected_without_comments.has_value());
+        const auto without_comments = *expected_without_comments;
+
+        REQUIRE(without_comments.size() == 3);
+        REQUIRE(without_comments[0].code == "a");
+        REQUIRE(without_comments[1].code == "c");
+        REQUIRE(without_comments[2].code == "d");
+
+        const auto taken_with_comments    = lcl::tokenize_code<lcl::tokenizer_policy<true, false, false, false>>(buffer, { "A"sv });
+        const auto taken_without_comments = lcl::tokenize_code<lcl::minimal_tokenizer_policy>(buffer, { "A"sv });
+        REQUIRE(taken_with_comments.has_value());
+        REQUIRE(taken_without_comments.has_value());
+
+        REQUIRE(taken_with_comments->size() == 5);
+        REQUIRE((*taken_with_comments)[2].code == "b");
+        REQUIRE(taken_without_comments->size() == 3);
+        REQUIRE((*taken_without_comments)[1].code == "b");
+        REQUIRE((*taken_without_comments)[2].code == "d");
+    }
+
+    SECTION("Tokenization failure")
+    {
+        const auto check_error = [] (const std::string_view code, const lcl::tokenizer_error_type error_type)
+        {
+            const auto buffer          = lcl::source_buffer { code };
+            const auto expected_result = lcl::tokenize_code<policy>(buffer);
+            REQUIRE(!expected_result.has_value());
+            REQUIRE(expected_result.error().error_type == error_type);
+        };
+
+        check_error("#if\n#end"sv,                  lcl::tokenizer_error_type::directive_condition_missing);
+        check_error("#else"sv,                      lcl::tokenizer_error_type::directive_else_without_if);
+        check_error("#if A\n#else\n#else\n#end"sv, lcl::tokenizer_error_type::directive_else_repeated);
+        check_error("#end"sv,                       lcl::tokenizer_error_type::directive_end_without_if);
+        check_error("#if A\na"sv,                   lcl::tokenizer_error_type::directive_if_not_closed);
+        check_error("#if not A\n#if B\n#end"sv,     lcl::tokenizer_error_type::directive_if_not_closed);
+        check_error("#if A b\n#end"sv,              lcl::tokenizer_error_type::unexpected_characters_after_directive);
+    }
+}
+
+TEST_CASE("Forward progress", "[tokenizer]")
+{
+    using collect_errors_policy = lcl::tokenizer_policy<false, false, false, true>;
+
+    SECTION("Unknown characters")
+    {
+        const auto buffer          = lcl::source_buffer { "a $b"sv };
+        const auto expected_result = lcl::tokenize_code(buffer);
+        REQUIRE(!expected_result.has_value());
+        REQUIRE(expected_result.error().error_type == lcl::tokenizer_error_type::unknown_character);
+        REQUIRE(&*expected_result.error().iterator_when_error_occured == buffer.data() + 2);
+    }
+
+    SECTION("Unknown characters are skipped when collecting errors")
+    {
+        const auto buffer = lcl::source_buffer { "$a ? 漢 'b\0c"sv };
+
+        const auto result = lcl::tokenize_code<collect_errors_policy>(buffer);
+
+        REQUIRE(result.errors.size() == 5);
+        REQUIRE(result.tokens.size() == 3);
+        REQUIRE(result.tokens[0].code == "a");
+        REQUIRE(result.tokens[1].code == "b");
+        REQUIRE(result.tokens[2].code == "c");
+
+        for (const auto& error : result.errors)
+        {
+            REQUIRE(error.error_type == lcl::tokenizer_error_type::unknown_character);
+        }
+    }
+
+    SECTION("Dot followed by a character that is not a digit")
+    {
+        const auto buffer          = lcl::source_buffer { "1.a"sv };
+        const auto expected_result = lcl::tokenize_code(buffer);
+        REQUIRE(expected_result.has_value());
+        const auto result = *expected_result;
+
+        REQUIRE(result.size() == 3);
+        REQUIRE(result[0].code == "1");
+        REQUIRE(result[1].type == lcl::token_type::dot);
+        REQUIRE(result[2].code == "a");
+    }
+
+    SECTION("Pathological inputs")
+    {
+        constexpr auto count = 100000;
+
+        auto nested_comments_code = std::string{};
+
+        for (auto i = 0; i < count; ++i) nested_comments_code += "/*";
+        for (auto i = 0; i < count; ++i) nested_comments_code += "*/";
+
+        const auto nested_comments = lcl::source_buffer { nested_comments_code };
+        REQUIRE(lcl::tokenize_code(nested_comments).value().size() == 1);
+
+        const auto dots = lcl::source_buffer { "1" + std::string(count, '.') };
+        REQUIRE(lcl::tokenize_code(dots).value().size() == count + 1);
+
+        const auto brackets = lcl::source_buffer { std::string(count, '(') + std::string(count, ']') };
+        const auto result   = lcl::tokenize_code_with_bracket_pairs(brackets);
+        REQUIRE(result.has_value());
+        REQUIRE(result->brackets.unmatched_brackets.size() == 2 * count);
+    }
+}
+
+TEST_CASE("Import prescan", "[tokenizer]")
+{
+    SECTION("Imports at the top of the code")
+    {
+        const auto buffer = lcl::source_buffer { R"code_code(//Dependencies
+import Print: print, printf;
+/* Everything */ import Math: *;
+#if WINDOWS
+import Windows: *;
+#end
+
+main := () { $ }
+import Late: *;
+)code_code"sv };
+
+        const auto expected_result = lcl::prescan_imports(buffer);
+        REQUIRE(expected_result.has_value());
+        const auto result = *expected_result;
+
+        REQUIRE(result.size() == 2);
+        REQUIRE(result[0].module_name == "Print");
+        REQUIRE(!result[0].is_full_import);
+        REQUIRE(result[0].imported_names == std::vector<std::string_view> { "print"sv, "printf"sv });
+        REQUIRE(result[1].module_name == "Math");
+        REQUIRE(result[1].is_full_import);
+        REQUIRE(result[1].imported_names.empty());
+
+        const auto expected_windows_result = lcl::prescan_imports(buffer, { "WINDOWS"sv });
+        REQUIRE(expected_windows_result.has_value());
+        REQUIRE(expected_windows_result->size() == 3);
+        REQUIRE((*expected_windows_result)[2].module_name == "Windows");
+    }
+
+    SECTION("Malformed or unfinished import statements are left out")
+    {
+        const auto check_imports = [] (const std::string_view code, const std::size_t import_count)
+        {
+            const auto buffer          = lcl::source_buffer { code };
+            const auto expected_result = lcl::prescan_imports(buffer);
+            REQUIRE(expected_result.has_value());
+            REQUIRE(expected_result->size() == import_count);
+        };
+
+        check_imports(""sv,                                  0);
+        check_imports("import A: *; import B *;"sv,          1);
+        check_imports("import A: a, ; import B: *;"sv,       0);
+        check_imports("import A: *; import B: a, b"sv,       1);
+        check_imports("import A: *; import"sv,               1);
+        check_imports("import A: *; imports B: *;"sv,        1);
+    }
+
+    SECTION("Tokenization failure before the end of the imports")
+    {
+        const auto buffer          = lcl::source_buffer { "import A: *; /* import B: *;"sv };
+        const auto expected_result = lcl::prescan_imports(buffer);
+        REQUIRE(!expected_result.has_value());
+        REQUIRE(expected_result.error().error_type == lcl::tokenizer_error_type::multi_line_comment_not_closed);
+    }
+}
+
+TEST_CASE("Batch tokenization", "[tokenizer]")
+{
+    auto file_codes = std::vector<std::string>{};
+
+    for (auto i = 0; i < 200; ++i)
+    {
+        //Every 10th file fails, the sizes differ so the buffers of the workers get reused with smaller and bigger files
+        file_codes.push_back(i % 10 == 0 ? "a $" : std::string(static_cast<std::size_t>(i), 'a') + " := " + std::to_string(i) + ";");
+    }
+
+    const auto files = std::vector<std::string_view>(std::cbegin(file_codes), std::cend(file_codes));
+
+    for (const auto worker_count : { 1, 4 })
+    {
+        auto pool = lcl::tokenizer_pool { static_cast<std::size_t>(worker_count) };
+        REQUIRE(pool.worker_count() == static_cast<std::size_t>(worker_count));
+
+        //The same threads and arenas tokenize every batch
+        for (auto batch = 0; batch < 3; ++batch)
+        {
+            const auto results = pool.tokenize(files);
+            REQUIRE(results.size() == files.size());
+
+            auto token_count = std::size_t { 0 };
+
+            for (auto i = std::size_t { 0 }; i < files.size(); ++i)
+            {
+                if (i % 10 == 0)
+                {
+                    REQUIRE(!results[i].has_value());
+                    REQUIRE(results[i].error().error_type == lcl::tokenizer_error_type::unknown_character);
+                    REQUIRE(&*results[i].error().iterator_when_error_occured == files[i].data() + 2);
+                    continue;
+                }
+
+                REQUIRE(results[i].has_value());
+                REQUIRE(results[i]->size() == 5);
+                REQUIRE((*results[i])[0].code.data() == files[i].data());
+                REQUIRE((*results[i])[3].code == std::to_string(i));
+
+                token_count += results[i]->size();
+            }
+
+            //Only the tokens of the files that were tokenized are kept, the previous batches were freed
+            REQUIRE(pool.token_bytes() == token_count * sizeof(lcl::token));
+        }
+    }
+
+    SECTION("No files")
+    {
+        auto pool = lcl::tokenizer_pool { 2 };
+        REQUIRE(pool.tokenize({}).empty());
+    }
+
+    SECTION("Fewer files than workers")
+    {
+        auto pool = lcl::tokenizer_pool { 8 };
+
+        const auto results = pool.tokenize(gsl::span<const std::string_view> { files.data(), 3 });
+        REQUIRE(results.size() == 3);
+        REQUIRE(!results[0].has_value());
+        REQUIRE(results[1].has_value());
+        REQUIRE(results[2].has_value());
+    }
+}